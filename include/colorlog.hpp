@@ -7,8 +7,10 @@
     * Key Components:
     * - LoggerConfig struct: Defines the configuration for the logger.
     * - Logger class: Provides logging functionality with color-coded output.
+    * - BasicLogger class template: Logger configured at compile time by a policy.
     * - AsyncLogger class: Provides asynchronous logging functionality.
-    * - LoggerFactory class: Provides factory methods to create and manage logger instances.
+    * - LoggerFactory class: Provides factory methods, the default logger and the named-logger registry.
+    * - LogContext class: Thread-local key/value fields attached to every record.
     * - Templates: Handle different data types for logging messages.
     *
     * External Dependencies:
@@ -27,17 +29,54 @@ Key Classes and Functions:
    - Defines the configuration for the logger.
    - Members:
      - `LogLevel log_level = LogLevel::info`: Default log level.
-     - `OutputMode output_mode = OutputMode::Console`: Default output mode.
+     - `OutputMode output_mode = OutputMode::Console`: Output mode the default sinks are built from (Console, File, Both, Binary, Mapped or Json).
      - `std::string log_file_name`: Log file name.
-     - `LogFormatter formatter`: Default formatter function.
+     - `std::vector<std::shared_ptr<Sink>> sinks`: Sinks to write to; when empty they are built from output_mode and log_file_name.
+     - `bool parallel_sinks = true`: Write each AsyncLogger batch to several sinks concurrently.
+     - `FlushPolicy flush_policy = FlushPolicy::Always`: When output is flushed (Always, Never, EveryN, Interval); lines end with '\n', not std::endl.
+     - `size_t flush_every_n = 64`: Messages between flushes for FlushPolicy::EveryN.
+     - `std::chrono::milliseconds flush_interval{100}`: Maximum flush delay for FlushPolicy::Interval; the AsyncLogger worker flushes idle output.
+     - `bool flush_on_error = true`: Always flush error and fatal messages.
+     - `size_t queue_capacity = 8192`: Number of preallocated AsyncLogger ring slots.
+     - `size_t batch_size = 256`: Maximum entries the AsyncLogger worker formats into one batch before writing it.
+     - `size_t worker_count = 1`: AsyncLogger shards; producer threads are spread over them, each with its own ring (queue_capacity slots) and worker.
+     - `ShardOrdering shard_ordering = ShardOrdering::Merged`: With several shards, Merged interleaves their batches by timestamp into the shared sinks; PerShard writes each shard unordered to its own ".shardN" files.
+     - `std::vector<int> worker_cpus`: CPUs the shard workers are pinned to, round-robin (Linux); list the CPUs of a NUMA node to keep a shard on it.
+     - `OverflowPolicy overflow_policy = OverflowPolicy::Block`: What AsyncLogger does when the ring is full (Block, DropNewest, DropOldest, Sample).
+     - `double overflow_sample_threshold = 0.75`: Ring fill ratio at which OverflowPolicy::Sample starts sampling.
+     - `std::unordered_map<LogLevel, double> overflow_sample_rates`: Per-level keep probability under OverflowPolicy::Sample.
+     - `size_t mapped_segment_size = 64 * 1024 * 1024`: Preallocated bytes per memory-mapped segment for OutputMode::Mapped.
+     - `size_t rotate_max_bytes = 0`: Rotate the log file when it reaches this size (0 disables).
+     - `std::chrono::milliseconds rotate_interval{0}`: Rotate the log file after it has been open this long (0 disables).
+     - `size_t rotate_keep = 5`: Rotated log files to keep.
+     - `Compression rotate_compression = Compression::None`: Compress rotated files in the background (None, Gzip, Zstd).
+     - `LogBufferFormatter buffer_formatter = default_format`: Formatter appending "file:line msg" into a reused per-thread FormatBuffer; steady-state logging does not allocate.
+     - `TimestampFormat timestamp_format = TimestampFormat::None`: Timestamp written in front of text records (None, Seconds, Milliseconds, Microseconds, Nanoseconds); the date and second are cached per thread.
+     - `bool timestamp_utc = false`: Render timestamps in UTC instead of local time.
+     - `ClockSource clock_source = ClockSource::System`: Clock records are timestamped with (System, Coarse for CLOCK_REALTIME_COARSE, Tsc for the calibrated CPU counter).
+     - `std::unordered_map<LogLevel, SiteLimit> site_limits`: Per-call-site token bucket (rate, burst) and repeat suppression by level, applied before any formatting; empty disables.
+     - `std::unordered_map<LogLevel, SampleRate> sampling`: Per-level 1-in-N and probability sampling, applied before the message is built; kept records carry a "[1/N]" tag. Empty disables.
+     - `bool collect_stats = false`: Keep lock-free per-thread counters and capture-to-write latency histograms, read with stats().
+     - `std::chrono::milliseconds stats_report_interval{0}`: Log LoggerStats::summary() at info this often while collecting stats (0 disables).
+     - `std::function<void(std::coroutine_handle<>)> resume_executor`: C++20 only. Resumes coroutines awaiting AsyncLogger::flush_async() or durable(); empty resumes them on the worker thread.
+     - `LogFormatter formatter`: Legacy string-returning formatter; empty by default, overrides buffer_formatter when set.
 2. Logger Class
    - Provides logging functionality with color-coded output.
+   - Logger is an alias of BasicLogger<DynamicPolicy>: sinks, formatters, levels and colors are chosen at runtime.
    - Functions:
-     - `void set_log_level(LogLevel level)`: Sets the log level.
-     - `void set_log_level_color(LogLevel level, const std::string& color)`: Sets the color for a log level.
-     - `void set_output_mode(OutputMode mode)`: Sets the output mode.
-     - `void set_log_file(const std::string& filename)`: Sets the log file.
-     - `void set_formatter(LogFormatter formatter)`: Sets the log formatter.
+     - `void set_log_level(LogLevel level)`: Sets the runtime log level (atomic, checked before any formatting).
+     - `bool should_log(LogLevel level) const`: Checks a level against the compile-time and runtime thresholds.
+     - `bool sample(LogLevel level)`: Makes the sampling decision before the message is built; the logging macros call it after should_log (likewise on AsyncLogger).
+     - `LoggerStats stats() const`: Snapshot of the collect_stats counters: messages per level, bytes written, suppressed records and the latency histogram.
+     - `RecordInfo capture_info() const`: Captures the time (from clock_source) and thread for a record logged later with log_captured.
+     - `void set_log_level_color(LogLevel level, const std::string& color)`: Sets the color for a log level; the plain and colored "[LEVEL] " prefixes are precomputed per level and rebuilt only here.
+     - `void set_output_mode(OutputMode mode)`: Sets the output mode and rebuilds the default sinks.
+     - `void set_log_file(const std::string& filename)`: Sets the log file and rebuilds the default sinks.
+     - `void add_sink(std::shared_ptr<Sink> sink)`: Adds a sink; set_sinks(SinkList) replaces them all and sinks() returns the current list.
+     - `void set_formatter(LogFormatter formatter)`: Sets the legacy log formatter.
+     - `void set_buffer_formatter(LogBufferFormatter formatter)`: Sets the buffer formatter and clears any legacy formatter.
+     - `void flush()`: Flushes buffered output to the OS.
+     - `void sync()`: Flushes and waits until the output is on stable storage (Sink::sync, fsync for files).
      - `template<PrintableStringOrIterable T> void info(const T& msg)`: Logs an info message.
      - `template<PrintableStringOrIterable T> void debug(const T& msg)`: Logs a debug message.
      - `template<PrintableStringOrIterable T> void warn(const T& msg)`: Logs a warning message.
@@ -50,20 +89,76 @@ Key Classes and Functions:
      - `template<PrintableStringOrIterable T> void error(const std::string& file, int line, const T& msg)`: Logs an error message with file and line info.
      - `template<PrintableStringOrIterable T> void fatal(const std::string& file, int line, const T& msg)`: Logs a fatal message with file and line info.
      - `template<PrintableStringOrIterable T> void trace(const std::string& file, int line, const T& msg)`: Logs a trace message with file and line info.
+     - `template<LazyMessage F> void info(F&& make_msg)`: Logs an info message built by a callable, invoked only if info is enabled (likewise for the other levels, with or without file and line info).
+     - `template<Formattable... Args> void infof(const char* fmt, const Args&... args)`: Logs an info message from a "{}" format string, formatted only if info is enabled (likewise for the other levels).
+     - `template<Formattable... Args> void info(format_string<Args...> fmt, const Args&... args)`: Logs an info message from a "{}" format string checked against the arguments at compile time (likewise for the other levels, and on BasicLogger). Specialize `colorlog::formatter<T>` to format a type without operator<<.
+     - `template<Formattable... Args> void logf(LogLevel level, const std::string& file, int line, const char* fmt, const Args&... args)`: Logs a format-string message with file and line info.
+     - `template<PrintableStringOrIterable T> void log(const CallSite& site, const T& msg)`: Logs through a static call site (see COLORLOG_CALL_SITE); logf(const CallSite&, args...) and the lazy form are also available.
      - `template<PrintableStringOrIterableOrOptional T> void log_optional(LogLevel level, const std::string& file, int line, const T& msg)`: Logs an optional message.
      - `template<PrintableOrException T> void log_exception(LogLevel level, const std::string& file, int line, const T& msg)`: Logs an exception message.
      - `void handle_error(const std::exception& e, const std::string& context)`: Handles an error with context.
      - `void register_error_handler(const std::string& exception_type, std::function<void(const std::exception&)> handler)`: Registers an error handler.
      - `void set_default_error_handler(std::function<void(const std::exception&)> handler)`: Sets the default error handler.
-3. AsyncLogger Class
+3. BasicLogger Class Template
+   - A logger configured at compile time by a policy (derive from StaticPolicy); the hot path is inlined with no virtual or std::function calls.
+   - Policy members:
+     - `static constexpr LogLevel min_level = LogLevel::debug`: Calls below this level compile to nothing.
+     - `using Sinks = std::tuple<StaticConsoleSink>`: Sink types (StaticConsoleSink, StaticFileSink or any type with write, flush and is_terminal).
+     - `using Formatter = DefaultFormatter`: Formatter type called as (FormatBuffer&, level, file, line, msg).
+     - `using Mutex = std::mutex`: Locking strategy; SpinMutex, or NullMutex for single-threaded use.
+     - `static constexpr bool colored = true`: Color level names on terminal sinks; false compiles color out.
+     - `static constexpr bool flush_every_record = true`: Flush the sinks after every record.
+   - Functions:
+     - `template<typename... SinkArgs> explicit BasicLogger(SinkArgs&&... sinks)`: Constructs the sinks from the arguments.
+     - `static constexpr bool should_log(LogLevel level)`: Checks a level against min_level and LOG_LEVEL.
+     - `void log(LogLevel level, std::string_view file, int line, const T& msg)`: Logs a message; logf, the CallSite forms, lazy messages and debug/info/warn/error/fatal/trace helpers are also available.
+     - `template <size_t I> auto& sink()`: Returns sink I.
+     - `void flush()`: Flushes every sink.
+
+4. AsyncLogger Class
    - Provides asynchronous logging functionality.
+   - Producers publish into a bounded lock-free ring of preallocated slots; a single worker thread drains it without blocking them.
+   - Each slot stores the file name, message and captured string arguments inline (256 bytes); longer text goes to a per-shard chunked arena whose chunks are recycled after each batch, so enqueueing does not allocate.
+   - Contiguous ranges of arithmetic values, bare or through join(), are copied into the entry and formatted by the worker; other messages are formatted on the producer.
+   - The worker formats up to batch_size entries into memory and writes them with one write per stream; the flush policy is applied once per batch.
+   - With worker_count > 1 the rings and workers are sharded by producer thread; shards are merged by timestamp or written to per-shard files (shard_ordering).
    - Functions:
      - `template<PrintableStringOrIterable T> void log(LogLevel level, const std::string& file, int line, const T& msg)`: Asynchronously logs a message.
-4. LoggerFactory Class
+     - `template<LazyMessage F> void log(LogLevel level, const std::string& file, int line, F&& make_msg)`: Moves the callable into the queue; it is invoked on the worker thread.
+     - `template<Formattable... Args> void logf(LogLevel level, const std::string& file, int line, const char* fmt, const Args&... args)`: Captures the arguments by value and formats them on the worker thread.
+     - `void set_log_level(LogLevel level)`: Sets the runtime log level; filtered messages are never enqueued.
+     - `void flush()`: Blocks until every message logged before the call is written and flushed. Fatal messages do this automatically.
+     - `Sequence sequence() const`: Position of the calling thread's last message in its shard.
+     - `void wait_durable(Sequence sequence)`: Blocks until the messages up to the sequence (or everything logged before the call) are synced to storage.
+     - `FlushAwaiter flush_async(), FlushAwaiter durable(Sequence sequence)`: C++20 only. Awaitables for `co_await`; the coroutine is suspended without blocking a thread and resumed through resume_executor.
+     - `static std::string shard_file_name(const std::string& file, size_t index)`: File name used by unordered shard `index` ("app.log" becomes "app.shard1.log").
+     - `LoggerStats stats() const`: Counters summed over the shards, plus overflow drops, queue depth and high-water mark; latency runs from enqueue to write.
+     - `void dump_pending(detail::FdWriter& out) const`: Writes the records still queued in the rings as plain text, async-signal-safely (used by CrashHandler).
+5. CrashHandler Class (POSIX)
+   - On SIGSEGV, SIGABRT, SIGBUS, SIGILL or SIGFPE, writes every AsyncLogger's queued records and a stack trace to a file descriptor, then re-raises the signal.
+   - The handler allocates nothing and takes no locks: text goes out with write(2), the trace with backtrace_symbols_fd.
+   - Functions:
+     - `static bool install(int fd = STDERR_FILENO)`: Installs the handlers writing to fd; install(const std::string& path) opens the file up front.
+     - `static void uninstall()`: Restores the previous handlers.
+     - `static void dump(int fd, const char* reason)`: Writes the report immediately, as the handler does.
+6. LoggerFactory Class
    - Provides factory methods to create and manage logger instances.
    - Functions:
      - `static Logger createLogger(const LoggerConfig& config = LoggerConfig())`: Creates a synchronous logger.
      - `static AsyncLogger createAsyncLogger(const LoggerConfig& config = LoggerConfig())`: Creates an asynchronous logger.
+     - `static AsyncLogger& instance()`: The process-wide default logger used by the LOG_* macros; one atomic load once it exists.
+     - `static AsyncLogger& init(const LoggerConfig& config)`: Creates the default logger at startup; later calls return it unchanged.
+     - `static NamedLogger& get(std::string_view name)`: The component logger called name, registered on first use; find(name) returns nullptr instead. Lookups are lock-free.
+   - NamedLogger: a component's own name and level over the shared default logger, with no queue or thread of its own; records show "[name]" after the level.
+
+7. LogContext Class
+   - Thread-local key/value fields (mapped diagnostic context) attached to every record logged on the thread while they are in scope.
+   - The fields are packed into capacity (256) bytes of per-thread storage; a record takes them as one blob, which AsyncLogger copies into the entry for the worker to render.
+   - Text records show them as "[key=value ...]" after the level; JSON sinks write them as a "context" object.
+   - Functions:
+     - `Scope(std::string_view key, std::string_view value)`: Adds a field for the scope's lifetime; arithmetic values are converted without allocating.
+     - `static std::string_view current()`: The calling thread's packed fields.
+     - `template <typename Fn> static void for_each(std::string_view packed, Fn&& fn)`: Calls fn(key, value) for each packed field, outermost first.
 */
 
 /*
@@ -139,568 +234,14 @@ asyncLogger.log(LogLevel::info, __FILE__, __LINE__, "This is an asynchronous inf
 #ifndef COLORLOG_HPP_
 #define COLORLOG_HPP_
 
-#include <iostream>
-#include <sstream>
-#include <string>
-#include <unordered_map>
-#include <functional>
-#include <mutex>
-#include <exception>
-#include <typeinfo>
-#include <fstream>
-#include <queue>
-#include <thread>
-#include <condition_variable>
-#include <atomic>
-#include <optional>
-#include <execinfo.h>
-#include <concepts>
-
-// Concepts for type constraints
-
-// Define Arithmetic concept first
-/// Concept to check if a type is arithmetic (e.g., int, float).
-template <typename T>
-concept Arithmetic = std::is_arithmetic_v<T>;
-
-// Helper traits for type checks
-
-/// Trait to check if a type can be printed to an ostream.
-template <typename T, typename = void>
-struct is_printable : std::false_type {};
-
-template <typename T>
-struct is_printable<T, std::void_t<decltype(std::declval<std::ostream&>() << std::declval<T>())>> : std::true_type {};
-
-template <typename T>
-inline constexpr bool is_printable_v = is_printable<T>::value;
-
-/// Trait to check if a type is iterable.
-template <typename T, typename = void>
-struct is_iterable : std::false_type {};
-
-template <typename T>
-struct is_iterable<T, std::void_t<decltype(std::declval<T>().begin()), decltype(std::declval<T>().end())>> : std::true_type {};
-
-template <typename T>
-inline constexpr bool is_iterable_v = is_iterable<T>::value;
-
-/// Trait to check if a type has a value_type member.
-template <typename T, typename = void>
-struct has_value_type : std::false_type {};
-
-template <typename T>
-struct has_value_type<T, std::void_t<typename T::value_type>> : std::true_type {};
-
-template <typename T>
-inline constexpr bool has_value_type_v = has_value_type<T>::value;
-
-/// Trait to check if a type is a string.
-template <typename T>
-struct is_string : std::is_same<T, std::string> {};
-
-template <typename T>
-inline constexpr bool is_string_v = is_string<T>::value;
-
-/// Concept to check if a type can be printed to an ostream.
-template <typename T>
-concept Printable = is_printable_v<T>;
-
-/// Concept to check if a type is iterable.
-template <typename T>
-concept Iterable = is_iterable_v<T>;
-
-/// Concept to check if a type is a string or an iterable of printable elements.
-template <typename T>
-concept StringOrIterableOfPrintable = is_string_v<T> || 
-                                      (is_iterable_v<T> && has_value_type_v<T> && Printable<typename T::value_type>);
-
-/// Concept to check if a type is printable, a string, or an iterable of printable elements.
-template <typename T>
-concept PrintableStringOrIterable = (Printable<T> && !Arithmetic<T>) || StringOrIterableOfPrintable<T>;
-
-/// Concept to check if a type is an optional of printable elements.
-template <typename T>
-concept PrintableOptional = requires(T t) {
-    { t.value() } -> Printable;
-};
-
-/// Concept to check if a type is printable, a string, an iterable of printable elements, or an optional of printable elements.
-template <typename T>
-concept PrintableStringOrIterableOrOptional = PrintableStringOrIterable<T> || PrintableOptional<T>;
-
-/// Concept to check if a type is printable or an exception.
-template <typename T>
-concept PrintableOrException = (Printable<T> && !Arithmetic<T>) || std::is_base_of_v<std::exception, T>;
-
-#if defined(_WIN32) || defined(_WIN64)
-    #include <io.h>
-    #include <windows.h>
-    #define ISATTY _isatty
-    #define FILENO _fileno
-#else
-    #include <unistd.h>
-    #define ISATTY ::isatty
-    #define FILENO ::fileno
-#endif
-
-// Define log levels
-#define LOG_LEVEL_DEBUG 0
-#define LOG_LEVEL_INFO 1
-#define LOG_LEVEL_WARN 2
-#define LOG_LEVEL_ERROR 3
-#define LOG_LEVEL_FATAL 4
-#define LOG_LEVEL_TRACE 5
-
-// Default log level
-#ifndef LOG_LEVEL
-#define LOG_LEVEL LOG_LEVEL_DEBUG
-#endif
-
-#if LOG_LEVEL <= LOG_LEVEL_DEBUG
-#define LOG_DEBUG(msg) LoggerFactory::instance().log(LogLevel::debug, __FILE__, __LINE__, msg)
-#else
-#define LOG_DEBUG(msg)
-#endif
+// C++20 front layer over colorlog_core.hpp, which holds the implementation shared with
+// colorlog_cpp17.hpp. In C++20 the core's constraints are concepts, format strings are checked
+// at compile time and AsyncLogger flushes can be awaited; C++17 code includes colorlog_cpp17.hpp
 
-#if LOG_LEVEL <= LOG_LEVEL_INFO
-#define LOG_INFO(msg) LoggerFactory::instance().log(LogLevel::info, __FILE__, __LINE__, msg)
-#else
-#define LOG_INFO(msg)
-#endif
-
-#if LOG_LEVEL <= LOG_LEVEL_WARN
-#define LOG_WARN(msg) LoggerFactory::instance().log(LogLevel::warn, __FILE__, __LINE__, msg)
-#else
-#define LOG_WARN(msg)
-#endif
-
-#if LOG_LEVEL <= LOG_LEVEL_ERROR
-#define LOG_ERROR(msg) LoggerFactory::instance().log(LogLevel::error, __FILE__, __LINE__, msg)
-#else
-#define LOG_ERROR(msg)
-#endif
-
-#if LOG_LEVEL <= LOG_LEVEL_FATAL
-#define LOG_FATAL(msg) LoggerFactory::instance().log(LogLevel::fatal, __FILE__, __LINE__, msg)
-#else
-#define LOG_FATAL(msg)
-#endif
-
-#if LOG_LEVEL <= LOG_LEVEL_TRACE
-#define LOG_TRACE(msg) LoggerFactory::instance().log(LogLevel::trace, __FILE__, __LINE__, msg)
-#else
-#define LOG_TRACE(msg)
-#endif
-
-namespace colorlog {
-
-// Global flag to enable/disable colored output
-bool is_global_colored = true;
-
-// TerminalCache class for caching terminal information
-class TerminalCache {
-public:
-    // Singleton pattern for single instance
-    static TerminalCache& instance() {
-        static TerminalCache instance;
-        return instance;
-    }
-
-    // Check if the given output stream is a terminal
-    bool is_terminal(std::ostream* os) {
-        if (os == &std::cout) return is_stdout_terminal_;
-        if (os == &std::cerr) return is_stderr_terminal_;
-        return false;
-    }
-
-private:
-    // Private constructor for singleton
-    TerminalCache() {
-        is_stdout_terminal_ = ISATTY(FILENO(stdout));
-        is_stderr_terminal_ = ISATTY(FILENO(stderr));
-    }
-
-    bool is_stdout_terminal_;  // Cache for stdout terminal status
-    bool is_stderr_terminal_;  // Cache for stderr terminal status
-};
-
-// Check if color should be applied to the given stream
-inline bool check_color(std::ostream& stream) {
-    return is_global_colored && TerminalCache::instance().is_terminal(&stream);
-}
-
-#if defined(_WIN32) || defined(_WIN64)
-// Apply color code for Windows systems
-inline void apply_windows_code(std::ostream& stream, WORD attr) {
-    if (check_color(stream)) {
-        HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
-        if (hConsole != INVALID_HANDLE_VALUE) {
-            SetConsoleTextAttribute(hConsole, attr);
-        }
-    }
-}
-#endif
-
-// Apply color code for non-Windows systems
-inline void apply_code(std::ostream& stream, const std::string& code) {
-    if (check_color(stream)) {
-        stream << code;
-    }
-}
-
-// Structure to hold color attributes
-struct ColorAttr {
-    std::string code;  // ANSI color code
-#if defined(_WIN32) || defined(_WIN64)
-    WORD win_attr;     // Windows color attribute
-#endif
-};
-
-// Enumeration for log levels
-enum class LogLevel { debug, info, warn, error, fatal, trace, unknown };
-// Enumeration for output modes
-enum class OutputMode { Console, File, Both };
-
-// Predefined color attributes for each log level
-struct ColorDefs {
-    static const ColorAttr debug;
-    static const ColorAttr info;
-    static const ColorAttr warn;
-    static const ColorAttr error;
-    static const ColorAttr fatal;
-    static const ColorAttr trace;
-    static const ColorAttr unknown;
-};
-
-#if defined(_WIN32) || defined(_WIN64)
-const ColorAttr ColorDefs::debug = {"\033[36m", FOREGROUND_GREEN | FOREGROUND_BLUE};
-const ColorAttr ColorDefs::info = {"\033[1;33m", FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_INTENSITY};
-const ColorAttr ColorDefs::warn = {"\033[33m", FOREGROUND_RED | FOREGROUND_GREEN};
-const ColorAttr ColorDefs::error = {"\033[1;31m", FOREGROUND_RED | FOREGROUND_INTENSITY};
-const ColorAttr ColorDefs::fatal = {"\033[35m", FOREGROUND_RED | FOREGROUND_BLUE};
-const ColorAttr ColorDefs::trace = {"\033[32m", FOREGROUND_GREEN};
-const ColorAttr ColorDefs::unknown = {"\033[34m", FOREGROUND_BLUE};
-#else
-const ColorAttr ColorDefs::debug = {"\033[36m"};
-const ColorAttr ColorDefs::info = {"\033[1;33m"};
-const ColorAttr ColorDefs::warn = {"\033[33m"};
-const ColorAttr ColorDefs::error = {"\033[1;31m"};
-const ColorAttr ColorDefs::fatal = {"\033[35m"};
-const ColorAttr ColorDefs::trace = {"\033[32m"};
-const ColorAttr ColorDefs::unknown = {"\033[34m"};
-#endif
+#include "colorlog_core.hpp"
 
-// Type alias for log formatter function
-using LogFormatter = std::function<std::string(LogLevel, const std::string&, int, const std::string&)>;
-
-// Logger configuration structure
-struct LoggerConfig {
-    LogLevel log_level = LogLevel::info;               // Default log level
-    OutputMode output_mode = OutputMode::Console;      // Default output mode
-    std::string log_file_name;                         // Log file name
-    LogFormatter formatter = [](LogLevel, const std::string& file, int line, const std::string& msg) -> std::string {
-        std::ostringstream oss;
-        if (!file.empty() && line > 0) {
-            oss << file << ":" << line << " ";
-        }
-        oss << msg;
-        return oss.str();
-    };  // Default formatter function
-};
-
-// Logger class
-class Logger {
-public:
-    // Constructor with optional configuration parameter
-    Logger(const LoggerConfig& config = LoggerConfig())
-        : log_level_(config.log_level),
-          output_mode_(config.output_mode),
-          formatter_(config.formatter),
-          log_level_colors_{
-              {LogLevel::debug, ColorDefs::debug},
-              {LogLevel::info, ColorDefs::info},
-              {LogLevel::warn, ColorDefs::warn},
-              {LogLevel::error, ColorDefs::error},
-              {LogLevel::fatal, ColorDefs::fatal},
-              {LogLevel::trace, ColorDefs::trace},
-              {LogLevel::unknown, ColorDefs::unknown}
-          },
-          default_handler_([](const std::exception& e) {
-              std::cerr << "Unhandled exception: " << e.what() << std::endl;
-          }) {
-        if (!config.log_file_name.empty()) {
-            log_file_.open(config.log_file_name, std::ios::out | std::ios::app);
-        }
-    }
-
-    Logger(const Logger&) = delete;              // Disable copy constructor
-    Logger& operator=(const Logger&) = delete;   // Disable copy assignment
-
-    // Set log level
-    void set_log_level(LogLevel level) {
-        log_level_ = level;
-    }
-
-    // Set log level color
-    void set_log_level_color(LogLevel level, const std::string& color) {
-        log_level_colors_[level].code = color;
-    }
-
-    // Set output mode
-    void set_output_mode(OutputMode mode) {
-        output_mode_ = mode;
-    }
-
-    // Set log file
-    void set_log_file(const std::string& filename) {
-        std::lock_guard<std::mutex> lock(mutex_);
-        log_file_.open(filename, std::ios::out | std::ios::app);
-    }
-
-    // Set log formatter
-    void set_formatter(LogFormatter formatter) {
-        formatter_ = formatter;
-    }
-
-    // Logging functions for different log levels
-    template<PrintableStringOrIterable T>
-    void info(const T& msg) { log(LogLevel::info, "", 0, msg); }
-    
-    template<PrintableStringOrIterable T>
-    void debug(const T& msg) { log(LogLevel::debug, "", 0, msg); }
-    
-    template<PrintableStringOrIterable T>
-    void warn(const T& msg) { log(LogLevel::warn, "", 0, msg); }
-    
-    template<PrintableStringOrIterable T>
-    void error(const T& msg) { log(LogLevel::error, "", 0, msg); }
-    
-    template<PrintableStringOrIterable T>
-    void fatal(const T& msg) { log(LogLevel::fatal, "", 0, msg); }
-    
-    template<PrintableStringOrIterable T>
-    void trace(const T& msg) { log(LogLevel::trace, "", 0, msg); }
-
-    // Logging functions with file and line information
-    template<PrintableStringOrIterable T>
-    void info(const std::string& file, int line, const T& msg) { log(LogLevel::info, file, line, msg); }
-    
-    template<PrintableStringOrIterable T>
-    void debug(const std::string& file, int line, const T& msg) { log(LogLevel::debug, file, line, msg); }
-    
-    template<PrintableStringOrIterable T>
-    void warn(const std::string& file, int line, const T& msg) { log(LogLevel::warn, file, line, msg); }
-    
-    template<PrintableStringOrIterable T>
-    void error(const std::string& file, int line, const T& msg) { log(LogLevel::error, file, line, msg); }
-    
-    template<PrintableStringOrIterable T>
-    void fatal(const std::string& file, int line, const T& msg) { log(LogLevel::fatal, file, line, msg); }
-    
-    template<PrintableStringOrIterable T>
-    void trace(const std::string& file, int line, const T& msg) { log(LogLevel::trace, file, line, msg); }
-
-    // Logging functions for PrintableStringOrIterableOrOptional types
-    template<PrintableStringOrIterableOrOptional T>
-    void log_optional(LogLevel level, const std::string& file, int line, const T& msg) { log(level, file, line, msg); }
-
-    // Logging functions for PrintableOrException types
-    template<PrintableOrException T>
-    void log_exception(LogLevel level, const std::string& file, int line, const T& msg) { log(level, file, line, msg); }
-
-    // Handle exceptions with context
-    void handle_error(const std::exception& e, const std::string& context) {
-        error(context, 0, e.what());
-        log_stack_trace();
-
-        auto it = handlers_.find(typeid(e).name());
-        if (it != handlers_.end()) {
-            it->second(e);
-        } else {
-            default_handler_(e);
-        }
-    }
-
-    // Register error handler for specific exception types
-    void register_error_handler(const std::string& exception_type, std::function<void(const std::exception&)> handler) {
-        handlers_[exception_type] = handler;
-    }
-
-    // Set default error handler
-    void set_default_error_handler(std::function<void(const std::exception&)> handler) {
-        default_handler_ = handler;
-    }
-
-    // Log function with exception safety
-    template<PrintableStringOrIterable T>
-    void log(LogLevel level, const std::string& file, int line, const T& msg) {
-        if (static_cast<int>(level) < LOG_LEVEL) {
-            return;
-        }
-        try {
-            std::ostringstream oss;
-            if constexpr (Iterable<T>) {
-                for (const auto& item : msg) {
-                    oss << item;
-                }
-            } else {
-                oss << msg;
-            }
-            std::string formattedMsg = formatter_(level, file, line, oss.str());
-            std::ostream& logStream = getLogStream();
-
-            std::lock_guard<std::mutex> lock(mutex_);
-
-            logStream << "[";
-            if (check_color(logStream)) {
-                applyLogLevelColor(logStream, level);
-                logStream << logLevelToString(level) << "\033[0m";
-            } else {
-                logStream << logLevelToString(level);
-            }
-            logStream << "] " << formattedMsg << std::endl;
-
-            if (output_mode_ == OutputMode::Both && log_file_.is_open()) {
-                log_file_ << "[" << logLevelToString(level) << "] " << formattedMsg << std::endl;
-            }
-        } catch (const std::exception& e) {
-            std::cerr << "Logging exception: " << e.what() << std::endl;
-        }
-    }
-
-private:
-    // Function to log stack trace
-    void log_stack_trace() {
-        void *array[10];
-        size_t size;
-        size = backtrace(array, 10);
-        char **messages = backtrace_symbols(array, size);
-        std::cerr << "Stack trace:" << std::endl;
-        for (size_t i = 0; i < size; i++) {
-            std::cerr << messages[i] << std::endl;
-        }
-        free(messages);
-    }
-
-    // Convert log level to string
-    std::string logLevelToString(LogLevel level) {
-        static std::unordered_map<LogLevel, std::string> defaultMessages = {
-            {LogLevel::debug, "DEBUG"},
-            {LogLevel::info, "INFO"},
-            {LogLevel::warn, "WARNING"},
-            {LogLevel::error, "ERROR"},
-            {LogLevel::fatal, "FATAL"},
-            {LogLevel::trace, "TRACE"},
-            {LogLevel::unknown, "UNKNOWN"}
-        };
-        return defaultMessages[level];
-    }
-
-    // Get appropriate log stream based on output mode
-    std::ostream& getLogStream() {
-        if (output_mode_ == OutputMode::File && log_file_.is_open()) {
-            return log_file_;
-        } else if (output_mode_ == OutputMode::Both && log_file_.is_open()) {
-            return log_file_;
-        } else {
-            return std::cerr;
-        }
-    }
-
-    // Apply color to log level based on platform
-    std::ostream& applyLogLevelColor(std::ostream& os, LogLevel level) {
-#if defined(_WIN32) || defined(_WIN64)
-        apply_windows_code(os, log_level_colors_[level].win_attr);
-#else
-        apply_code(os, log_level_colors_[level].code);
+#if !COLORLOG_CXX20
+#error "colorlog.hpp requires C++20; include colorlog_cpp17.hpp for C++17"
 #endif
-        return os;
-    }
-
-    std::mutex mutex_;  // Mutex for thread safety
-    LogLevel log_level_;  // Current log level
-    OutputMode output_mode_;  // Current output mode
-    LogFormatter formatter_;  // Formatter function
-    std::unordered_map<LogLevel, ColorAttr> log_level_colors_;  // Color definitions for log levels
-    std::ofstream log_file_;  // Log file stream
-    std::unordered_map<std::string, std::function<void(const std::exception&)>> handlers_;  // Exception handlers
-    std::function<void(const std::exception&)> default_handler_;  // Default exception handler
-};
-
-// Asynchronous logger class
-class AsyncLogger {
-public:
-    // Constructor with optional configuration parameter
-    AsyncLogger(const LoggerConfig& config = LoggerConfig())
-        : logger_(config), stop_thread_(false) {
-        worker_thread_ = std::thread(&AsyncLogger::processQueue, this);
-    }
-
-    // Destructor to clean up resources
-    ~AsyncLogger() {
-        {
-            std::lock_guard<std::mutex> lock(queue_mutex_);
-            stop_thread_ = true;
-        }
-        cv_.notify_all();
-        worker_thread_.join();
-    }
-
-    // Asynchronous log function
-    template<PrintableStringOrIterable T>
-    void log(LogLevel level, const std::string& file, int line, const T& msg) {
-        std::lock_guard<std::mutex> lock(queue_mutex_);
-        log_queue_.emplace(level, file, line, msg);
-        cv_.notify_one();
-    }
-
-private:
-    // Process the logging queue
-    void processQueue() {
-        while (true) {
-            std::unique_lock<std::mutex> lock(queue_mutex_);
-            cv_.wait(lock, [this] { return !log_queue_.empty() || stop_thread_; });
-            while (!log_queue_.empty()) {
-                auto& log_entry = log_queue_.front();
-                logger_.log(log_entry.level, log_entry.file, log_entry.line, log_entry.msg);
-                log_queue_.pop();
-            }
-            if (stop_thread_) break;
-        }
-    }
-
-    // Struct to represent a log entry
-    struct LogEntry {
-        LogLevel level;
-        std::string file;
-        int line;
-        std::string msg;
-        LogEntry(LogLevel lvl, const std::string& f, int l, const std::string& m)
-            : level(lvl), file(f), line(l), msg(m) {}
-    };
-
-    Logger logger_;  // Logger instance
-    std::thread worker_thread_;  // Worker thread for processing the queue
-    std::queue<LogEntry> log_queue_;  // Queue to store log entries
-    std::mutex queue_mutex_;  // Mutex for protecting the queue
-    std::condition_variable cv_;  // Condition variable for queue processing
-    std::atomic<bool> stop_thread_;  // Flag to stop the worker thread
-};
-
-// Factory class for creating logger instances
-class LoggerFactory {
-public:
-    // Create a synchronous logger
-    static Logger createLogger(const LoggerConfig& config = LoggerConfig()) {
-        return Logger(config);
-    }
-    // Create an asynchronous logger
-    static AsyncLogger createAsyncLogger(const LoggerConfig& config = LoggerConfig()) {
-        return AsyncLogger(config);
-    }
-};
-
-} // namespace colorlog
 
 #endif // COLORLOG_HPP_
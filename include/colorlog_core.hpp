@@ -0,0 +1,6431 @@
+// File: colorlog_core.hpp
+//
+// Implementation shared by colorlog.hpp (C++20) and colorlog_cpp17.hpp (C++17): queues, buffers,
+// sinks and the formatting engine. Include one of those two headers rather than this one. A
+// C++20 build also gets concepts, awaitable flushes and compile-time checked format strings.
+
+#ifndef COLORLOG_CORE_HPP_
+#define COLORLOG_CORE_HPP_
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <exception>
+#include <typeinfo>
+#include <fstream>
+#include <thread>
+#include <condition_variable>
+#include <atomic>
+#include <optional>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <new>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <chrono>
+#include <cstdlib>
+#include <limits>
+#include <cstring>
+#include <cstdio>
+#include <streambuf>
+#include <algorithm>
+#include <unordered_set>
+#include <deque>
+#include <vector>
+#include <filesystem>
+#include <ctime>
+#include <cerrno>
+#include <execinfo.h>
+#include <charconv>
+
+// C++20 builds get concepts, awaitable flushes and compile-time checked format strings; the rest
+// of the core builds as C++17
+#if __cplusplus >= 202002L || (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L)
+#define COLORLOG_CXX20 1
+#include <concepts>
+#include <coroutine>
+#else
+#define COLORLOG_CXX20 0
+#endif
+
+// The type constraints below are concepts in C++20 and bool variable templates in C++17, so both
+// can be used in expressions. Constrained templates name them through COLORLOG_CONSTRAINED (one
+// parameter), COLORLOG_CONSTRAINED_PACK (a pack) and COLORLOG_TEMPLATE_PACK_IF (a pack with an
+// extra requirement), which become type-constraints and requires-clauses in C++20 and an
+// enable_if parameter in C++17
+#if COLORLOG_CXX20
+#define COLORLOG_CONCEPT concept
+#define COLORLOG_CONSTRAINED(C, T) C T
+#define COLORLOG_CONSTRAINED_PACK(C, Ts) C... Ts
+#define COLORLOG_TEMPLATE_PACK_IF(C, Ts, ...) template <C... Ts> requires(__VA_ARGS__)
+#define COLORLOG_CONSTINIT constinit
+#else
+#define COLORLOG_CONCEPT inline constexpr bool
+#define COLORLOG_CONSTRAINED(C, T) typename T, std::enable_if_t<C<T>, int> = 0
+#define COLORLOG_CONSTRAINED_PACK(C, Ts) typename... Ts, std::enable_if_t<(C<Ts> && ...), int> = 0
+#define COLORLOG_TEMPLATE_PACK_IF(C, Ts, ...) template <typename... Ts, std::enable_if_t<(C<Ts> && ...) && (__VA_ARGS__), int> = 0>
+#define COLORLOG_CONSTINIT
+#endif
+
+// Concepts for type constraints
+
+// Define Arithmetic concept first
+/// Concept to check if a type is arithmetic (e.g., int, float).
+template <typename T>
+COLORLOG_CONCEPT Arithmetic = std::is_arithmetic_v<T>;
+
+// Helper traits for type checks
+
+/// Trait to check if a type can be printed to an ostream.
+template <typename T, typename = void>
+struct is_printable : std::false_type {};
+
+template <typename T>
+struct is_printable<T, std::void_t<decltype(std::declval<std::ostream&>() << std::declval<T>())>> : std::true_type {};
+
+template <typename T>
+inline constexpr bool is_printable_v = is_printable<T>::value;
+
+/// Trait to check if a type is iterable.
+template <typename T, typename = void>
+struct is_iterable : std::false_type {};
+
+template <typename T>
+struct is_iterable<T, std::void_t<decltype(std::declval<T>().begin()), decltype(std::declval<T>().end())>> : std::true_type {};
+
+template <typename T>
+inline constexpr bool is_iterable_v = is_iterable<T>::value;
+
+/// Trait to check if a type has a value_type member.
+template <typename T, typename = void>
+struct has_value_type : std::false_type {};
+
+template <typename T>
+struct has_value_type<T, std::void_t<typename T::value_type>> : std::true_type {};
+
+template <typename T>
+inline constexpr bool has_value_type_v = has_value_type<T>::value;
+
+/// Trait to check if a type is a string.
+template <typename T>
+struct is_string : std::is_same<T, std::string> {};
+
+template <typename T>
+inline constexpr bool is_string_v = is_string<T>::value;
+
+/// Concept to check if a type can be printed to an ostream.
+template <typename T>
+COLORLOG_CONCEPT Printable = is_printable_v<T>;
+
+/// Concept to check if a type is iterable.
+template <typename T>
+COLORLOG_CONCEPT Iterable = is_iterable_v<T>;
+
+namespace colorlog {
+
+class FormatBuffer;
+
+/// Customization point for "{}" format arguments: specialize with
+/// `static void format(FormatBuffer& out, const T& value)` to append T without going through operator<<.
+template <typename T>
+struct formatter {};
+
+template <typename It>
+struct RangeView;
+
+} // namespace colorlog
+
+#if COLORLOG_CXX20
+/// Concept to check if a type has a colorlog::formatter specialization.
+template <typename T>
+concept HasFormatter = requires(colorlog::FormatBuffer& out, const T& value) {
+    colorlog::formatter<T>::format(out, value);
+};
+#else
+/// Trait to check if a type has a colorlog::formatter specialization.
+template <typename T, typename = void>
+struct has_formatter : std::false_type {};
+
+template <typename T>
+struct has_formatter<T, std::void_t<decltype(colorlog::formatter<T>::format(std::declval<colorlog::FormatBuffer&>(),
+                                                                            std::declval<const T&>()))>>
+    : std::true_type {};
+
+template <typename T>
+inline constexpr bool HasFormatter = has_formatter<T>::value;
+#endif
+
+/// Concept to check if a type can be a format argument: printable or with a colorlog::formatter.
+template <typename T>
+COLORLOG_CONCEPT Formattable = Printable<T> || HasFormatter<T>;
+
+#if COLORLOG_CXX20
+/// Concept to check if a type is a string or an iterable of printable elements.
+template <typename T>
+concept StringOrIterableOfPrintable = is_string_v<T> || 
+                                      (is_iterable_v<T> && has_value_type_v<T> && Printable<typename T::value_type>);
+#else
+/// Trait to check if a type is an iterable of printable elements.
+template <typename T, typename = void>
+struct is_iterable_of_printable : std::false_type {};
+
+template <typename T>
+struct is_iterable_of_printable<T, std::enable_if_t<is_iterable_v<T> && has_value_type_v<T>>>
+    : is_printable<typename T::value_type> {};
+
+template <typename T>
+inline constexpr bool StringOrIterableOfPrintable = is_string_v<T> || is_iterable_of_printable<T>::value;
+#endif
+
+/// Concept to check if a type is printable, a string, or an iterable of printable elements.
+/// Callables are excluded so that they select the lazy overloads instead.
+template <typename T>
+COLORLOG_CONCEPT PrintableStringOrIterable = !std::is_invocable_v<const T&> &&
+                                             ((Printable<T> && !Arithmetic<T>) || StringOrIterableOfPrintable<T>);
+
+#if COLORLOG_CXX20
+/// Concept to check if a type is a callable producing a loggable message (evaluated lazily).
+template <typename F>
+concept LazyMessage = std::is_invocable_v<F&> &&
+                      PrintableStringOrIterable<std::remove_cvref_t<std::invoke_result_t<F&>>>;
+
+/// Concept to check if a type is an optional of printable elements.
+template <typename T>
+concept PrintableOptional = requires(T t) {
+    { t.value() } -> Printable;
+};
+#else
+/// Trait to check if a type is a callable producing a loggable message (evaluated lazily).
+template <typename F, typename = void>
+struct is_lazy_message : std::false_type {};
+
+template <typename F>
+struct is_lazy_message<F, std::enable_if_t<std::is_invocable_v<F&>>>
+    : std::bool_constant<PrintableStringOrIterable<std::remove_cv_t<std::remove_reference_t<std::invoke_result_t<F&>>>>> {};
+
+template <typename F>
+inline constexpr bool LazyMessage = is_lazy_message<F>::value;
+
+/// Trait to check if a type is an optional of printable elements.
+template <typename T, typename = void>
+struct is_printable_optional : std::false_type {};
+
+template <typename T>
+struct is_printable_optional<T, std::void_t<decltype(std::declval<T&>().value())>>
+    : is_printable<decltype(std::declval<T&>().value())> {};
+
+template <typename T>
+inline constexpr bool PrintableOptional = is_printable_optional<T>::value;
+#endif
+
+/// Concept to check if a type is printable, a string, an iterable of printable elements, or an optional of printable elements.
+template <typename T>
+COLORLOG_CONCEPT PrintableStringOrIterableOrOptional = PrintableStringOrIterable<T> || PrintableOptional<T>;
+
+/// Concept to check if a type is printable or an exception.
+template <typename T>
+COLORLOG_CONCEPT PrintableOrException = (Printable<T> && !Arithmetic<T>) || std::is_base_of_v<std::exception, T>;
+
+#if defined(_WIN32) || defined(_WIN64)
+    #include <io.h>
+    #include <windows.h>
+    #define ISATTY _isatty
+    #define FILENO _fileno
+#else
+    #include <unistd.h>
+    #include <fcntl.h>
+    #include <spawn.h>
+    #include <sys/mman.h>
+    #include <sys/wait.h>
+    #include <pthread.h>
+    #include <sched.h>
+    #include <signal.h>
+    #include <poll.h>
+    #include <netdb.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <sys/socket.h>
+    #define ISATTY ::isatty
+    #define FILENO ::fileno
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+    #define COLORLOG_HAS_TSC 1
+#elif defined(_M_X64) || defined(_M_IX86)
+    #include <intrin.h>
+    #define COLORLOG_HAS_TSC 1
+#endif
+
+// Define log levels
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_FATAL 4
+#define LOG_LEVEL_TRACE 5
+
+// Default log level
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+// Static colorlog::CallSite for the current source location, created once per expansion
+#define COLORLOG_CALL_SITE(level, fmt) \
+    ([]() -> const colorlog::CallSite& { \
+        static constexpr colorlog::CallSite colorlog_site{__FILE__, __LINE__, level, fmt, \
+                                                          colorlog::binary::site_id(__FILE__, __LINE__, fmt)}; \
+        return colorlog_site; \
+    }())
+
+// Log through an explicit logger; the message expression is only evaluated once the level check
+// and the level's sampling (LoggerConfig::sampling) pass
+#define COLORLOG_LOG(logger, level, msg) \
+    do { if ((logger).should_log(level) && (logger).sample(level)) (logger).log(COLORLOG_CALL_SITE(level, "{}"), msg); } while (0)
+
+// Log a "{}" format string literal plus arguments through an explicit logger, formatting only if the level is enabled
+#define COLORLOG_LOGF(logger, level, fmt, ...) \
+    do { if ((logger).should_log(level) && (logger).sample(level)) (logger).logf(COLORLOG_CALL_SITE(level, fmt) __VA_OPT__(,) __VA_ARGS__); } while (0)
+
+// Per-thread counter of one sampled call site
+#define COLORLOG_SITE_COUNTER() \
+    ([]() -> uint32_t& { thread_local uint32_t colorlog_count = 0; return colorlog_count; }())
+
+// Like COLORLOG_LOG and COLORLOG_LOGF, keeping only one record in `one_in` from this call site (per thread);
+// kept records carry the combined sample rate. For Logger and AsyncLogger
+#define COLORLOG_LOG_SAMPLED(logger, level, one_in, msg) \
+    do { if ((logger).should_log(level) && (logger).sample(level, COLORLOG_SITE_COUNTER(), one_in)) \
+        (logger).log(COLORLOG_CALL_SITE(level, "{}"), msg); } while (0)
+#define COLORLOG_LOGF_SAMPLED(logger, level, one_in, fmt, ...) \
+    do { if ((logger).should_log(level) && (logger).sample(level, COLORLOG_SITE_COUNTER(), one_in)) \
+        (logger).logf(COLORLOG_CALL_SITE(level, fmt) __VA_OPT__(,) __VA_ARGS__); } while (0)
+
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(msg) COLORLOG_LOG(colorlog::LoggerFactory::instance(), colorlog::LogLevel::debug, msg)
+#define LOG_DEBUGF(...) COLORLOG_LOGF(colorlog::LoggerFactory::instance(), colorlog::LogLevel::debug, __VA_ARGS__)
+#define LOG_DEBUG_SAMPLED(one_in, msg) \
+    COLORLOG_LOG_SAMPLED(colorlog::LoggerFactory::instance(), colorlog::LogLevel::debug, one_in, msg)
+#else
+#define LOG_DEBUG(msg)
+#define LOG_DEBUGF(...)
+#define LOG_DEBUG_SAMPLED(one_in, msg)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(msg) COLORLOG_LOG(colorlog::LoggerFactory::instance(), colorlog::LogLevel::info, msg)
+#define LOG_INFOF(...) COLORLOG_LOGF(colorlog::LoggerFactory::instance(), colorlog::LogLevel::info, __VA_ARGS__)
+#else
+#define LOG_INFO(msg)
+#define LOG_INFOF(...)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(msg) COLORLOG_LOG(colorlog::LoggerFactory::instance(), colorlog::LogLevel::warn, msg)
+#define LOG_WARNF(...) COLORLOG_LOGF(colorlog::LoggerFactory::instance(), colorlog::LogLevel::warn, __VA_ARGS__)
+#else
+#define LOG_WARN(msg)
+#define LOG_WARNF(...)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(msg) COLORLOG_LOG(colorlog::LoggerFactory::instance(), colorlog::LogLevel::error, msg)
+#define LOG_ERRORF(...) COLORLOG_LOGF(colorlog::LoggerFactory::instance(), colorlog::LogLevel::error, __VA_ARGS__)
+#else
+#define LOG_ERROR(msg)
+#define LOG_ERRORF(...)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_FATAL
+#define LOG_FATAL(msg) COLORLOG_LOG(colorlog::LoggerFactory::instance(), colorlog::LogLevel::fatal, msg)
+#define LOG_FATALF(...) COLORLOG_LOGF(colorlog::LoggerFactory::instance(), colorlog::LogLevel::fatal, __VA_ARGS__)
+#else
+#define LOG_FATAL(msg)
+#define LOG_FATALF(...)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_TRACE
+#define LOG_TRACE(msg) COLORLOG_LOG(colorlog::LoggerFactory::instance(), colorlog::LogLevel::trace, msg)
+#define LOG_TRACEF(...) COLORLOG_LOGF(colorlog::LoggerFactory::instance(), colorlog::LogLevel::trace, __VA_ARGS__)
+#define LOG_TRACE_SAMPLED(one_in, msg) \
+    COLORLOG_LOG_SAMPLED(colorlog::LoggerFactory::instance(), colorlog::LogLevel::trace, one_in, msg)
+#else
+#define LOG_TRACE(msg)
+#define LOG_TRACEF(...)
+#define LOG_TRACE_SAMPLED(one_in, msg)
+#endif
+
+namespace colorlog {
+
+// Global flag to enable/disable colored output
+bool is_global_colored = true;
+
+// TerminalCache class for caching terminal information. Whether a file descriptor gets colors is
+// decided once, from isatty() and the NO_COLOR, CLICOLOR_FORCE and TERM environment variables:
+// NO_COLOR set to a non-empty value disables colors, CLICOLOR_FORCE set to a non-empty value
+// other than "0" enables them even when the output is not a terminal, and TERM=dumb disables them
+class TerminalCache {
+public:
+    // Singleton pattern for single instance
+    static TerminalCache& instance() {
+        static TerminalCache instance;
+        return instance;
+    }
+
+    // Check if colors should be written to the given output stream; std::cout, std::cerr and
+    // std::clog are known, other streams have no descriptor and are never colored
+    bool is_terminal(std::ostream* os) const { return is_terminal(fd_of(os)); }
+
+    // Check if colors should be written to a file descriptor; the standard ones are cached
+    bool is_terminal(int fd) const {
+        if (fd < 0) return false;
+        if (fd < std_fd_count) return std_fds_[fd];
+        return colors_for(fd);
+    }
+
+    // File descriptor behind a standard stream, or -1
+    static int fd_of(const std::ostream* os) {
+        if (os == &std::cout) return FILENO(stdout);
+        if (os == &std::cerr || os == &std::clog) return FILENO(stderr);
+        return -1;
+    }
+
+#if defined(_WIN32) || defined(_WIN64)
+    // Console handle behind a standard stream, looked up once
+    HANDLE console_handle(const std::ostream* os) const {
+        return os == &std::cout ? stdout_handle_ : stderr_handle_;
+    }
+#endif
+
+private:
+    // Private constructor for singleton
+    TerminalCache() {
+        const char* no_color = std::getenv("NO_COLOR");
+        const char* force = std::getenv("CLICOLOR_FORCE");
+        const char* term = std::getenv("TERM");
+        if (no_color != nullptr && no_color[0] != '\0') {
+            env_ = Env::Never;
+        } else if (force != nullptr && force[0] != '\0' && std::strcmp(force, "0") != 0) {
+            env_ = Env::Always;
+        } else if (term != nullptr && std::strcmp(term, "dumb") == 0) {
+            env_ = Env::Never;
+        }
+        for (int fd = 0; fd < std_fd_count; ++fd) {
+            std_fds_[fd] = colors_for(fd);
+        }
+#if defined(_WIN32) || defined(_WIN64)
+        stdout_handle_ = GetStdHandle(STD_OUTPUT_HANDLE);
+        stderr_handle_ = GetStdHandle(STD_ERROR_HANDLE);
+#endif
+    }
+
+    bool colors_for(int fd) const {
+        if (env_ != Env::Auto) return env_ == Env::Always;
+        return ISATTY(fd) != 0;
+    }
+
+    enum class Env { Auto, Always, Never };
+    Env env_ = Env::Auto;  // Override from the environment
+    static constexpr int std_fd_count = 3;
+    bool std_fds_[std_fd_count] = {};  // Colors for stdin, stdout and stderr
+#if defined(_WIN32) || defined(_WIN64)
+    HANDLE stdout_handle_;  // Console handle of std::cout
+    HANDLE stderr_handle_;  // Console handle of std::cerr and std::clog
+#endif
+};
+
+// Check if color should be applied to the given stream
+inline bool check_color(std::ostream& stream) {
+    return is_global_colored && TerminalCache::instance().is_terminal(&stream);
+}
+
+#if defined(_WIN32) || defined(_WIN64)
+// Apply color code for Windows systems
+inline void apply_windows_code(std::ostream& stream, WORD attr) {
+    if (check_color(stream)) {
+        HANDLE hConsole = TerminalCache::instance().console_handle(&stream);
+        if (hConsole != INVALID_HANDLE_VALUE) {
+            SetConsoleTextAttribute(hConsole, attr);
+        }
+    }
+}
+#endif
+
+// Apply color code for non-Windows systems
+inline void apply_code(std::ostream& stream, const std::string& code) {
+    if (check_color(stream)) {
+        stream << code;
+    }
+}
+
+// Structure to hold color attributes
+struct ColorAttr {
+    std::string code;  // ANSI color code
+#if defined(_WIN32) || defined(_WIN64)
+    WORD win_attr;     // Windows color attribute
+#endif
+};
+
+// Enumeration for log levels
+enum class LogLevel { debug, info, warn, error, fatal, trace, unknown };
+// Number of LogLevel values, for flat per-level tables
+inline constexpr size_t log_level_count = 7;
+// Enumeration for output modes (Binary writes compact records to the log file, see binary::Reader)
+enum class OutputMode { Console, File, Both, Binary, Mapped, Json };
+// Enumeration for when buffered output is flushed to the OS
+enum class FlushPolicy {
+    Always,    // Flush after every message
+    Never,     // Leave flushing to the stream buffer (and flush())
+    EveryN,    // Flush after every flush_every_n messages
+    Interval   // Flush when flush_interval has elapsed; the AsyncLogger worker also flushes idle output
+};
+// Enumeration for what AsyncLogger does when its ring is full
+enum class OverflowPolicy {
+    Block,       // Producer waits for a free slot (backpressure)
+    DropNewest,  // Discard the message being logged
+    DropOldest,  // Evict the oldest queued message to make room
+    Sample       // Above the sampling threshold keep messages with a per-level probability, drop newest when full
+};
+// Enumeration for how rotated log files are compressed
+enum class Compression { None, Gzip, Zstd };
+// Enumeration for the clock records are timestamped with
+enum class ClockSource {
+    System,  // std::chrono::system_clock
+    Coarse,  // CLOCK_REALTIME_COARSE on Linux: cheaper, resolution of a scheduler tick; System elsewhere
+    Tsc      // CPU timestamp counter calibrated against the system clock on first use (x86; System elsewhere)
+};
+// Enumeration for the timestamp written in front of text records
+enum class TimestampFormat {
+    None,          // No timestamp
+    Seconds,       // "YYYY-MM-DD HH:MM:SS"
+    Milliseconds,  // "YYYY-MM-DD HH:MM:SS.mmm"
+    Microseconds,  // "YYYY-MM-DD HH:MM:SS.uuuuuu"
+    Nanoseconds    // "YYYY-MM-DD HH:MM:SS.nnnnnnnnn"
+};
+// Enumeration for how AsyncLogger shards (worker_count > 1) write their records
+enum class ShardOrdering {
+    Merged,   // One merge thread interleaves the shards' batches by timestamp into the shared sinks
+    PerShard  // Each shard writes unordered to its own sinks; default log files get a ".shardN" suffix
+};
+
+// Predefined color attributes for each log level
+struct ColorDefs {
+    static const ColorAttr debug;
+    static const ColorAttr info;
+    static const ColorAttr warn;
+    static const ColorAttr error;
+    static const ColorAttr fatal;
+    static const ColorAttr trace;
+    static const ColorAttr unknown;
+};
+
+#if defined(_WIN32) || defined(_WIN64)
+const ColorAttr ColorDefs::debug = {"\033[36m", FOREGROUND_GREEN | FOREGROUND_BLUE};
+const ColorAttr ColorDefs::info = {"\033[1;33m", FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_INTENSITY};
+const ColorAttr ColorDefs::warn = {"\033[33m", FOREGROUND_RED | FOREGROUND_GREEN};
+const ColorAttr ColorDefs::error = {"\033[1;31m", FOREGROUND_RED | FOREGROUND_INTENSITY};
+const ColorAttr ColorDefs::fatal = {"\033[35m", FOREGROUND_RED | FOREGROUND_BLUE};
+const ColorAttr ColorDefs::trace = {"\033[32m", FOREGROUND_GREEN};
+const ColorAttr ColorDefs::unknown = {"\033[34m", FOREGROUND_BLUE};
+#else
+const ColorAttr ColorDefs::debug = {"\033[36m"};
+const ColorAttr ColorDefs::info = {"\033[1;33m"};
+const ColorAttr ColorDefs::warn = {"\033[33m"};
+const ColorAttr ColorDefs::error = {"\033[1;31m"};
+const ColorAttr ColorDefs::fatal = {"\033[35m"};
+const ColorAttr ColorDefs::trace = {"\033[32m"};
+const ColorAttr ColorDefs::unknown = {"\033[34m"};
+#endif
+
+// Growable character buffer with fixed inline storage. Only messages longer than
+// inline_capacity spill to the heap, and the spill is kept for reuse after clear().
+class FormatBuffer {
+public:
+    static constexpr size_t inline_capacity = 512;
+
+    FormatBuffer() = default;
+    FormatBuffer(const FormatBuffer&) = delete;
+    FormatBuffer& operator=(const FormatBuffer&) = delete;
+
+    void append(const char* data, size_t size) {
+        if (size_ + size > capacity_) {
+            grow(size_ + size);
+        }
+        std::memcpy(data_ + size_, data, size);
+        size_ += size;
+    }
+
+    void append(std::string_view text) { append(text.data(), text.size()); }
+
+    void push_back(char c) {
+        if (size_ == capacity_) {
+            grow(size_ + 1);
+        }
+        data_[size_++] = c;
+    }
+
+    void clear() { size_ = 0; }
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    std::string_view view() const { return std::string_view(data_, size_); }
+
+private:
+    void grow(size_t required) {
+        size_t capacity = capacity_ * 2;
+        while (capacity < required) capacity *= 2;
+        std::unique_ptr<char[]> heap(new char[capacity]);
+        std::memcpy(heap.get(), data_, size_);
+        heap_ = std::move(heap);
+        data_ = heap_.get();
+        capacity_ = capacity;
+    }
+
+    char inline_[inline_capacity];
+    std::unique_ptr<char[]> heap_;
+    char* data_ = inline_;
+    size_t capacity_ = inline_capacity;
+    size_t size_ = 0;
+};
+
+// Type alias for log formatter function
+using LogFormatter = std::function<std::string(LogLevel, const std::string&, int, const std::string&)>;
+
+// Type alias for a formatter that appends the formatted message to a caller-provided buffer
+using LogBufferFormatter = std::function<void(FormatBuffer&, LogLevel, std::string_view, int, std::string_view)>;
+
+// Default formatter: "file:line msg", or just "msg" without a location
+inline void default_format(FormatBuffer& out, LogLevel, std::string_view file, int line, std::string_view msg) {
+    if (!file.empty() && line > 0) {
+        char digits[16];
+        int length = std::snprintf(digits, sizeof(digits), "%d", line);
+        out.append(file);
+        out.push_back(':');
+        out.append(digits, static_cast<size_t>(length));
+        out.push_back(' ');
+    }
+    out.append(msg);
+}
+
+namespace detail {
+
+// Stream a message, concatenating the elements of iterables
+template <typename T>
+void write_message(std::ostream& os, const T& msg) {
+    if constexpr (Iterable<T>) {
+        for (const auto& item : msg) {
+            os << item;
+        }
+    } else {
+        os << msg;
+    }
+}
+
+// Write a literal run of a format string, collapsing "{{" and "}}" escapes
+inline void write_format_literal(std::ostream& os, const char* begin, const char* end) {
+    while (begin < end) {
+        const char* brace = begin;
+        while (brace < end && *brace != '{' && *brace != '}') ++brace;
+        os.write(begin, brace - begin);
+        if (brace == end) return;
+        os.put(*brace);
+        begin = brace + ((brace + 1 < end && brace[1] == *brace) ? 2 : 1);
+    }
+}
+
+// Find the next "{}" placeholder, skipping escaped braces; returns nullptr if there is none
+inline const char* find_placeholder(const char* fmt) {
+    for (const char* p = fmt; *p; ++p) {
+        if ((p[0] == '{' && p[1] == '{') || (p[0] == '}' && p[1] == '}')) {
+            ++p;
+        } else if (p[0] == '{' && p[1] == '}') {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+// Write `fmt` to `os`, replacing each "{}" with the next argument; surplus arguments are ignored
+inline void format_to(std::ostream& os, const char* fmt) {
+    write_format_literal(os, fmt, fmt + std::char_traits<char>::length(fmt));
+}
+
+template <typename Arg, typename... Args>
+void format_to(std::ostream& os, const char* fmt, const Arg& arg, const Args&... args) {
+    const char* placeholder = find_placeholder(fmt);
+    if (placeholder == nullptr) {
+        format_to(os, fmt);
+        return;
+    }
+    write_format_literal(os, fmt, placeholder);
+    os << arg;
+    format_to(os, placeholder + 2, args...);
+}
+
+template <typename It>
+using iter_value_t = std::remove_cv_t<typename std::iterator_traits<It>::value_type>;
+
+#if COLORLOG_CXX20
+template <typename It>
+inline constexpr bool is_contiguous_iterator_v = std::contiguous_iterator<It>;
+#else
+// Without std::contiguous_iterator, pointers and std::vector iterators are the contiguous ones
+template <typename It, typename = void>
+inline constexpr bool is_contiguous_iterator_v = std::is_pointer_v<It>;
+
+template <typename It>
+inline constexpr bool is_contiguous_iterator_v<It, std::enable_if_t<!std::is_pointer_v<It> && !std::is_same_v<iter_value_t<It>, bool>>> =
+    std::is_same_v<It, typename std::vector<iter_value_t<It>>::iterator> ||
+    std::is_same_v<It, typename std::vector<iter_value_t<It>>::const_iterator>;
+#endif
+
+// Whether the AsyncLogger copies the elements of a range into the queued entry, so the worker
+// formats them: contiguous ranges of arithmetic values
+template <typename It>
+inline constexpr bool copies_elements_v = is_contiguous_iterator_v<It> && std::is_arithmetic_v<iter_value_t<It>>;
+
+template <typename T, typename = void>
+inline constexpr bool copies_iterable_v = false;
+
+template <typename T>
+inline constexpr bool copies_iterable_v<T, std::enable_if_t<Iterable<T> && !std::is_convertible_v<const T&, std::string_view>>> =
+    copies_elements_v<decltype(std::begin(std::declval<const T&>()))>;
+
+// Type used to capture a format argument by value; string-like arguments are captured as a view,
+// whose text the AsyncLogger copies into the queued entry
+template <typename T>
+struct capture_type {
+    using type = std::conditional_t<std::is_convertible_v<T, std::string_view>, std::string_view, T>;
+};
+
+// Ranges from join() are captured as a view of their copied elements, or formatted into a string
+template <typename It>
+struct capture_type<RangeView<It>> {
+    using type = std::conditional_t<copies_elements_v<It>, RangeView<const iter_value_t<It>*>, std::string>;
+};
+
+template <typename T>
+using capture_t = typename capture_type<std::decay_t<T>>::type;
+
+// Stream buffer appending into a FormatBuffer, so operator<< writes need no temporary strings
+class FormatStreambuf : public std::streambuf {
+public:
+    void set_target(FormatBuffer* target) { target_ = target; }
+
+protected:
+    int_type overflow(int_type c) override {
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            target_->push_back(traits_type::to_char_type(c));
+        }
+        return traits_type::not_eof(c);
+    }
+
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        target_->append(s, static_cast<size_t>(n));
+        return n;
+    }
+
+private:
+    FormatBuffer* target_ = nullptr;
+};
+
+// std::ostream writing into a FormatBuffer, reset to default formatting state on every use
+class FormatStream {
+public:
+    FormatStream() : stream_(&streambuf_), default_flags_(stream_.flags()) {}
+
+    std::ostream& attach(FormatBuffer& target) {
+        streambuf_.set_target(&target);
+        stream_.clear();
+        stream_.flags(default_flags_);
+        stream_.precision(6);
+        stream_.width(0);
+        stream_.fill(' ');
+        return stream_;
+    }
+
+private:
+    FormatStreambuf streambuf_;
+    std::ostream stream_;
+    std::ios_base::fmtflags default_flags_;
+};
+
+template <typename T>
+inline constexpr bool is_range_view_v = false;
+
+template <typename It>
+inline constexpr bool is_range_view_v<RangeView<It>> = true;
+
+// Append the elements of `view` with put(element), and its separator between them. With
+// max_elements set, only that many are written, followed by " ... (N more)" counting the rest
+// and the view's omitted elements
+template <typename Out, typename It, typename Put>
+void append_range(Out& out, const RangeView<It>& view, Put&& put) {
+    It first = view.first;
+    It last = view.last;
+    size_t omitted = view.omitted;
+    size_t written = 0;
+    for (; first != last; ++first) {
+        if (view.max_elements != 0 && written == view.max_elements) {
+            omitted += static_cast<size_t>(std::distance(first, last));
+            break;
+        }
+        if (written++ != 0) {
+            out.append(view.separator);
+        }
+        put(*first);
+    }
+    if (omitted != 0) {
+        char digits[24];
+        std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), omitted);
+        out.append(" ... (");
+        out.append(digits, static_cast<size_t>(result.ptr - digits));
+        out.append(" more)");
+    }
+}
+
+// Append one value as operator<< with default stream state would print it. Built-in types are
+// converted in place, ranges from join() element by element, types with a colorlog::formatter
+// use it, and anything else streams
+template <typename T>
+void append_value(FormatStream& stream, FormatBuffer& out, const T& value) {
+    if constexpr (is_range_view_v<T>) {
+        append_range(out, value, [&stream, &out](const auto& element) { append_value(stream, out, element); });
+    } else if constexpr (HasFormatter<T>) {
+        formatter<T>::format(out, value);
+    } else if constexpr (std::is_same_v<T, bool>) {
+        out.push_back(value ? '1' : '0');
+    } else if constexpr (std::is_same_v<T, char> || std::is_same_v<T, signed char> || std::is_same_v<T, unsigned char>) {
+        out.push_back(static_cast<char>(value));
+    } else if constexpr (std::is_integral_v<T> || std::is_floating_point_v<T>) {
+        char digits[64];
+        std::to_chars_result result;
+        if constexpr (std::is_integral_v<T>) {
+            result = std::to_chars(digits, digits + sizeof(digits), value);
+        } else {
+            result = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::general, 6);
+        }
+        out.append(digits, static_cast<size_t>(result.ptr - digits));
+    } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+        out.append(std::string_view(value));
+    } else {
+        stream.attach(out) << value;
+    }
+}
+
+// Append a literal run of a format string, collapsing "{{" and "}}" escapes
+template <typename Out>
+void append_format_literal(Out& out, const char* begin, const char* end) {
+    while (begin < end) {
+        const char* brace = begin;
+        while (brace < end && *brace != '{' && *brace != '}') ++brace;
+        out.append(begin, static_cast<size_t>(brace - begin));
+        if (brace == end) return;
+        out.push_back(*brace);
+        begin = brace + ((brace + 1 < end && brace[1] == *brace) ? 2 : 1);
+    }
+}
+
+// Append `fmt` to `out`, replacing each "{}" with the next argument; surplus arguments are ignored.
+// Same output as format_to, without an ostream for built-in and formatter-specialized arguments
+inline void format_into(FormatStream&, FormatBuffer& out, const char* fmt) {
+    append_format_literal(out, fmt, fmt + std::char_traits<char>::length(fmt));
+}
+
+template <typename Arg, typename... Args>
+void format_into(FormatStream& stream, FormatBuffer& out, const char* fmt, const Arg& arg, const Args&... args) {
+    const char* placeholder = find_placeholder(fmt);
+    if (placeholder == nullptr) {
+        format_into(stream, out, fmt);
+        return;
+    }
+    append_format_literal(out, fmt, placeholder);
+    append_value(stream, out, arg);
+    format_into(stream, out, placeholder + 2, args...);
+}
+
+// Number of "{}" placeholders in `fmt`, or -1 if it has a brace that is neither escaped nor a placeholder
+constexpr int count_placeholders(const char* fmt) {
+    int count = 0;
+    for (const char* p = fmt; *p; ++p) {
+        if (p[0] == '{' && p[1] == '}') {
+            ++count;
+            ++p;
+        } else if ((p[0] == '{' && p[1] == '{') || (p[0] == '}' && p[1] == '}')) {
+            ++p;
+        } else if (p[0] == '{' || p[0] == '}') {
+            return -1;
+        }
+    }
+    return count;
+}
+
+// Not constexpr: reaching it while checking a format string makes the check fail to compile
+inline void format_string_does_not_match_arguments() {}
+
+// Append a message to a buffer: string-like messages are copied directly, iterables element by
+// element, and anything else as a single format argument
+template <typename T>
+void append_message(FormatStream& stream, FormatBuffer& out, const T& msg) {
+    if constexpr (std::is_convertible_v<const T&, std::string_view> || !Iterable<T>) {
+        append_value(stream, out, msg);
+    } else {
+        for (const auto& item : msg) {
+            append_value(stream, out, item);
+        }
+    }
+}
+
+// Fixed-buffer text writer for the crash path. It appends without allocating and writes the
+// buffer to a file descriptor with write(2) when it fills up, so it works in a signal handler
+class FdWriter {
+public:
+    explicit FdWriter(int fd) : fd_(fd) {}
+    FdWriter(const FdWriter&) = delete;
+    FdWriter& operator=(const FdWriter&) = delete;
+    ~FdWriter() { flush(); }
+
+    void append(const char* data, size_t size) {
+        while (size > 0) {
+            if (size_ == sizeof(buffer_)) {
+                flush();
+            }
+            size_t chunk = std::min(size, sizeof(buffer_) - size_);
+            std::memcpy(buffer_ + size_, data, chunk);
+            size_ += chunk;
+            data += chunk;
+            size -= chunk;
+        }
+    }
+
+    void append(std::string_view text) { append(text.data(), text.size()); }
+    void push_back(char c) { append(&c, 1); }
+
+    // Append a value as append_value would for built-in and string types and ranges of them.
+    // Anything else would need operator<< or a formatter, which may allocate, and is written as "{?}"
+    template <typename T>
+    void append_value(const T& value) {
+        if constexpr (is_range_view_v<T>) {
+            append_range(*this, value, [this](const auto& element) { append_value(element); });
+        } else if constexpr (std::is_same_v<T, bool>) {
+            push_back(value ? '1' : '0');
+        } else if constexpr (std::is_same_v<T, char> || std::is_same_v<T, signed char> || std::is_same_v<T, unsigned char>) {
+            push_back(static_cast<char>(value));
+        } else if constexpr (std::is_integral_v<T> || std::is_floating_point_v<T>) {
+            char digits[64];
+            std::to_chars_result result;
+            if constexpr (std::is_integral_v<T>) {
+                result = std::to_chars(digits, digits + sizeof(digits), value);
+            } else {
+                result = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::general, 6);
+            }
+            append(digits, static_cast<size_t>(result.ptr - digits));
+        } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+            append(std::string_view(value));
+        } else {
+            append("{?}", 3);
+        }
+    }
+
+    // Append `fmt` with each "{}" replaced by the next argument, as format_into does
+    void format(const char* fmt) {
+        append_format_literal(*this, fmt, fmt + std::char_traits<char>::length(fmt));
+    }
+
+    template <typename Arg, typename... Args>
+    void format(const char* fmt, const Arg& arg, const Args&... args) {
+        const char* placeholder = find_placeholder(fmt);
+        if (placeholder == nullptr) {
+            format(fmt);
+            return;
+        }
+        append_format_literal(*this, fmt, placeholder);
+        append_value(arg);
+        format(placeholder + 2, args...);
+    }
+
+    // Write out the buffered text, retrying interrupted and partial writes
+    void flush() {
+        size_t written = 0;
+        while (written < size_) {
+#if defined(_WIN32) || defined(_WIN64)
+            int n = ::_write(fd_, buffer_ + written, static_cast<unsigned int>(size_ - written));
+#else
+            ssize_t n = ::write(fd_, buffer_ + written, size_ - written);
+#endif
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+            written += static_cast<size_t>(n);
+        }
+        size_ = 0;
+    }
+
+private:
+    int fd_;  // Destination file descriptor
+    char buffer_[4096];  // Pending text
+    size_t size_ = 0;  // Bytes used in buffer_
+};
+
+// Per-thread formatting scratch space reused by every message logged from that thread
+struct FormatScratch {
+    FormatBuffer message;  // Rendered message text
+    FormatStream stream;   // operator<< adapter targeting the message buffer
+    bool in_use = false;   // Set while a message is being formatted (guards against re-entrant logging)
+};
+
+// Borrow the calling thread's scratch space, or a private one if it is already in use
+class ScratchLease {
+public:
+    ScratchLease() {
+        thread_local FormatScratch scratch;
+        if (!scratch.in_use) {
+            scratch_ = &scratch;
+        } else {
+            owned_.reset(new FormatScratch());
+            scratch_ = owned_.get();
+        }
+        scratch_->in_use = true;
+        scratch_->message.clear();
+    }
+
+    ~ScratchLease() { scratch_->in_use = false; }
+
+    ScratchLease(const ScratchLease&) = delete;
+    ScratchLease& operator=(const ScratchLease&) = delete;
+
+    FormatScratch* operator->() const { return scratch_; }
+    FormatScratch* get() const { return scratch_; }
+
+private:
+    FormatScratch* scratch_;
+    std::unique_ptr<FormatScratch> owned_;
+};
+
+} // namespace detail
+
+// Range formatted with a separator and an optional element limit, made by join(). Only the
+// iterators are held: log it before the range changes, or through AsyncLogger, which copies
+// contiguous ranges of arithmetic elements into the queue and formats other ranges up front
+template <typename It>
+struct RangeView {
+    It first;                    // First element
+    It last;                     // End of the range
+    std::string_view separator;  // Written between elements
+    size_t max_elements = 0;     // Elements written before " ... (N more)" (0 writes all)
+    size_t omitted = 0;          // Elements left out before the view was made, added to N
+};
+
+// Format `range` as its elements with `separator` between them, e.g. logf("ids {}", join(ids, ", ", 8))
+template <typename Range>
+auto join(const Range& range, std::string_view separator = ", ", size_t max_elements = 0) {
+    using std::begin;
+    using std::end;
+    return RangeView<decltype(begin(range))>{begin(range), end(range), separator, max_elements, 0};
+}
+
+// Stream a range as format arguments print it, for paths that go through std::ostream
+template <typename It>
+std::ostream& operator<<(std::ostream& os, const RangeView<It>& view) {
+    detail::ScratchLease scratch;
+    detail::append_value(scratch->stream, scratch->message, view);
+    return os.write(scratch->message.data(), static_cast<std::streamsize>(scratch->message.size()));
+}
+
+// Format string checked at compile time against its arguments: the number of "{}" placeholders
+// must equal the number of arguments, and other braces must be escaped as "{{" or "}}". The check
+// needs consteval, so C++17 builds take the string unchecked
+template <typename... Args>
+class BasicFormatString {
+public:
+#if COLORLOG_CXX20
+    template <typename S>
+        requires std::is_convertible_v<const S&, const char*>
+    consteval BasicFormatString(const S& fmt) : fmt_(fmt) {
+        if (detail::count_placeholders(fmt_) != static_cast<int>(sizeof...(Args))) {
+            detail::format_string_does_not_match_arguments();
+        }
+    }
+#else
+    template <typename S, std::enable_if_t<std::is_convertible_v<const S&, const char*>, int> = 0>
+    constexpr BasicFormatString(const S& fmt) : fmt_(fmt) {}
+#endif
+
+    constexpr const char* get() const { return fmt_; }
+
+private:
+    const char* fmt_;  // Validated format string (a string literal)
+};
+
+namespace detail {
+
+template <typename T>
+struct type_identity {
+    using type = T;
+};
+
+} // namespace detail
+
+// Format string type for the arguments `Args`; used as a non-deduced parameter
+template <typename... Args>
+using format_string = BasicFormatString<typename detail::type_identity<Args>::type...>;
+
+namespace detail {
+
+// True for trailing arguments shaped like (line, message), which belong to the (file, line, message) overloads
+template <typename... Args>
+inline constexpr bool is_location_call_v = false;
+
+template <typename Line, typename Msg>
+inline constexpr bool is_location_call_v<Line, Msg> = std::is_same_v<Line, int> && PrintableStringOrIterable<Msg>;
+
+} // namespace detail
+
+// Level names as printed in the "[LEVEL]" prefix
+inline const char* log_level_name(LogLevel level) {
+    static const char* const names[log_level_count] = {"DEBUG", "INFO", "WARNING", "ERROR", "FATAL", "TRACE", "UNKNOWN"};
+    size_t index = static_cast<size_t>(level);
+    return index < log_level_count ? names[index] : names[static_cast<size_t>(LogLevel::unknown)];
+}
+
+namespace detail {
+
+inline uint64_t system_now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+#if defined(COLORLOG_HAS_TSC)
+// Wall-clock time from the CPU timestamp counter. The rate is calibrated once against the
+// system clock (a 10 ms sample, taken by prepare_clock() when a logger using it is built);
+// later clock adjustments are not followed, and an invariant TSC is assumed
+class TscClock {
+public:
+    static const TscClock& instance() {
+        static const TscClock clock;
+        return clock;
+    }
+
+    // A counter read behind the calibration sample (another core's, slightly out of step) gives
+    // the calibration time instead of wrapping around
+    uint64_t now_ns() const {
+        int64_t ticks = static_cast<int64_t>(__rdtsc() - base_ticks_);
+        return base_ns_ + (ticks > 0 ? static_cast<uint64_t>(static_cast<double>(ticks) * ns_per_tick_) : 0);
+    }
+
+private:
+    TscClock() {
+        uint64_t start_ticks = __rdtsc();
+        uint64_t start_ns = system_now_ns();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        base_ticks_ = __rdtsc();
+        base_ns_ = system_now_ns();
+        uint64_t ticks = base_ticks_ - start_ticks;
+        ns_per_tick_ = ticks > 0 ? static_cast<double>(base_ns_ - start_ns) / static_cast<double>(ticks) : 1.0;
+    }
+
+    uint64_t base_ticks_ = 0;  // Counter value at calibration
+    uint64_t base_ns_ = 0;     // System time at calibration
+    double ns_per_tick_ = 1.0;  // Calibrated counter period
+};
+#endif
+
+// Current wall-clock time in nanoseconds since the Unix epoch from the given source
+inline uint64_t clock_now_ns(ClockSource source) {
+    switch (source) {
+    case ClockSource::Coarse: {
+#if defined(CLOCK_REALTIME_COARSE)
+        struct timespec ts;
+        if (clock_gettime(CLOCK_REALTIME_COARSE, &ts) == 0) {
+            return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+        }
+#endif
+        break;
+    }
+    case ClockSource::Tsc:
+#if defined(COLORLOG_HAS_TSC)
+        return TscClock::instance().now_ns();
+#else
+        break;
+#endif
+    case ClockSource::System:
+        break;
+    }
+    return system_now_ns();
+}
+
+// Do the one-time setup of a clock source up front, so that the first record does not pay for it
+inline void prepare_clock(ClockSource source) {
+#if defined(COLORLOG_HAS_TSC)
+    if (source == ClockSource::Tsc) {
+        TscClock::instance();
+    }
+#else
+    (void)source;
+#endif
+}
+
+} // namespace detail
+
+// Append `timestamp_ns` as "YYYY-MM-DD HH:MM:SS" plus the fraction digits of `format`, in local
+// time or UTC. The date and time of day are cached per thread and rendered again only when
+// the second changes, so localtime_r (which takes a lock in glibc) runs at most once a second
+inline void append_timestamp(FormatBuffer& out, uint64_t timestamp_ns, TimestampFormat format, bool utc = false) {
+    if (format == TimestampFormat::None) {
+        return;
+    }
+    struct Cache {
+        int64_t second = -1;
+        bool utc = false;
+        char text[32] = {};
+        size_t length = 0;
+    };
+    thread_local Cache cache;
+    int64_t second = static_cast<int64_t>(timestamp_ns / 1000000000ull);
+    if (second != cache.second || utc != cache.utc) {
+        std::time_t seconds = static_cast<std::time_t>(second);
+        std::tm parts = {};
+#if defined(_WIN32) || defined(_WIN64)
+        utc ? gmtime_s(&parts, &seconds) : localtime_s(&parts, &seconds);
+#else
+        utc ? gmtime_r(&seconds, &parts) : localtime_r(&seconds, &parts);
+#endif
+        cache.length = std::strftime(cache.text, sizeof(cache.text), "%Y-%m-%d %H:%M:%S", &parts);
+        cache.second = second;
+        cache.utc = utc;
+    }
+    out.append(cache.text, cache.length);
+    int digits = format == TimestampFormat::Milliseconds ? 3 : format == TimestampFormat::Microseconds ? 6 :
+                 format == TimestampFormat::Nanoseconds ? 9 : 0;
+    if (digits == 0) {
+        return;
+    }
+    uint32_t fraction = static_cast<uint32_t>(timestamp_ns % 1000000000ull);
+    for (int i = digits; i < 9; ++i) {
+        fraction /= 10;
+    }
+    char text[10];
+    text[0] = '.';
+    for (int i = digits; i > 0; --i) {
+        text[i] = static_cast<char>('0' + fraction % 10);
+        fraction /= 10;
+    }
+    out.append(text, static_cast<size_t>(digits) + 1);
+}
+
+// Append the "[1/N] " tag of a sampled record standing for `weight` records; nothing when unsampled
+inline void append_sample_tag(FormatBuffer& out, uint32_t weight) {
+    if (weight <= 1) {
+        return;
+    }
+    char digits[16];
+    std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), weight);
+    out.append("[1/");
+    out.append(digits, static_cast<size_t>(result.ptr - digits));
+    out.append("] ");
+}
+
+// Key/value fields attached to every record logged on the calling thread while they are in scope
+// (a mapped diagnostic context), e.g. a request id and tenant. The fields are packed into fixed
+// per-thread storage as [u8 key length][key][u8 value length][value]..., so adding one does not
+// allocate and a record captures them all as one blob; AsyncLogger copies the blob into the
+// entry and its worker renders it. Text sinks show the fields as "[key=value ...]" after the
+// level, JSON sinks as the record's "context" object
+class LogContext {
+public:
+    static constexpr size_t capacity = 256;    // Bytes of packed fields per thread; values are cut to fit, fields whose key does not fit are left out
+    static constexpr size_t max_length = 255;  // Longer keys and values are truncated
+
+    // Adds one field for its lifetime. Scopes nest: each removes its field and any added after it
+    class Scope {
+    public:
+        Scope(std::string_view key, std::string_view value) : saved_(stack().size) { push(key, value); }
+
+        template <COLORLOG_CONSTRAINED(Arithmetic, T)>
+        Scope(std::string_view key, T value) : saved_(stack().size) {
+            char digits[64];
+            size_t length = 0;
+            if constexpr (std::is_same_v<T, bool>) {
+                length = value ? 4 : 5;
+                std::memcpy(digits, value ? "true" : "false", length);
+            } else if constexpr (std::is_same_v<T, char> || std::is_same_v<T, signed char> || std::is_same_v<T, unsigned char>) {
+                digits[length++] = static_cast<char>(value);
+            } else if constexpr (std::is_integral_v<T>) {
+                length = static_cast<size_t>(std::to_chars(digits, digits + sizeof(digits), value).ptr - digits);
+            } else {
+                length = static_cast<size_t>(std::to_chars(digits, digits + sizeof(digits), value,
+                                                           std::chars_format::general, 6).ptr - digits);
+            }
+            push(key, std::string_view(digits, length));
+        }
+
+        ~Scope() { stack().size = saved_; }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        static void push(std::string_view key, std::string_view value) {
+            Stack& context = stack();
+            key = key.substr(0, max_length);
+            if (2 + key.size() > capacity - context.size) {
+                return;
+            }
+            value = value.substr(0, std::min(max_length, capacity - context.size - 2 - key.size()));
+            size_t size = 2 + key.size() + value.size();
+            char* out = context.data + context.size;
+            *out++ = static_cast<char>(key.size());
+            std::memcpy(out, key.data(), key.size());
+            out += key.size();
+            *out++ = static_cast<char>(value.size());
+            std::memcpy(out, value.data(), value.size());
+            context.size += size;
+        }
+
+        size_t saved_;  // Size of the packed fields before this one
+    };
+
+    // Packed fields of the calling thread, valid until its context changes
+    static std::string_view current() {
+        const Stack& context = stack();
+        return std::string_view(context.data, context.size);
+    }
+
+    // Call fn(key, value) for each field of a packed context, outermost first
+    template <typename Fn>
+    static void for_each(std::string_view packed, Fn&& fn) {
+        size_t pos = 0;
+        while (pos < packed.size()) {
+            size_t key_length = static_cast<unsigned char>(packed[pos]);
+            std::string_view key = packed.substr(pos + 1, key_length);
+            pos += 1 + key_length;
+            size_t value_length = static_cast<unsigned char>(packed[pos]);
+            std::string_view value = packed.substr(pos + 1, value_length);
+            pos += 1 + value_length;
+            fn(key, value);
+        }
+    }
+
+private:
+    struct Stack {
+        char data[capacity] = {};
+        size_t size = 0;
+    };
+
+    static Stack& stack() {
+        thread_local Stack context;
+        return context;
+    }
+};
+
+// Append a packed context as "[key=value ...] "; nothing when it is empty
+inline void append_context(FormatBuffer& out, std::string_view context) {
+    if (context.empty()) {
+        return;
+    }
+    char separator = '[';
+    LogContext::for_each(context, [&out, &separator](std::string_view key, std::string_view value) {
+        out.push_back(separator);
+        out.append(key);
+        out.push_back('=');
+        out.append(value);
+        separator = ' ';
+    });
+    out.append("] ");
+}
+
+// Metadata captured at the call site and carried with every record
+struct RecordInfo {
+    uint64_t timestamp_ns = 0;  // Nanoseconds since the Unix epoch
+    uint32_t thread_id = 0;     // Small per-process id of the logging thread (1, 2, ...)
+    uint32_t sample_weight = 1; // Records this one stands for when sampled (1 when it was not)
+    const char* component = nullptr;  // Name of the NamedLogger it was logged through, or nullptr
+    std::string_view context;   // Packed LogContext fields; the thread's own until AsyncLogger copies them
+
+    // Capture the current time, thread and log context
+    static RecordInfo capture(ClockSource source = ClockSource::System) {
+        RecordInfo info;
+        info.timestamp_ns = detail::clock_now_ns(source);
+        info.thread_id = current_thread_id();
+        info.context = LogContext::current();
+        return info;
+    }
+
+    static uint32_t current_thread_id() {
+        static std::atomic<uint32_t> next_id{1};
+        thread_local uint32_t id = next_id.fetch_add(1, std::memory_order_relaxed);
+        return id;
+    }
+};
+
+/*
+Binary log format (OutputMode::Binary), native byte order:
+  File header: "CLOGBIN" u8 version, u32 byte-order marker 0x01020304
+  Site record: u8 kind=1, u64 site id, i32 line, u32 file length, file bytes, u32 format length, format bytes
+  Log record:  u8 kind=2, u64 timestamp_ns, u8 level, u32 thread id, u64 site id, u32 payload length, payload
+  Sampled log record: u8 kind=3, u32 sample weight, then the log record fields after its kind
+  Payload:     u8 argument count, then per argument a u8 tag followed by its raw bytes
+               (i64, u64, f64, u8 bool, char, or u32 length plus the bytes of a string)
+A site record is written the first time a (file, line, format) triple appears in a file.
+*/
+namespace binary {
+
+inline constexpr char magic[7] = {'C', 'L', 'O', 'G', 'B', 'I', 'N'};
+inline constexpr uint8_t version = 1;
+inline constexpr uint32_t byte_order_marker = 0x01020304;
+
+enum class RecordKind : uint8_t { site = 1, log = 2, sampled_log = 3 };
+enum class ArgTag : uint8_t { i64 = 1, u64 = 2, f64 = 3, boolean = 4, character = 5, string = 6 };
+
+// Append-only encoder over a reusable byte buffer
+class Writer {
+public:
+    void clear() { buffer_.clear(); }
+    const std::string& data() const { return buffer_; }
+    size_t size() const { return buffer_.size(); }
+
+    template <typename T>
+    void put(T value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        buffer_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void put_bytes(std::string_view bytes) {
+        put(static_cast<uint32_t>(bytes.size()));
+        buffer_.append(bytes.data(), bytes.size());
+    }
+
+    // Overwrite a previously reserved u32 at `offset`
+    void patch_u32(size_t offset, uint32_t value) {
+        std::memcpy(&buffer_[offset], &value, sizeof(value));
+    }
+
+    // Encode one format argument as a tag plus raw bytes; only types without a
+    // raw representation are stringified
+    template <typename T>
+    void put_arg(const T& value) {
+        if constexpr (std::is_same_v<T, bool>) {
+            put(ArgTag::boolean);
+            put(static_cast<uint8_t>(value));
+        } else if constexpr (std::is_same_v<T, char>) {
+            put(ArgTag::character);
+            put(value);
+        } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+            put(ArgTag::i64);
+            put(static_cast<int64_t>(value));
+        } else if constexpr (std::is_integral_v<T>) {
+            put(ArgTag::u64);
+            put(static_cast<uint64_t>(value));
+        } else if constexpr (std::is_floating_point_v<T>) {
+            put(ArgTag::f64);
+            put(static_cast<double>(value));
+        } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+            put(ArgTag::string);
+            put_bytes(std::string_view(value));
+        } else if constexpr (HasFormatter<T>) {
+            FormatBuffer text;
+            formatter<T>::format(text, value);
+            put(ArgTag::string);
+            put_bytes(text.view());
+        } else {
+            detail::ScratchLease scratch;
+            detail::append_message(scratch->stream, scratch->message, value);
+            put(ArgTag::string);
+            put_bytes(scratch->message.view());
+        }
+    }
+
+private:
+    std::string buffer_;
+};
+
+// Stable id for a call site; constexpr so static call sites compute it at compile time
+constexpr uint64_t site_id(std::string_view file, int line, std::string_view format) {
+    uint64_t hash = 1469598103934665603ull;  // FNV-1a
+    auto mix = [&hash](unsigned char byte) {
+        hash ^= byte;
+        hash *= 1099511628211ull;
+    };
+    for (char c : file) mix(static_cast<unsigned char>(c));
+    for (int shift = 0; shift < 32; shift += 8) mix(static_cast<unsigned char>(static_cast<uint32_t>(line) >> shift));
+    for (char c : format) mix(static_cast<unsigned char>(c));
+    return hash;
+}
+
+inline void write_file_header(Writer& writer) {
+    for (char c : magic) writer.put(c);
+    writer.put(version);
+    writer.put(byte_order_marker);
+}
+
+inline void write_site(Writer& writer, uint64_t id, std::string_view file, int line, std::string_view format) {
+    writer.put(RecordKind::site);
+    writer.put(id);
+    writer.put(static_cast<int32_t>(line));
+    writer.put_bytes(file);
+    writer.put_bytes(format);
+}
+
+template <typename... Args>
+void write_log(Writer& writer, const RecordInfo& info, LogLevel level, uint64_t id, const Args&... args) {
+    if (info.sample_weight > 1) {
+        writer.put(RecordKind::sampled_log);
+        writer.put(info.sample_weight);
+    } else {
+        writer.put(RecordKind::log);
+    }
+    writer.put(info.timestamp_ns);
+    writer.put(static_cast<uint8_t>(level));
+    writer.put(info.thread_id);
+    writer.put(id);
+    size_t length_offset = writer.size();
+    writer.put(uint32_t{0});
+    size_t payload_start = writer.size();
+    writer.put(static_cast<uint8_t>(sizeof...(Args)));
+    (writer.put_arg(args), ...);
+    writer.patch_u32(length_offset, static_cast<uint32_t>(writer.size() - payload_start));
+}
+
+// A log record decoded back into text
+struct DecodedRecord {
+    RecordInfo info;
+    LogLevel level = LogLevel::unknown;
+    std::string file;
+    int line = 0;
+    std::string msg;  // Message with the format string applied
+};
+
+// Sequential decoder for files written in OutputMode::Binary
+class Reader {
+public:
+    explicit Reader(std::istream& in) : in_(in) {}
+
+    // Validate the file header; false if this is not a colorlog binary log
+    bool read_header() {
+        char header[sizeof(magic)];
+        uint8_t file_version = 0;
+        uint32_t marker = 0;
+        if (!in_.read(header, sizeof(header)) || !get(file_version) || !get(marker)) return false;
+        return std::equal(header, header + sizeof(header), magic) && file_version == version && marker == byte_order_marker;
+    }
+
+    // Decode the next log record, consuming site records along the way; false at end of input
+    bool next(DecodedRecord& record) {
+        uint8_t kind = 0;
+        while (get(kind)) {
+            if (kind == static_cast<uint8_t>(RecordKind::site)) {
+                uint64_t id = 0;
+                int32_t line = 0;
+                Site site;
+                if (!get(id) || !get(line) || !get_bytes(site.file) || !get_bytes(site.format)) return false;
+                site.line = line;
+                sites_[id] = std::move(site);
+            } else if (kind == static_cast<uint8_t>(RecordKind::log) ||
+                       kind == static_cast<uint8_t>(RecordKind::sampled_log)) {
+                record.info.sample_weight = 1;
+                if (kind == static_cast<uint8_t>(RecordKind::sampled_log) && !get(record.info.sample_weight)) return false;
+                uint8_t level = 0;
+                uint64_t id = 0;
+                uint32_t length = 0;
+                if (!get(record.info.timestamp_ns) || !get(level) || !get(record.info.thread_id) ||
+                    !get(id) || !get(length)) return false;
+                payload_.resize(length);
+                if (length > 0 && !in_.read(&payload_[0], length)) return false;
+                record.level = level < log_level_count ? static_cast<LogLevel>(level) : LogLevel::unknown;
+                auto it = sites_.find(id);
+                if (it == sites_.end()) {
+                    record.file.clear();
+                    record.line = 0;
+                    record.msg = "<unknown call site>";
+                } else {
+                    record.file = it->second.file;
+                    record.line = it->second.line;
+                    record.msg = render(it->second.format);
+                }
+                return true;
+            } else {
+                return false;
+            }
+        }
+        return false;
+    }
+
+private:
+    struct Site {
+        std::string file;
+        int line = 0;
+        std::string format;
+    };
+
+    template <typename T>
+    bool get(T& value) {
+        return static_cast<bool>(in_.read(reinterpret_cast<char*>(&value), sizeof(T)));
+    }
+
+    bool get_bytes(std::string& out) {
+        uint32_t length = 0;
+        if (!get(length)) return false;
+        out.resize(length);
+        return length == 0 || static_cast<bool>(in_.read(&out[0], length));
+    }
+
+    // Apply the site's format string to the arguments in payload_
+    std::string render(const std::string& format) {
+        std::ostringstream oss;
+        size_t pos = 0;
+        auto take = [this, &pos](void* out, size_t size) {
+            if (pos + size > payload_.size()) return false;
+            std::memcpy(out, payload_.data() + pos, size);
+            pos += size;
+            return true;
+        };
+        uint8_t count = 0;
+        take(&count, sizeof(count));
+        const char* fmt = format.c_str();
+        for (uint8_t i = 0; i < count; ++i) {
+            const char* placeholder = detail::find_placeholder(fmt);
+            if (placeholder == nullptr) break;
+            detail::write_format_literal(oss, fmt, placeholder);
+            fmt = placeholder + 2;
+            uint8_t tag = 0;
+            if (!take(&tag, sizeof(tag))) break;
+            switch (static_cast<ArgTag>(tag)) {
+            case ArgTag::i64: { int64_t v = 0; take(&v, sizeof(v)); oss << v; break; }
+            case ArgTag::u64: { uint64_t v = 0; take(&v, sizeof(v)); oss << v; break; }
+            case ArgTag::f64: { double v = 0; take(&v, sizeof(v)); oss << v; break; }
+            case ArgTag::boolean: { uint8_t v = 0; take(&v, sizeof(v)); oss << (v != 0); break; }
+            case ArgTag::character: { char v = 0; take(&v, sizeof(v)); oss << v; break; }
+            case ArgTag::string: {
+                uint32_t length = 0;
+                take(&length, sizeof(length));
+                length = static_cast<uint32_t>(std::min<size_t>(length, payload_.size() - pos));
+                oss.write(payload_.data() + pos, length);
+                pos += length;
+                break;
+            }
+            default:
+                return oss.str() + "<corrupt argument>";
+            }
+        }
+        detail::format_to(oss, fmt);
+        return oss.str();
+    }
+
+    std::istream& in_;
+    std::unordered_map<uint64_t, Site> sites_;
+    std::string payload_;
+};
+
+} // namespace binary
+
+namespace detail {
+
+#if !defined(_WIN32) && !defined(_WIN64)
+// Append-only log file made of preallocated, memory-mapped segments named "<base>.0", "<base>.1", ...
+// Appends are a memcpy into the mapping; a syscall is only made when a segment fills up or on sync().
+// A closed segment is truncated to the bytes written, but after a crash the unused tail reads as NUL bytes.
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    // Start a new segment after any existing "<base>.N"; the size is rounded up to whole pages
+    bool open(const std::string& base, size_t segment_size) {
+        close();
+        size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        base_ = base;
+        segment_size_ = std::max(page, (segment_size + page - 1) / page * page);
+        index_ = 0;
+        while (::access(segmentPath(index_).c_str(), F_OK) == 0) {
+            ++index_;
+        }
+        return mapSegment();
+    }
+
+    bool is_open() const { return map_ != nullptr; }
+
+    // Copy `size` bytes into the mapping, moving to a new segment when the current one is full.
+    // Records that fit in a segment are never split across two of them
+    void append(const char* data, size_t size) {
+        if (size > segment_size_ - used_ && size <= segment_size_ && !roll()) {
+            return;
+        }
+        while (size > 0 && map_ != nullptr) {
+            if (used_ == segment_size_ && !roll()) {
+                return;
+            }
+            size_t chunk = std::min(size, segment_size_ - used_);
+            std::memcpy(map_ + used_, data, chunk);
+            used_ += chunk;
+            data += chunk;
+            size -= chunk;
+        }
+    }
+
+    // Schedule write-back of the bytes appended since the last sync (MS_ASYNC), or wait for the
+    // bytes not yet waited for (MS_SYNC)
+    void sync(bool wait = false) {
+        size_t& from = wait ? durable_ : synced_;
+        if (map_ == nullptr || used_ == from) {
+            return;
+        }
+        size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        size_t begin = from / page * page;
+        ::msync(map_ + begin, used_ - begin, wait ? MS_SYNC : MS_ASYNC);
+        synced_ = used_;
+        if (wait) {
+            durable_ = used_;
+        }
+    }
+
+    // Unmap the current segment and trim it to the bytes actually written
+    void close() {
+        if (map_ == nullptr) {
+            return;
+        }
+        sync();
+        ::munmap(map_, segment_size_);
+        if (::ftruncate(fd_, static_cast<off_t>(used_)) != 0) {
+            // Keep the zero-filled tail; readers stop at the first NUL byte
+        }
+        ::close(fd_);
+        map_ = nullptr;
+        fd_ = -1;
+    }
+
+    // Path of the segment currently being written
+    std::string current_path() const { return segmentPath(index_); }
+
+private:
+    std::string segmentPath(size_t index) const { return base_ + "." + std::to_string(index); }
+
+    // A finished segment is synced before it is unmapped, so sync(true) never has to go back to it
+    bool roll() {
+        sync(true);
+        close();
+        ++index_;
+        return mapSegment();
+    }
+
+    bool mapSegment() {
+        used_ = 0;
+        synced_ = 0;
+        durable_ = 0;
+        fd_ = ::open(segmentPath(index_).c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd_ < 0) {
+            return false;
+        }
+#if defined(__linux__)
+        // Reserve the blocks up front, so a full disk fails here instead of as SIGBUS on a later memcpy
+        bool sized = ::posix_fallocate(fd_, 0, static_cast<off_t>(segment_size_)) == 0;
+#else
+        bool sized = ::ftruncate(fd_, static_cast<off_t>(segment_size_)) == 0;
+#endif
+        void* map = sized ? ::mmap(nullptr, segment_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0) : MAP_FAILED;
+        if (map == MAP_FAILED) {
+            ::close(fd_);
+            fd_ = -1;
+            return false;
+        }
+        map_ = static_cast<char*>(map);
+        return true;
+    }
+
+    std::string base_;  // Segment path prefix
+    size_t segment_size_ = 0;  // Bytes per segment
+    size_t index_ = 0;  // Index of the current segment
+    int fd_ = -1;  // Descriptor of the current segment
+    char* map_ = nullptr;  // Mapping of the current segment
+    size_t used_ = 0;  // Bytes written to the current segment
+    size_t synced_ = 0;  // Bytes already passed to msync
+    size_t durable_ = 0;  // Bytes already synced with MS_SYNC
+};
+#endif
+
+#if !defined(_WIN32) && !defined(_WIN64)
+// The process environment, handed to the compression tool. POSIX leaves its declaration to the
+// program; with C linkage this one names the global ::environ even though it sits in this
+// namespace, and every translation unit including this header sees it as colorlog::detail::environ
+extern "C" char** environ;
+#endif
+
+// Names rotated log files and compresses and prunes them on a low-priority background thread.
+// Rotated files are named "<base>.YYYYmmdd-HHMMSS.uuuuuu" (UTC), so they sort oldest first and
+// never have to be renamed again while the background thread works on them
+class LogRotator {
+public:
+    LogRotator(size_t keep, Compression compression)
+        : keep_(keep), compression_(compression), worker_(&LogRotator::run, this) {}
+
+    LogRotator(const LogRotator&) = delete;
+    LogRotator& operator=(const LogRotator&) = delete;
+
+    // Finish the queued work, then stop
+    ~LogRotator() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_one();
+        worker_.join();
+    }
+
+    // A new, unused name for the next rotation of `base`
+    std::string next_name(const std::string& base) {
+        int64_t now = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        last_stamp_ = std::max(now, last_stamp_ + 1);
+        std::time_t seconds = static_cast<std::time_t>(last_stamp_ / 1000000);
+        std::tm utc{};
+#if defined(_WIN32) || defined(_WIN64)
+        gmtime_s(&utc, &seconds);
+#else
+        gmtime_r(&seconds, &utc);
+#endif
+        char stamp[32];
+        std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &utc);
+        // ".uuuuuu": the remainder is below 1000000, so it takes at most six digits
+        uint32_t fraction = static_cast<uint32_t>(last_stamp_ % 1000000);
+        char digits[8];
+        size_t length = static_cast<size_t>(std::to_chars(digits, digits + sizeof(digits), fraction).ptr - digits);
+        char micros[8] = {'.', '0', '0', '0', '0', '0', '0', '\0'};
+        std::memcpy(micros + 7 - length, digits, length);
+        return base + "." + stamp + micros;
+    }
+
+    // Queue a freshly rotated file for compression and pruning of the oldest rotations of `base`
+    void submit(const std::string& rotated, const std::string& base) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.push_back({rotated, base});
+        }
+        cv_.notify_one();
+    }
+
+private:
+    struct Task {
+        std::string rotated;
+        std::string base;
+    };
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            cv_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+            if (tasks_.empty()) {
+                return;
+            }
+            Task task = std::move(tasks_.front());
+            tasks_.pop_front();
+            lock.unlock();
+            compress(task.rotated);
+            prune(task.base);
+            lock.lock();
+        }
+    }
+
+    // Compress with the gzip or zstd tool at the lowest CPU priority. The tool is started through
+    // nice(1), so it never runs at normal priority; the file is left as is if either is missing
+    void compress(const std::string& path) {
+#if !defined(_WIN32) && !defined(_WIN64)
+        if (compression_ == Compression::None) {
+            return;
+        }
+        const char* gzip_argv[] = {"nice", "-n", "19", "gzip", "-f", "-q", path.c_str(), nullptr};
+        const char* zstd_argv[] = {"nice", "-n", "19", "zstd", "-f", "-q", "--rm", path.c_str(), nullptr};
+        char* const* argv = const_cast<char* const*>(compression_ == Compression::Gzip ? gzip_argv : zstd_argv);
+        pid_t pid;
+        if (::posix_spawnp(&pid, argv[0], nullptr, nullptr, argv, environ) != 0) {
+            return;
+        }
+        int status;
+        while (::waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+#else
+        (void)path;
+#endif
+    }
+
+    // Delete the oldest rotated files of `base` (compressed or not) beyond the retention count
+    void prune(const std::string& base) {
+        namespace fs = std::filesystem;
+        fs::path base_path(base);
+        fs::path dir = base_path.has_parent_path() ? base_path.parent_path() : fs::path(".");
+        std::string prefix = base_path.filename().string() + ".";
+        std::vector<fs::path> rotated;
+        std::error_code ec;
+        for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+            std::string name = it->path().filename().string();
+            // "<prefix>YYYYmmdd-HHMMSS.uuuuuu" optionally followed by a compression extension
+            if (name.size() >= prefix.size() + 22 && name.compare(0, prefix.size(), prefix) == 0 &&
+                name[prefix.size() + 8] == '-' && name[prefix.size() + 15] == '.') {
+                rotated.push_back(it->path());
+            }
+        }
+        std::sort(rotated.begin(), rotated.end());
+        for (size_t i = 0; i + keep_ < rotated.size(); ++i) {
+            fs::remove(rotated[i], ec);
+        }
+    }
+
+    size_t keep_;  // Rotated files to keep per base name
+    Compression compression_;  // Compression applied to rotated files
+    int64_t last_stamp_ = 0;  // Microsecond stamp of the last generated name
+    std::mutex mutex_;  // Guards tasks_ and stop_
+    std::condition_variable cv_;  // Signalled when a task is queued or on stop
+    std::deque<Task> tasks_;  // Rotated files waiting for compression and pruning
+    bool stop_ = false;  // Set by the destructor
+    std::thread worker_;  // Background thread; declared last so it starts after the other members
+};
+
+} // namespace detail
+
+// Static description of one logging statement. The COLORLOG_* macros create one per
+// expansion at compile time, so records only carry a pointer to it.
+struct CallSite {
+    const char* file;    // Source file (__FILE__)
+    int line;            // Source line (__LINE__)
+    LogLevel level;      // Level of the statement
+    const char* format;  // Format string, "{}" for plain messages
+    uint64_t id;         // binary::site_id of the above, or 0 to compute it on demand
+};
+
+// Enumeration for the kind of data a sink consumes
+enum class SinkFormat {
+    Text,   // Complete "[LEVEL] ...\n" lines
+    Binary,  // Encoded records, see OutputMode::Binary
+    Json     // One JSON object per record and line, see JsonFileSink
+};
+// Enumeration for whether a sink colors level names
+enum class ColorMode {
+    Auto,    // Color when the sink writes to a terminal and colors are enabled globally
+    Always,  // Always emit ANSI color codes
+    Never    // Never emit color codes
+};
+
+// Destination for log records. Each sink has its own level threshold, formatter and color
+// setting. Sinks may be shared between loggers, so implementations serialize their own writes.
+class Sink {
+public:
+    virtual ~Sink() = default;
+
+    // Write one or more complete text records
+    virtual void write(std::string_view records) = 0;
+
+    // Write one encoded record of call site `id`; only called when format() is SinkFormat::Binary
+    virtual void write_binary(const CallSite&, uint64_t, std::string_view) {}
+
+    // Push buffered output to the OS
+    virtual void flush() {}
+
+    // Push buffered output to stable storage (fsync); sinks without storage just flush
+    virtual void sync() { flush(); }
+
+    virtual SinkFormat format() const { return SinkFormat::Text; }
+
+    // Whether the destination takes colors under ColorMode::Auto (a terminal, unless the
+    // environment says otherwise, see TerminalCache); asked once, when the sink is attached
+    virtual bool is_terminal() const { return false; }
+
+    // Only records at or above this level reach the sink
+    void set_level(LogLevel level) { level_.store(level, std::memory_order_relaxed); }
+    LogLevel level() const { return level_.load(std::memory_order_relaxed); }
+    bool accepts(LogLevel level) const {
+        return static_cast<int>(level) >= static_cast<int>(level_.load(std::memory_order_relaxed));
+    }
+
+    // Formatter for this sink; sinks sharing one formatter object get each message formatted once.
+    // Without one the logger's formatter is used. Set these before logging starts
+    void set_formatter(LogBufferFormatter formatter) {
+        formatter_ = formatter ? std::make_shared<const LogBufferFormatter>(std::move(formatter)) : nullptr;
+    }
+    void set_formatter(std::shared_ptr<const LogBufferFormatter> formatter) { formatter_ = std::move(formatter); }
+    const LogBufferFormatter* formatter() const { return formatter_.get(); }
+
+    void set_color_mode(ColorMode mode) { color_mode_ = mode; }
+    ColorMode color_mode() const { return color_mode_; }
+    // Whether records for this sink get colored prefixes; no color detection happens per record
+    bool colored() const {
+        if (color_mode_ != ColorMode::Auto) {
+            return color_mode_ == ColorMode::Always;
+        }
+        return terminal_.load(std::memory_order_acquire) && is_global_colored;
+    }
+
+    // Resolve the color capability; called by Logger when the sink is attached, possibly while
+    // another logger sharing the sink writes through it. Concurrent attaches resolve the same value
+    void resolve_color() {
+        if (!color_resolved_.load(std::memory_order_acquire)) {
+            terminal_.store(is_terminal(), std::memory_order_release);
+            color_resolved_.store(true, std::memory_order_release);
+        }
+    }
+
+private:
+    std::atomic<LogLevel> level_{LogLevel::debug};  // Minimum level written by this sink
+    std::atomic<bool> terminal_{false};  // is_terminal(), resolved on attach
+    std::atomic<bool> color_resolved_{false};  // terminal_ has been resolved
+    std::shared_ptr<const LogBufferFormatter> formatter_;  // Own formatter, or nullptr for the logger's
+    ColorMode color_mode_ = ColorMode::Auto;  // Color setting
+};
+
+using SinkList = std::vector<std::shared_ptr<Sink>>;
+
+// Sink writing to std::cerr (or another standard stream). A stream other than std::cout, std::cerr
+// and std::clog can name the file descriptor it writes to, so its color capability can be checked
+class ConsoleSink : public Sink {
+public:
+    explicit ConsoleSink(std::ostream& stream = std::cerr) : ConsoleSink(stream, TerminalCache::fd_of(&stream)) {}
+
+    ConsoleSink(std::ostream& stream, int fd) : stream_(stream), fd_(fd) {
+#if defined(_WIN32) || defined(_WIN64)
+        // Let the console interpret the ANSI color codes
+        HANDLE console = TerminalCache::instance().console_handle(&stream);
+        DWORD mode = 0;
+        if (console != INVALID_HANDLE_VALUE && GetConsoleMode(console, &mode)) {
+            SetConsoleMode(console, mode | 0x0004);  // ENABLE_VIRTUAL_TERMINAL_PROCESSING
+        }
+#endif
+    }
+
+    void write(std::string_view records) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stream_.write(records.data(), static_cast<std::streamsize>(records.size()));
+    }
+
+    void flush() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stream_.flush();
+    }
+
+    bool is_terminal() const override { return TerminalCache::instance().is_terminal(fd_); }
+
+private:
+    std::ostream& stream_;  // Destination stream
+    int fd_;  // File descriptor behind stream_, or -1
+    std::mutex mutex_;  // Serializes writes
+};
+
+// Rotation settings for a FileSink
+struct RotationOptions {
+    size_t max_bytes = 0;                          // Rotate when the file reaches this size (0 disables)
+    std::chrono::milliseconds interval{0};         // Rotate after the file has been open this long (0 disables)
+    size_t keep = 5;                               // Rotated files to keep
+    Compression compression = Compression::None;   // Compression of rotated files
+};
+
+// Sink appending text records to a file, optionally rotating it (see RotationOptions)
+class FileSink : public Sink {
+public:
+    explicit FileSink(const std::string& path, const RotationOptions& rotation = RotationOptions())
+        : FileSink(path, rotation, false) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        open();
+    }
+
+    void write(std::string_view records) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        writeLocked(records.data(), records.size());
+        rotateIfDue();
+    }
+
+    void flush() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        file_.flush();
+    }
+
+    // Flush and fsync the file, and the last rotated file if it has not been synced since
+    void sync() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        file_.flush();
+        if (!unsynced_rotation_.empty()) {
+            syncPath(unsynced_rotation_);
+            unsynced_rotation_.clear();
+        }
+        syncPath(path_);
+    }
+
+    bool is_open() const { return file_.is_open(); }
+    const std::string& path() const { return path_; }
+
+protected:
+    // Does not open the file; derived classes call open() once they are constructed
+    FileSink(const std::string& path, const RotationOptions& rotation, bool binary)
+        : path_(path), binary_(binary), rotation_(rotation) {
+        if (rotation_.max_bytes > 0 || rotation_.interval.count() > 0) {
+            rotator_ = std::make_unique<detail::LogRotator>(rotation_.keep, rotation_.compression);
+        }
+    }
+
+    // Called after every (re)open with mutex_ held; bytes() is the size of the existing file
+    virtual void onOpen() {}
+
+    // Open (or reopen) path_ for appending; mutex_ must be held
+    void open() {
+        std::error_code ec;
+        std::uintmax_t size = std::filesystem::file_size(path_, ec);
+        bytes_ = ec ? 0 : static_cast<size_t>(size);
+        opened_ = std::chrono::steady_clock::now();
+        file_.open(path_, binary_ ? std::ios::out | std::ios::app | std::ios::binary : std::ios::out | std::ios::app);
+        if (file_.is_open()) {
+            onOpen();
+        }
+    }
+
+    // Write to the file, keeping track of its size for rotation; mutex_ must be held
+    void writeLocked(const char* data, size_t size) {
+        file_.write(data, static_cast<std::streamsize>(size));
+        bytes_ += size;
+    }
+
+    // Rename the file aside and reopen it once it is too large or too old; mutex_ must be held.
+    // Only whole records are written, so a rotation never splits or loses a line
+    void rotateIfDue() {
+        if (!rotator_ || !file_.is_open()) {
+            return;
+        }
+        bool due = (rotation_.max_bytes > 0 && bytes_ >= rotation_.max_bytes) ||
+                   (rotation_.interval.count() > 0 && std::chrono::steady_clock::now() - opened_ >= rotation_.interval);
+        if (!due) {
+            return;
+        }
+        file_.close();
+        std::string rotated = rotator_->next_name(path_);
+        std::error_code ec;
+        std::filesystem::rename(path_, rotated, ec);
+        open();
+        if (!ec) {
+            unsynced_rotation_ = rotated;
+            rotator_->submit(rotated, path_);
+        }
+    }
+
+    // fsync a file through a descriptor of its own; the stream's buffer must be flushed first.
+    // A rotated file already compressed and removed is skipped
+    static void syncPath(const std::string& path) {
+#if defined(_WIN32) || defined(_WIN64)
+        (void)path;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd >= 0) {
+            ::fsync(fd);
+            ::close(fd);
+        }
+#endif
+    }
+
+    size_t bytes() const { return bytes_; }
+
+    std::mutex mutex_;  // Serializes writes, flushes and rotation
+
+private:
+    std::string path_;  // File path
+    bool binary_;  // Open in binary mode
+    RotationOptions rotation_;  // Rotation settings
+    std::ofstream file_;  // File stream
+    size_t bytes_ = 0;  // Current size of the file
+    std::chrono::steady_clock::time_point opened_;  // When the file was opened
+    std::unique_ptr<detail::LogRotator> rotator_;  // Set when rotation is enabled
+    std::string unsynced_rotation_;  // Last rotated file, until sync() has synced it
+};
+
+// Sink storing encoded records (see OutputMode::Binary); decode them with colorlog_decode
+class BinaryFileSink : public FileSink {
+public:
+    explicit BinaryFileSink(const std::string& path, const RotationOptions& rotation = RotationOptions())
+        : FileSink(path, rotation, true) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        open();
+    }
+
+    SinkFormat format() const override { return SinkFormat::Binary; }
+
+    // Text records are not stored in binary logs
+    void write(std::string_view) override {}
+
+    // Describe the call site the first time it appears in the current file, then append the record
+    void write_binary(const CallSite& site, uint64_t id, std::string_view record) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (sites_.insert(id).second) {
+            writer_.clear();
+            binary::write_site(writer_, id, site.file, site.line, site.format);
+            writeLocked(writer_.data().data(), writer_.size());
+        }
+        writeLocked(record.data(), record.size());
+        rotateIfDue();
+    }
+
+protected:
+    // A new file starts with the format header and no known call sites
+    void onOpen() override {
+        sites_.clear();
+        if (bytes() == 0) {
+            writer_.clear();
+            binary::write_file_header(writer_);
+            writeLocked(writer_.data().data(), writer_.size());
+        }
+    }
+
+private:
+    binary::Writer writer_;  // Encode buffer for headers and call-site records
+    std::unordered_set<uint64_t> sites_;  // Call sites already described in the current file
+};
+
+// Sink appending records as JSON lines (see OutputMode::Json): {"time_ns":..,"level":"INFO",
+// "thread":..,"file":..,"line":..,"component":..,"message":..,"context":{"key":"value",...}},
+// leaving out the location, component and context when a record has none. The sink formatter
+// and colors do not apply
+class JsonFileSink : public FileSink {
+public:
+    explicit JsonFileSink(const std::string& path, const RotationOptions& rotation = RotationOptions())
+        : FileSink(path, rotation) {}
+
+    SinkFormat format() const override { return SinkFormat::Json; }
+};
+
+#if !defined(_WIN32) && !defined(_WIN64)
+// Sink copying text records into preallocated memory-mapped segments (see detail::MappedFile)
+class MappedFileSink : public Sink {
+public:
+    MappedFileSink(const std::string& base, size_t segment_size = 64 * 1024 * 1024) {
+        mapped_.open(base, segment_size);
+    }
+
+    void write(std::string_view records) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        mapped_.append(records.data(), records.size());
+    }
+
+    // Schedule write-back of the new bytes with msync
+    void flush() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        mapped_.sync();
+    }
+
+    // Wait until the bytes written so far are on storage
+    void sync() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        mapped_.sync(true);
+    }
+
+    bool is_open() const { return mapped_.is_open(); }
+
+private:
+    detail::MappedFile mapped_;  // Current segment
+    std::mutex mutex_;  // Serializes appends
+};
+#else
+// Memory mapping is not available; segments are written as one plain file
+class MappedFileSink : public FileSink {
+public:
+    MappedFileSink(const std::string& base, size_t = 0) : FileSink(base) {}
+};
+#endif
+
+#if !defined(_WIN32) && !defined(_WIN64)
+namespace detail {
+
+// LZ4 block format compressor (github.com/lz4/lz4, doc/lz4_Block_format.md) with a greedy
+// single-probe matcher; log text repeats enough for this to shrink frames severalfold.
+// `table` is the caller's match table, reused between calls so that a frame does not allocate
+inline void lz4_compress(const char* src, size_t size, std::string& out, std::vector<uint32_t>& table) {
+    constexpr size_t min_match = 4;
+    constexpr size_t last_literals = 5;  // The block always ends with at least this many literals
+    constexpr size_t match_margin = 12;  // No match starts within this many bytes of the end
+    auto read32 = [src](size_t pos) {
+        uint32_t value;
+        std::memcpy(&value, src + pos, sizeof(value));
+        return value;
+    };
+    auto put_length = [&out](size_t length) {
+        for (; length >= 255; length -= 255) {
+            out.push_back(static_cast<char>(255));
+        }
+        out.push_back(static_cast<char>(length));
+    };
+    // One sequence: literals, then a match of `match` bytes at `offset` back (none when 0)
+    auto put_sequence = [&](size_t anchor, size_t literals, size_t offset, size_t match) {
+        size_t extra = match ? match - min_match : 0;
+        out.push_back(static_cast<char>((std::min<size_t>(literals, 15) << 4) | std::min<size_t>(extra, 15)));
+        if (literals >= 15) {
+            put_length(literals - 15);
+        }
+        out.append(src + anchor, literals);
+        if (match) {
+            out.push_back(static_cast<char>(offset & 0xff));
+            out.push_back(static_cast<char>(offset >> 8));
+            if (extra >= 15) {
+                put_length(extra - 15);
+            }
+        }
+    };
+
+    table.assign(4096, 0);  // Position + 1 of the last 4-byte sequence per hash
+    size_t anchor = 0;
+    size_t pos = 0;
+    while (size > match_margin && pos < size - match_margin) {
+        uint32_t sequence = read32(pos);
+        uint32_t& slot = table[(sequence * 2654435761u) >> 20];
+        size_t candidate = slot;
+        slot = static_cast<uint32_t>(pos + 1);
+        if (candidate == 0 || pos - (candidate - 1) > 65535 || read32(candidate - 1) != sequence) {
+            ++pos;
+            continue;
+        }
+        size_t ref = candidate - 1;
+        size_t length = min_match;
+        while (pos + length < size - last_literals && src[ref + length] == src[pos + length]) {
+            ++length;
+        }
+        put_sequence(anchor, pos - anchor, pos - ref, length);
+        pos += length;
+        anchor = pos;
+    }
+    put_sequence(anchor, size - anchor, 0, 0);
+}
+
+// Append the decompressed LZ4 block `in` to `out`; false if it is malformed or not `raw_size` bytes
+inline bool lz4_decompress(std::string_view in, size_t raw_size, std::string& out) {
+    size_t start = out.size();
+    size_t pos = 0;
+    auto get_length = [&in, &pos](size_t& length) {
+        uint8_t byte;
+        do {
+            if (pos >= in.size()) {
+                return false;
+            }
+            byte = static_cast<uint8_t>(in[pos++]);
+            length += byte;
+        } while (byte == 255);
+        return true;
+    };
+    while (pos < in.size()) {
+        uint8_t token = static_cast<uint8_t>(in[pos++]);
+        size_t literals = token >> 4;
+        if ((literals == 15 && !get_length(literals)) || in.size() - pos < literals) {
+            return false;
+        }
+        out.append(in.data() + pos, literals);
+        pos += literals;
+        if (pos == in.size()) {
+            break;
+        }
+        if (in.size() - pos < 2) {
+            return false;
+        }
+        size_t offset = static_cast<uint8_t>(in[pos]) | (static_cast<size_t>(static_cast<uint8_t>(in[pos + 1])) << 8);
+        pos += 2;
+        size_t match = token & 15;
+        if (match == 15 && !get_length(match)) {
+            return false;
+        }
+        match += 4;
+        if (offset == 0 || offset > out.size() - start || out.size() - start + match > raw_size) {
+            return false;
+        }
+        // Byte by byte, since a match may overlap the bytes it produces
+        for (size_t from = out.size() - offset, i = 0; i < match; ++i) {
+            out.push_back(out[from + i]);
+        }
+    }
+    return out.size() - start == raw_size;
+}
+
+} // namespace detail
+
+// Enumeration for the transport of a NetworkSink
+enum class NetworkProtocol {
+    Tcp,  // One stream connection, reconnected with backoff
+    Udp   // Datagrams; lost ones are not noticed
+};
+// Enumeration for how a NetworkSink frames records
+enum class NetworkFraming {
+    LengthPrefixed,  // Batches of records per frame, optionally compressed (see NetworkSink::decode_frame)
+    Syslog           // One RFC 5424 message per record, octet-counted (RFC 6587) over TCP
+};
+
+// Settings for a NetworkSink
+struct NetworkSinkOptions {
+    std::string host = "127.0.0.1";                      // Collector host name or address
+    uint16_t port = 0;                                   // Collector port
+    NetworkProtocol protocol = NetworkProtocol::Tcp;     // Transport
+    NetworkFraming framing = NetworkFraming::LengthPrefixed;  // Wire format
+    bool compress = false;                               // LZ4-compress LengthPrefixed frames
+    size_t spool_bytes = 8 * 1024 * 1024;                // Records held while the collector is slow or away; the oldest are dropped beyond this
+    size_t frame_bytes = 60 * 1024;                      // Record bytes per frame (one datagram over UDP)
+    std::chrono::milliseconds reconnect_min{100};        // First reconnect delay, doubled after every failure
+    std::chrono::milliseconds reconnect_max{30000};      // Longest reconnect delay
+    std::chrono::milliseconds io_timeout{2000};          // Connect and send timeout
+    std::string app_name = "colorlog";                   // Syslog APP-NAME
+    int facility = 1;                                    // Syslog facility (1 is user-level)
+};
+
+// Sink shipping records to a remote collector. write() only appends the records to a bounded
+// in-memory spool; a dedicated I/O thread frames, compresses and sends them, and reconnects
+// with exponential backoff, so a slow or absent collector never stalls the logging threads.
+// Delivery is at least once: a frame interrupted by a disconnect is sent again, the ones before it are not
+class NetworkSink : public Sink {
+public:
+    explicit NetworkSink(NetworkSinkOptions options) : options_(std::move(options)) {
+        set_color_mode(ColorMode::Never);
+        char host[256] = {};
+        hostname_ = ::gethostname(host, sizeof(host) - 1) == 0 && host[0] ? host : "-";
+        pid_ = std::to_string(::getpid());
+        worker_ = std::thread([this] { run(); });
+    }
+
+    // Sends what is spooled if the collector can be reached, then disconnects
+    ~NetworkSink() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        worker_.join();
+        disconnect();
+    }
+
+    void write(std::string_view records) override {
+        if (records.empty()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::string chunk;
+            if (!spare_.empty()) {
+                chunk = std::move(spare_.back());
+                spare_.pop_back();
+            }
+            chunk.assign(records.data(), records.size());
+            spooled_ += chunk.size();
+            spool_.push_back(std::move(chunk));
+            while (spooled_ > options_.spool_bytes) {
+                spooled_ -= spool_.front().size();
+                discard(spool_.front());
+                spool_.pop_front();
+            }
+        }
+        cv_.notify_one();
+    }
+
+    // Records dropped because the spool was full or a datagram could not be sent
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    // Frames (syslog messages for NetworkFraming::Syslog) sent so far
+    uint64_t frames_sent() const { return frames_sent_.load(std::memory_order_relaxed); }
+    bool connected() const { return connected_.load(std::memory_order_relaxed); }
+
+    // Header of a LengthPrefixed frame: the 4-byte big-endian size of the rest of the frame,
+    // then a codec byte (0 plain, 1 LZ4 block) and the 4-byte big-endian size of the records
+    static constexpr size_t frame_header = 9;
+
+    // Append the records of one frame, without its leading size field, to `records`;
+    // false if the frame is malformed
+    static bool decode_frame(std::string_view frame, std::string& records) {
+        if (frame.size() < frame_header - 4) {
+            return false;
+        }
+        uint8_t codec = static_cast<uint8_t>(frame[0]);
+        size_t raw_size = getBig32(frame.data() + 1);
+        std::string_view payload = frame.substr(frame_header - 4);
+        if (codec == 0) {
+            if (payload.size() != raw_size) {
+                return false;
+            }
+            records.append(payload);
+            return true;
+        }
+        return codec == 1 && detail::lz4_decompress(payload, raw_size, records);
+    }
+
+private:
+    static void putBig32(char* out, size_t value) {
+        for (int i = 3; i >= 0; --i, value >>= 8) {
+            out[i] = static_cast<char>(value & 0xff);
+        }
+    }
+    static size_t getBig32(const char* in) {
+        size_t value = 0;
+        for (int i = 0; i < 4; ++i) {
+            value = (value << 8) | static_cast<uint8_t>(in[i]);
+        }
+        return value;
+    }
+
+    // Count the records of a chunk that is given up on and keep its buffer; mutex_ must be held
+    void discard(std::string& chunk) {
+        dropped_.fetch_add(static_cast<uint64_t>(std::count(chunk.begin(), chunk.end(), '\n')), std::memory_order_relaxed);
+        recycle(chunk);
+    }
+    void recycle(std::string& chunk) {
+        if (spare_.size() < 16) {
+            chunk.clear();
+            spare_.push_back(std::move(chunk));
+        }
+    }
+
+    // I/O thread: take up to frame_bytes of spooled records at a time and send them
+    void run() {
+        std::vector<std::string> taken;
+        std::chrono::milliseconds backoff = options_.reconnect_min;
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stop_ || !spool_.empty()) {
+            if (spool_.empty()) {
+                cv_.wait(lock, [this] { return stop_ || !spool_.empty(); });
+                continue;
+            }
+            if (fd_ < 0) {
+                lock.unlock();
+                bool ok = connect();
+                lock.lock();
+                if (!ok) {
+                    if (stop_) {
+                        break;  // The collector is away; do not hold up shutdown for it
+                    }
+                    cv_.wait_for(lock, backoff, [this] { return stop_; });
+                    backoff = std::min(backoff * 2, options_.reconnect_max);
+                    continue;
+                }
+                backoff = options_.reconnect_min;
+            }
+            size_t bytes = 0;
+            while (!spool_.empty() && (taken.empty() || bytes + spool_.front().size() <= options_.frame_bytes)) {
+                bytes += spool_.front().size();
+                taken.push_back(std::move(spool_.front()));
+                spool_.pop_front();
+            }
+            spooled_ -= bytes;
+            lock.unlock();
+            size_t sent = ship(taken);
+            lock.lock();
+            if (sent < bytes) {
+                disconnect();
+            }
+            // What went out is done with; the rest is put back so it is neither lost nor sent twice
+            auto unsent = taken.begin();
+            for (; unsent != taken.end() && sent >= unsent->size(); ++unsent) {
+                sent -= unsent->size();
+                recycle(*unsent);
+            }
+            if (unsent != taken.end()) {
+                unsent->erase(0, sent);
+                // Back in front of newer records, as far as the spool allows
+                for (auto it = taken.rbegin(); it != std::make_reverse_iterator(unsent); ++it) {
+                    if (spooled_ + it->size() > options_.spool_bytes) {
+                        discard(*it);
+                        continue;
+                    }
+                    spooled_ += it->size();
+                    spool_.push_front(std::move(*it));
+                }
+            }
+            taken.clear();
+        }
+        spooled_ = 0;
+        for (std::string& chunk : spool_) {
+            discard(chunk);
+        }
+        spool_.clear();
+    }
+
+    // Frame and send whole records. Returns how many bytes of `chunks` went out in full
+    // frames (syslog messages), which is less than their size once the connection fails
+    size_t ship(const std::vector<std::string>& chunks) {
+        raw_.clear();
+        size_t sent = 0;  // Bytes of the records sent so far; raw_ holds the ones after them
+        for (const std::string& chunk : chunks) {
+            for (size_t pos = 0; pos < chunk.size();) {
+                size_t end = chunk.find('\n', pos);
+                end = end == std::string::npos ? chunk.size() : end + 1;
+                std::string_view record(chunk.data() + pos, end - pos);
+                pos = end;
+                if (options_.framing == NetworkFraming::Syslog) {
+                    if (!sendSyslog(record)) {
+                        return sent;
+                    }
+                    sent += record.size();
+                    continue;
+                }
+                if (!raw_.empty() && raw_.size() + record.size() > options_.frame_bytes) {
+                    if (!sendFrame()) {
+                        return sent;
+                    }
+                    sent += raw_.size();
+                    raw_.clear();
+                }
+                raw_.append(record);
+            }
+        }
+        return raw_.empty() || sendFrame() ? sent + raw_.size() : sent;
+    }
+
+    // Send raw_ as one LengthPrefixed frame, compressed unless that does not make it smaller
+    bool sendFrame() {
+        message_.assign(frame_header, '\0');
+        uint8_t codec = 0;
+        if (options_.compress) {
+            detail::lz4_compress(raw_.data(), raw_.size(), message_, lz4_table_);
+            codec = 1;
+            if (message_.size() >= frame_header + raw_.size()) {
+                message_.resize(frame_header);
+                codec = 0;
+            }
+        }
+        if (codec == 0) {
+            message_.append(raw_);
+        }
+        putBig32(message_.data(), message_.size() - 4);
+        message_[4] = static_cast<char>(codec);
+        putBig32(message_.data() + 5, raw_.size());
+        return send(message_, static_cast<uint64_t>(std::count(raw_.begin(), raw_.end(), '\n')));
+    }
+
+    // Send "[LEVEL] text" as "<PRI>1 - HOST APP PID - - text"; the timestamp, if any, stays in the text
+    bool sendSyslog(std::string_view record) {
+        if (!record.empty() && record.back() == '\n') {
+            record.remove_suffix(1);
+        }
+        int severity = 5;  // notice, for records without a level prefix
+        size_t open = record.find('[');
+        size_t close = open == std::string_view::npos ? open : record.find("] ", open);
+        std::string_view before = record;
+        std::string_view after;
+        if (close != std::string_view::npos) {
+            std::string_view name = record.substr(open + 1, close - open - 1);
+            severity = name == "FATAL" ? 2 : name == "ERROR" ? 3 : name == "WARNING" ? 4 : name == "INFO" ? 6 :
+                       name == "DEBUG" || name == "TRACE" ? 7 : 5;
+            before = record.substr(0, open);
+            after = record.substr(close + 2);
+        }
+        message_.clear();
+        message_ += '<';
+        message_ += std::to_string(options_.facility * 8 + severity);
+        message_ += ">1 - ";
+        message_ += hostname_;
+        message_ += ' ';
+        message_ += options_.app_name;
+        message_ += ' ';
+        message_ += pid_;
+        message_ += " - - ";
+        message_.append(before);
+        message_.append(after);
+        if (options_.protocol == NetworkProtocol::Tcp) {
+            message_.insert(0, std::to_string(message_.size()) + " ");
+        }
+        return send(message_, 1);
+    }
+
+    // Send a whole frame carrying `records` records. A datagram that cannot be sent is counted as
+    // dropped rather than retried, since UDP gives no delivery guarantee anyway
+    bool send(const std::string& data, uint64_t records) {
+#if defined(MSG_NOSIGNAL)
+        constexpr int flags = MSG_NOSIGNAL;
+#else
+        constexpr int flags = 0;
+#endif
+        if (options_.protocol == NetworkProtocol::Udp) {
+            if (::send(fd_, data.data(), data.size(), flags) < 0) {
+                dropped_.fetch_add(records, std::memory_order_relaxed);
+            } else {
+                frames_sent_.fetch_add(1, std::memory_order_relaxed);
+            }
+            return true;
+        }
+        for (size_t sent = 0; sent < data.size();) {
+            ssize_t n = ::send(fd_, data.data() + sent, data.size() - sent, flags);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        frames_sent_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Resolve the collector and open a socket to it, giving up after io_timeout
+    bool connect() {
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = options_.protocol == NetworkProtocol::Tcp ? SOCK_STREAM : SOCK_DGRAM;
+        addrinfo* addresses = nullptr;
+        if (::getaddrinfo(options_.host.c_str(), std::to_string(options_.port).c_str(), &hints, &addresses) != 0) {
+            return false;
+        }
+        int fd = -1;
+        for (addrinfo* address = addresses; address && fd < 0; address = address->ai_next) {
+            fd = ::socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+            if (fd >= 0 && !connectWithin(fd, address)) {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+        ::freeaddrinfo(addresses);
+        if (fd < 0) {
+            return false;
+        }
+        ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+        timeval timeout{};
+        timeout.tv_sec = static_cast<time_t>(options_.io_timeout.count() / 1000);
+        timeout.tv_usec = static_cast<suseconds_t>(options_.io_timeout.count() % 1000 * 1000);
+        ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        int one = 1;
+#if defined(SO_NOSIGPIPE)
+        ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+        if (options_.protocol == NetworkProtocol::Tcp) {
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));  // Frames are batched already
+        }
+        fd_ = fd;
+        connected_.store(true, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Non-blocking connect, waited for with poll so an unreachable host costs at most io_timeout
+    bool connectWithin(int fd, const addrinfo* address) {
+        int flags = ::fcntl(fd, F_GETFL, 0);
+        ::fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+        int result = ::connect(fd, address->ai_addr, address->ai_addrlen);
+        if (result < 0 && errno == EINPROGRESS) {
+            pollfd waiting{fd, POLLOUT, 0};
+            int error = 0;
+            socklen_t length = sizeof(error);
+            result = ::poll(&waiting, 1, static_cast<int>(options_.io_timeout.count())) == 1 &&
+                     ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error == 0 ? 0 : -1;
+        }
+        ::fcntl(fd, F_SETFL, flags);
+        return result == 0;
+    }
+
+    void disconnect() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+        connected_.store(false, std::memory_order_relaxed);
+    }
+
+    NetworkSinkOptions options_;  // Collector and framing settings
+    std::string hostname_;  // Syslog HOSTNAME
+    std::string pid_;  // Syslog PROCID
+    std::mutex mutex_;  // Guards spool_, spooled_, spare_ and stop_
+    std::condition_variable cv_;  // Signalled when records are spooled or on stop
+    std::deque<std::string> spool_;  // Records waiting to be sent, one chunk per write()
+    size_t spooled_ = 0;  // Bytes in spool_
+    std::vector<std::string> spare_;  // Emptied chunks kept for reuse by write()
+    bool stop_ = false;  // Set by the destructor
+    int fd_ = -1;  // Socket, used by the I/O thread only
+    std::string raw_;  // Records of the frame being built
+    std::string message_;  // Encoded frame or syslog message
+    std::vector<uint32_t> lz4_table_;  // Match table of lz4_compress, reused between frames
+    std::atomic<uint64_t> dropped_{0};  // See dropped()
+    std::atomic<uint64_t> frames_sent_{0};  // See frames_sent()
+    std::atomic<bool> connected_{false};  // See connected()
+    std::thread worker_;  // I/O thread; declared last so it starts after the other members
+};
+#endif
+
+namespace detail {
+
+// Append `text` as a quoted JSON string
+inline void append_json_string(FormatBuffer& out, std::string_view text) {
+    static const char hex[] = "0123456789abcdef";
+    out.push_back('"');
+    size_t run = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        out.append(text.data() + run, i - run);
+        run = i + 1;
+        out.push_back('\\');
+        switch (c) {
+        case '"': out.push_back('"'); break;
+        case '\\': out.push_back('\\'); break;
+        case '\n': out.push_back('n'); break;
+        case '\r': out.push_back('r'); break;
+        case '\t': out.push_back('t'); break;
+        default:
+            out.append("u00");
+            out.push_back(hex[c >> 4]);
+            out.push_back(hex[c & 0xf]);
+        }
+    }
+    out.append(text.data() + run, text.size() - run);
+    out.push_back('"');
+}
+
+// Append one record as a JSON object and its newline (see JsonFileSink)
+inline void append_json_record(FormatBuffer& out, const RecordInfo& info, const CallSite& site, std::string_view message) {
+    char digits[24];
+    auto number = [&out, &digits](const char* key, uint64_t value) {
+        out.append(key);
+        out.append(digits, static_cast<size_t>(std::to_chars(digits, digits + sizeof(digits), value).ptr - digits));
+    };
+    number("{\"time_ns\":", info.timestamp_ns);
+    out.append(",\"level\":");
+    append_json_string(out, log_level_name(site.level));
+    number(",\"thread\":", info.thread_id);
+    if (site.file != nullptr && site.file[0] != '\0' && site.line > 0) {
+        out.append(",\"file\":");
+        append_json_string(out, site.file);
+        number(",\"line\":", static_cast<uint64_t>(site.line));
+    }
+    if (info.sample_weight > 1) {
+        number(",\"sample_weight\":", info.sample_weight);
+    }
+    if (info.component != nullptr) {
+        out.append(",\"component\":");
+        append_json_string(out, info.component);
+    }
+    out.append(",\"message\":");
+    append_json_string(out, message);
+    if (!info.context.empty()) {
+        out.append(",\"context\":");
+        char separator = '{';
+        LogContext::for_each(info.context, [&out, &separator](std::string_view key, std::string_view value) {
+            out.push_back(separator);
+            append_json_string(out, key);
+            out.push_back(':');
+            append_json_string(out, value);
+            separator = ',';
+        });
+        out.push_back('}');
+    }
+    out.append("}\n");
+}
+
+// Text of one record rendered for a (formatter, color) combination, reused by every sink sharing it
+struct RenderedRecord {
+    const LogBufferFormatter* formatter = nullptr;  // Sink formatter, or nullptr for the logger's
+    bool color = false;  // Level name colored
+    bool json = false;  // A JSON object for SinkFormat::Json sinks rather than a text line
+    size_t prefix = 0;  // Length of the timestamp and "[LEVEL] " prefix
+    FormatBuffer text;  // "[LEVEL] line\n"
+};
+
+// "[LEVEL] " prefixes rendered once per level, plain and colored. A logger builds a new
+// table only when a level color changes; records just pick the entry for their sink
+class LevelPrefixes {
+public:
+    // Prefixes with the ColorDefs colors
+    LevelPrefixes()
+        : LevelPrefixes({{LogLevel::debug, ColorDefs::debug}, {LogLevel::info, ColorDefs::info},
+                         {LogLevel::warn, ColorDefs::warn}, {LogLevel::error, ColorDefs::error},
+                         {LogLevel::fatal, ColorDefs::fatal}, {LogLevel::trace, ColorDefs::trace},
+                         {LogLevel::unknown, ColorDefs::unknown}}) {}
+
+    explicit LevelPrefixes(const std::unordered_map<LogLevel, ColorAttr>& colors) {
+        for (size_t i = 0; i < log_level_count; ++i) {
+            LogLevel level = static_cast<LogLevel>(i);
+            std::string name = log_level_name(level);
+            text_[0][i] = "[" + name + "] ";
+            auto color = colors.find(level);
+            text_[1][i] = color != colors.end() ? "[" + color->second.code + name + "\033[0m] " : text_[0][i];
+        }
+    }
+
+    std::string_view get(bool colored, LogLevel level) const {
+        size_t index = static_cast<size_t>(level);
+        return text_[colored ? 1 : 0][index < log_level_count ? index : static_cast<size_t>(LogLevel::unknown)];
+    }
+
+private:
+    std::string text_[2][log_level_count];  // [colored][level]
+};
+
+using RenderCache = std::vector<std::unique_ptr<RenderedRecord>>;
+
+// Runs fn(0) ... fn(n - 1) on helper threads and the calling thread, returning once all are done
+class ParallelFor {
+public:
+    explicit ParallelFor(size_t helpers) {
+        for (size_t i = 0; i < helpers; ++i) {
+            threads_.emplace_back([this] { work(); });
+        }
+    }
+
+    ParallelFor(const ParallelFor&) = delete;
+    ParallelFor& operator=(const ParallelFor&) = delete;
+
+    ~ParallelFor() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (auto& thread : threads_) {
+            thread.join();
+        }
+    }
+
+    void run(size_t n, const std::function<void(size_t)>& fn) {
+        std::lock_guard<std::mutex> serialize(run_mutex_);
+        std::unique_lock<std::mutex> lock(mutex_);
+        fn_ = &fn;
+        count_ = n;
+        next_ = 0;
+        done_ = 0;
+        ++generation_;
+        cv_.notify_all();
+        runTasks(lock);
+        done_cv_.wait(lock, [this] { return done_ == count_; });
+    }
+
+private:
+    void work() {
+        uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            cv_.wait(lock, [this, &seen] { return stop_ || generation_ != seen; });
+            if (stop_) {
+                return;
+            }
+            seen = generation_;
+            runTasks(lock);
+        }
+    }
+
+    // Claim and run tasks of the current run until none are left; `lock` holds mutex_.
+    // A run cannot finish while one of its tasks is executing, so claims never cross runs
+    void runTasks(std::unique_lock<std::mutex>& lock) {
+        while (next_ < count_) {
+            size_t index = next_++;
+            const std::function<void(size_t)>* fn = fn_;
+            lock.unlock();
+            (*fn)(index);
+            lock.lock();
+            if (++done_ == count_) {
+                done_cv_.notify_all();
+            }
+        }
+    }
+
+    std::vector<std::thread> threads_;  // Helper threads
+    std::mutex run_mutex_;  // Serializes run() calls
+    std::mutex mutex_;  // Guards the run state below
+    std::condition_variable cv_;  // Wakes helpers for a new run
+    std::condition_variable done_cv_;  // Signalled when the last task finishes
+    const std::function<void(size_t)>* fn_ = nullptr;  // Task of the current run
+    size_t count_ = 0;  // Tasks in the current run
+    size_t next_ = 0;  // Next task index to claim
+    size_t done_ = 0;  // Tasks finished in the current run
+    uint64_t generation_ = 0;  // Incremented for every run
+    bool stop_ = false;  // Set by the destructor
+};
+
+} // namespace detail
+
+// Throttling of the records logged from one call site at a level (see LoggerConfig::site_limits)
+struct SiteLimit {
+    double rate = 0;                // Records per second each call site may log (0 disables rate limiting)
+    double burst = 1;               // Records a call site may log back to back before the rate applies
+    bool suppress_repeats = false;  // Collapse identical consecutive messages into "Previous message repeated N times"
+};
+
+namespace detail {
+
+inline uint64_t hash_mix(uint64_t seed, uint64_t value) {
+    return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+}
+
+template <typename T, typename = void>
+inline constexpr bool is_hashable_v = false;
+
+template <typename T>
+inline constexpr bool is_hashable_v<T, std::void_t<decltype(std::hash<T>{}(std::declval<const T&>()))>> = true;
+
+// Hash of a message or format argument, used to recognize repeated messages without formatting
+// them; only types that std::hash does not cover are formatted into the scratch buffer
+template <typename T>
+uint64_t hash_value(const T& value) {
+    if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+        return std::hash<std::string_view>{}(std::string_view(value));
+    } else if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T>) {
+        return std::hash<T>{}(value);
+    } else if constexpr (Iterable<T>) {
+        uint64_t seed = 0;
+        for (const auto& item : value) {
+            seed = hash_mix(seed, hash_value(item));
+        }
+        return seed;
+    } else if constexpr (is_hashable_v<T>) {
+        return std::hash<T>{}(value);
+    } else {
+        ScratchLease scratch;
+        append_value(scratch->stream, scratch->message, value);
+        return std::hash<std::string_view>{}(scratch->message.view());
+    }
+}
+
+template <typename... Args>
+uint64_t hash_args(const Args&... args) {
+    uint64_t seed = 0;
+    ((seed = hash_mix(seed, hash_value(args))), ...);
+    return seed;
+}
+
+// Outcome of the site limits for one record
+struct SiteVerdict {
+    bool write = true;      // Whether the record should be written
+    uint64_t repeated = 0;  // Identical messages from the site suppressed just before this one
+    uint64_t limited = 0;   // Records from the site dropped by the rate limit since the last one written
+};
+
+// Passed instead of a message hash to apply only the rate limit
+struct NoMessageHash {};
+
+// Per-call-site token buckets and repeat counters for LoggerConfig::site_limits. Sites live in a
+// fixed open-addressing table of atomic slots, so checks take no lock; once a site finds no free
+// slot within max_probes it is not limited. Each bucket is kept as the time it is next empty
+// (GCRA), which a single compare-exchange updates
+class SiteLimiter {
+public:
+    static constexpr size_t capacity = 4096;  // Table slots (a power of two)
+    static constexpr size_t max_probes = 16;  // Slots searched per site
+
+    explicit SiteLimiter(const std::unordered_map<LogLevel, SiteLimit>& limits) : slots_(new Slot[capacity]) {
+        for (const auto& [level, limit] : limits) {
+            Rule& rule = rules_[static_cast<size_t>(level)];
+            if (limit.rate > 0) {
+                rule.interval_ns = std::max<uint64_t>(static_cast<uint64_t>(1e9 / limit.rate), 1);
+                rule.tolerance_ns = static_cast<uint64_t>(static_cast<double>(rule.interval_ns) *
+                                                          (std::max(limit.burst, 1.0) - 1.0));
+            }
+            rule.suppress_repeats = limit.suppress_repeats;
+        }
+    }
+
+    // Whether any limit applies at `level`
+    bool limits(LogLevel level) const {
+        const Rule& rule = rules_[static_cast<size_t>(level)];
+        return rule.interval_ns != 0 || rule.suppress_repeats;
+    }
+
+    // Take a token from the site's bucket, then compare the message hash from `hash` (called
+    // only when repeats are suppressed) with the site's previous message
+    template <typename HashFn>
+    SiteVerdict check(const CallSite& site, HashFn&& hash) {
+        const Rule& rule = rules_[static_cast<size_t>(site.level)];
+        uint64_t key = site.id != 0 ? site.id : binary::site_id(site.file, site.line, site.format);
+        Slot* slot = find(key != 0 ? key : 1);
+        SiteVerdict verdict;
+        if (slot == nullptr) {
+            return verdict;
+        }
+        if (rule.interval_ns != 0) {
+            uint64_t now = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+            uint64_t empty_at = slot->empty_at.load(std::memory_order_relaxed);
+            while (true) {
+                uint64_t start = std::max(empty_at, now);
+                if (start - now > rule.tolerance_ns) {
+                    slot->limited.fetch_add(1, std::memory_order_relaxed);
+                    verdict.write = false;
+                    return verdict;
+                }
+                if (slot->empty_at.compare_exchange_weak(empty_at, start + rule.interval_ns, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+        }
+        if constexpr (!std::is_same_v<std::decay_t<HashFn>, NoMessageHash>) {
+            if (rule.suppress_repeats) {
+                uint64_t message = hash() | 1;  // 0 marks a site without a previous message
+                if (slot->last_message.exchange(message, std::memory_order_relaxed) == message) {
+                    slot->repeats.fetch_add(1, std::memory_order_relaxed);
+                    verdict.write = false;
+                    return verdict;
+                }
+                verdict.repeated = slot->repeats.exchange(0, std::memory_order_relaxed);
+            }
+        }
+        if (rule.interval_ns != 0) {
+            verdict.limited = slot->limited.exchange(0, std::memory_order_relaxed);
+        }
+        return verdict;
+    }
+
+private:
+    struct Rule {
+        uint64_t interval_ns = 0;   // Time one token takes to refill (0 disables rate limiting)
+        uint64_t tolerance_ns = 0;  // How far ahead of now the bucket may be emptied: (burst - 1) intervals
+        bool suppress_repeats = false;  // Collapse identical consecutive messages
+    };
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> key{0};           // Call site id, 0 while the slot is free
+        std::atomic<uint64_t> empty_at{0};      // Steady-clock time the bucket is next empty, in ns
+        std::atomic<uint64_t> limited{0};       // Records dropped by the rate limit and not yet reported
+        std::atomic<uint64_t> last_message{0};  // Hash of the last message written from the site
+        std::atomic<uint64_t> repeats{0};       // Repeats of that message suppressed and not yet reported
+    };
+
+    // Find the slot of `key`, claiming a free one on first use; nullptr if the probed slots are taken
+    Slot* find(uint64_t key) {
+        for (size_t probe = 0; probe < max_probes; ++probe) {
+            Slot& slot = slots_[(key + probe) & (capacity - 1)];
+            uint64_t current = slot.key.load(std::memory_order_acquire);
+            if (current == 0 && slot.key.compare_exchange_strong(current, key, std::memory_order_acq_rel)) {
+                return &slot;
+            }
+            if (current == key) {
+                return &slot;
+            }
+        }
+        return nullptr;
+    }
+
+    Rule rules_[log_level_count];  // Limits by level
+    std::unique_ptr<Slot[]> slots_;  // Site table
+};
+
+// Notes written in front of a record about the records suppressed at its site before it
+inline std::string repeated_note(uint64_t count) {
+    return "Previous message repeated " + std::to_string(count) + (count == 1 ? " time" : " times");
+}
+
+inline std::string limited_note(uint64_t count) {
+    return std::to_string(count) + (count == 1 ? " message" : " messages") + " suppressed by the rate limit";
+}
+
+// Fast thread-local xorshift PRNG returning 64 uniform bits
+inline uint64_t fast_random_bits() {
+    thread_local uint64_t state = 0x9E3779B97F4A7C15ull ^
+        static_cast<uint64_t>(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+// Uniform double in [0, 1) from fast_random_bits()
+inline double fast_random() {
+    return static_cast<double>(fast_random_bits() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+} // namespace detail
+
+// Sampling of the records logged at a level (see LoggerConfig::sampling); both parts may be combined
+struct SampleRate {
+    uint32_t one_in = 1;       // Keep every one_in-th record per thread (1 keeps all)
+    double probability = 1.0;  // Keep each remaining record with this probability
+};
+
+namespace detail {
+
+// Per-level sampling for LoggerConfig::sampling. The 1-in-N counters are per thread and the
+// probability is drawn from fast_random_bits(), so a decision takes no lock and no shared write
+class Sampler {
+public:
+    explicit Sampler(const std::unordered_map<LogLevel, SampleRate>& rates) {
+        for (const auto& [level, rate] : rates) {
+            Rule& rule = rules_[static_cast<size_t>(level)];
+            rule.one_in = std::max<uint32_t>(rate.one_in, 1);
+            double probability = std::clamp(rate.probability, 0.0, 1.0);
+            rule.threshold = probability >= 1.0 ? std::numeric_limits<uint64_t>::max()
+                                                : static_cast<uint64_t>(probability * 18446744073709551616.0);
+            rule.weight = probability > 0.0
+                ? static_cast<uint32_t>(std::min(rule.one_in / probability + 0.5, 4294967295.0))
+                : 0;
+            rule.active = rule.one_in > 1 || probability < 1.0;
+        }
+    }
+
+    // Whether records at `level` are sampled at all
+    bool samples(LogLevel level) const { return rules_[static_cast<size_t>(level)].active; }
+
+    // Decide on one record at `level`: 0 drops it, otherwise the weight it is kept with
+    uint32_t take(LogLevel level) const {
+        const Rule& rule = rules_[static_cast<size_t>(level)];
+        if (rule.one_in > 1) {
+            thread_local uint32_t counts[log_level_count] = {};
+            uint32_t& count = counts[static_cast<size_t>(level)];
+            bool keep = count == 0;
+            count = count + 1 == rule.one_in ? 0 : count + 1;
+            if (!keep) {
+                return 0;
+            }
+        }
+        if (rule.threshold != std::numeric_limits<uint64_t>::max() && fast_random_bits() >= rule.threshold) {
+            return 0;
+        }
+        return rule.weight;
+    }
+
+private:
+    struct Rule {
+        uint32_t one_in = 1;  // Keep one record in this many
+        uint64_t threshold = std::numeric_limits<uint64_t>::max();  // Keep when the random bits fall below
+        uint32_t weight = 1;  // Records a kept one stands for: one_in / probability
+        bool active = false;  // Any sampling at this level
+    };
+
+    Rule rules_[log_level_count];  // Sampling by level
+};
+
+// A sampling decision made by Logger::sample() before the message was built, taken by the
+// next log call at the same level on this thread so the record is not sampled twice
+struct SampleTicket {
+    const void* owner = nullptr;  // Logger that made the decision, nullptr when none is pending
+    LogLevel level = LogLevel::unknown;  // Level it was made for
+    uint32_t weight = 1;  // Weight of the admitted record
+};
+
+inline SampleTicket& sample_ticket() {
+    thread_local SampleTicket ticket;
+    return ticket;
+}
+
+// Name of the NamedLogger logging on this thread, if any; AsyncLogger records it with the entry
+inline const char*& current_component() {
+    thread_local const char* component = nullptr;
+    return component;
+}
+
+} // namespace detail
+
+// Latency distribution in HDR-style log-linear buckets: values below 8 ns are exact, above that
+// every power of two is split into 8 buckets, so a bucket's width is at most 12.5% of its values
+struct LatencyHistogram {
+    static constexpr size_t sub_buckets = 8;  // Buckets per power of two
+    static constexpr size_t bucket_count = 62 * sub_buckets;  // Covers the whole uint64_t range
+
+    std::vector<uint64_t> counts = std::vector<uint64_t>(bucket_count);  // Samples per bucket
+    uint64_t count = 0;   // Number of samples
+    uint64_t sum_ns = 0;  // Sum of all samples
+    uint64_t max_ns = 0;  // Largest sample
+
+    // Bucket holding `ns`
+    static size_t bucket_of(uint64_t ns) {
+        if (ns < sub_buckets) {
+            return static_cast<size_t>(ns);
+        }
+        unsigned exponent = 3;
+        while (exponent < 63 && (ns >> (exponent + 1)) != 0) ++exponent;
+        return (exponent - 2) * sub_buckets + static_cast<size_t>((ns >> (exponent - 3)) & (sub_buckets - 1));
+    }
+
+    // Largest value that falls into bucket `index`
+    static uint64_t bucket_upper(size_t index) {
+        if (index < sub_buckets) {
+            return index;
+        }
+        unsigned shift = static_cast<unsigned>(index / sub_buckets) - 1;
+        uint64_t lower = static_cast<uint64_t>(sub_buckets + index % sub_buckets) << shift;
+        return lower + ((uint64_t{1} << shift) - 1);
+    }
+
+    // Upper bound of the bucket containing the `percentile` (0 to 100) sample, capped at max_ns
+    uint64_t percentile(double percentile) const {
+        if (count == 0) {
+            return 0;
+        }
+        uint64_t rank = static_cast<uint64_t>(std::max(percentile, 0.0) / 100.0 * static_cast<double>(count) + 0.5);
+        rank = std::clamp<uint64_t>(rank, 1, count);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); ++i) {
+            seen += counts[i];
+            if (seen >= rank) {
+                return std::min(bucket_upper(i), max_ns);
+            }
+        }
+        return max_ns;
+    }
+
+    double mean_ns() const { return count > 0 ? static_cast<double>(sum_ns) / static_cast<double>(count) : 0.0; }
+};
+
+// Snapshot of a logger's self-instrumentation (LoggerConfig::collect_stats)
+struct LoggerStats {
+    uint64_t messages[log_level_count] = {};  // Records written, by level
+    uint64_t bytes_written = 0;    // Bytes handed to sinks (text lines and binary records)
+    uint64_t dropped = 0;          // Records dropped by an AsyncLogger overflow policy
+    uint64_t suppressed = 0;       // Records suppressed by site_limits
+    size_t queue_depth = 0;        // Entries queued in AsyncLogger rings when the snapshot was taken
+    size_t queue_high_water = 0;   // Largest queue depth seen by a producer
+    LatencyHistogram latency;      // Time from capture (when the record was logged) to being written
+
+    uint64_t total_messages() const {
+        uint64_t total = 0;
+        for (uint64_t count : messages) total += count;
+        return total;
+    }
+
+    // Fold in the counters of another logger (e.g. an AsyncLogger shard)
+    void merge(const LoggerStats& other) {
+        for (size_t i = 0; i < log_level_count; ++i) messages[i] += other.messages[i];
+        bytes_written += other.bytes_written;
+        dropped += other.dropped;
+        suppressed += other.suppressed;
+        queue_depth += other.queue_depth;
+        queue_high_water = std::max(queue_high_water, other.queue_high_water);
+        for (size_t i = 0; i < LatencyHistogram::bucket_count; ++i) latency.counts[i] += other.latency.counts[i];
+        latency.count += other.latency.count;
+        latency.sum_ns += other.latency.sum_ns;
+        latency.max_ns = std::max(latency.max_ns, other.latency.max_ns);
+    }
+
+    // One-line summary, as written by the periodic self-report
+    std::string summary() const {
+        std::ostringstream oss;
+        oss << "colorlog stats: messages=" << total_messages() << " bytes=" << bytes_written
+            << " dropped=" << dropped << " suppressed=" << suppressed << " queue_depth=" << queue_depth
+            << " queue_high_water=" << queue_high_water << " latency_p50_ns=" << latency.percentile(50)
+            << " latency_p99_ns=" << latency.percentile(99) << " latency_max_ns=" << latency.max_ns;
+        return oss.str();
+    }
+};
+
+namespace detail {
+
+// Lock-free counters behind LoggerStats. Updates go to one of `stripes` cache-line-aligned
+// blocks picked by thread id, so threads rarely share a line; stats() sums the stripes
+class StatsCollector {
+public:
+    static constexpr size_t stripes = 16;
+
+    StatsCollector() : stripes_(new Stripe[stripes]) {}
+
+    // Count a record handed to the sinks; `latency_ns` is ignored when `timed` is false
+    void record_write(LogLevel level, size_t bytes, bool timed, uint64_t latency_ns) {
+        Stripe& stripe = local();
+        stripe.messages[static_cast<size_t>(level)].fetch_add(1, std::memory_order_relaxed);
+        stripe.bytes.fetch_add(bytes, std::memory_order_relaxed);
+        if (timed) {
+            stripe.buckets[LatencyHistogram::bucket_of(latency_ns)].fetch_add(1, std::memory_order_relaxed);
+            stripe.latency_count.fetch_add(1, std::memory_order_relaxed);
+            stripe.latency_sum.fetch_add(latency_ns, std::memory_order_relaxed);
+            uint64_t max = stripe.latency_max.load(std::memory_order_relaxed);
+            while (latency_ns > max && !stripe.latency_max.compare_exchange_weak(max, latency_ns, std::memory_order_relaxed)) {
+            }
+        }
+    }
+
+    void record_drop() { local().dropped.fetch_add(1, std::memory_order_relaxed); }
+    void record_suppressed() { local().suppressed.fetch_add(1, std::memory_order_relaxed); }
+
+    // Raise the queue high-water mark to `depth`
+    void record_depth(size_t depth) {
+        size_t high = high_water_.load(std::memory_order_relaxed);
+        while (depth > high && !high_water_.compare_exchange_weak(high, depth, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Add the current counters to `stats`
+    void add_to(LoggerStats& stats) const {
+        for (size_t s = 0; s < stripes; ++s) {
+            const Stripe& stripe = stripes_[s];
+            for (size_t i = 0; i < log_level_count; ++i) {
+                stats.messages[i] += stripe.messages[i].load(std::memory_order_relaxed);
+            }
+            stats.bytes_written += stripe.bytes.load(std::memory_order_relaxed);
+            stats.dropped += stripe.dropped.load(std::memory_order_relaxed);
+            stats.suppressed += stripe.suppressed.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < LatencyHistogram::bucket_count; ++i) {
+                stats.latency.counts[i] += stripe.buckets[i].load(std::memory_order_relaxed);
+            }
+            stats.latency.count += stripe.latency_count.load(std::memory_order_relaxed);
+            stats.latency.sum_ns += stripe.latency_sum.load(std::memory_order_relaxed);
+            stats.latency.max_ns = std::max(stats.latency.max_ns, stripe.latency_max.load(std::memory_order_relaxed));
+        }
+        stats.queue_high_water = std::max(stats.queue_high_water, high_water_.load(std::memory_order_relaxed));
+    }
+
+private:
+    struct alignas(64) Stripe {
+        std::atomic<uint64_t> messages[log_level_count] = {};  // Records written, by level
+        std::atomic<uint64_t> bytes{0};  // Bytes handed to sinks
+        std::atomic<uint64_t> dropped{0};  // Overflow drops
+        std::atomic<uint64_t> suppressed{0};  // Site-limit suppressions
+        std::atomic<uint64_t> latency_count{0};  // Latency samples
+        std::atomic<uint64_t> latency_sum{0};  // Sum of latency samples, ns
+        std::atomic<uint64_t> latency_max{0};  // Largest latency sample, ns
+        std::atomic<uint64_t> buckets[LatencyHistogram::bucket_count] = {};  // Latency histogram
+    };
+
+    Stripe& local() { return stripes_[RecordInfo::current_thread_id() % stripes]; }
+
+    std::unique_ptr<Stripe[]> stripes_;  // Counter blocks
+    std::atomic<size_t> high_water_{0};  // Queue high-water mark
+};
+
+// Thread calling a function at a fixed interval until it is destroyed
+class PeriodicTask {
+public:
+    PeriodicTask(std::chrono::milliseconds interval, std::function<void()> fn)
+        : thread_([this, interval, fn = std::move(fn)] {
+              std::unique_lock<std::mutex> lock(mutex_);
+              while (!cv_.wait_for(lock, interval, [this] { return stop_; })) {
+                  lock.unlock();
+                  fn();
+                  lock.lock();
+              }
+          }) {}
+
+    PeriodicTask(const PeriodicTask&) = delete;
+    PeriodicTask& operator=(const PeriodicTask&) = delete;
+
+    ~PeriodicTask() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        thread_.join();
+    }
+
+private:
+    std::mutex mutex_;  // Guards stop_
+    std::condition_variable cv_;  // Wakes the thread early to stop
+    bool stop_ = false;  // Set by the destructor
+    std::thread thread_;  // Declared last so the members above exist when it starts
+};
+
+} // namespace detail
+
+// Logger configuration structure
+struct LoggerConfig {
+    LogLevel log_level = LogLevel::info;               // Default log level
+    OutputMode output_mode = OutputMode::Console;      // Default output mode
+    std::string log_file_name;                         // Log file name
+    std::vector<std::shared_ptr<Sink>> sinks;          // Sinks to write to; when empty they are built from output_mode and log_file_name
+    bool parallel_sinks = true;                        // Write each AsyncLogger batch to several sinks concurrently
+    size_t mapped_segment_size = 64 * 1024 * 1024;     // Preallocated bytes per segment for OutputMode::Mapped
+    size_t rotate_max_bytes = 0;                       // Rotate the default log file when it reaches this size (0 disables)
+    std::chrono::milliseconds rotate_interval{0};      // Rotate the log file after it has been open this long (0 disables)
+    size_t rotate_keep = 5;                            // Rotated log files to keep
+    Compression rotate_compression = Compression::None;  // Compression of rotated log files (gzip or zstd tool)
+    LogBufferFormatter buffer_formatter = default_format;  // Formatter appending into a reused per-thread buffer
+    TimestampFormat timestamp_format = TimestampFormat::None;  // Timestamp written in front of text records
+    bool timestamp_utc = false;                        // Render timestamps in UTC instead of local time
+    ClockSource clock_source = ClockSource::System;    // Clock records are timestamped with
+    FlushPolicy flush_policy = FlushPolicy::Always;    // When output is flushed
+    size_t flush_every_n = 64;                         // Messages between flushes for FlushPolicy::EveryN
+    std::chrono::milliseconds flush_interval{100};     // Maximum flush delay for FlushPolicy::Interval
+    bool flush_on_error = true;                        // Always flush error and fatal messages
+    size_t queue_capacity = 8192;                      // AsyncLogger ring slots (rounded up to a power of two)
+    size_t batch_size = 256;                           // Maximum entries the AsyncLogger worker writes per batch
+    size_t worker_count = 1;                           // AsyncLogger shards, each with its own ring and worker thread
+    ShardOrdering shard_ordering = ShardOrdering::Merged;  // How shards write when worker_count > 1
+    std::vector<int> worker_cpus;                      // CPUs the shard workers are pinned to, round-robin (Linux; empty disables)
+    OverflowPolicy overflow_policy = OverflowPolicy::Block;  // AsyncLogger behaviour when the ring is full
+    double overflow_sample_threshold = 0.75;           // Ring fill ratio at which OverflowPolicy::Sample starts sampling
+    std::unordered_map<LogLevel, double> overflow_sample_rates = {
+        {LogLevel::debug, 0.01},
+        {LogLevel::info, 0.1},
+        {LogLevel::warn, 0.5},
+        {LogLevel::error, 1.0},
+        {LogLevel::fatal, 1.0},
+        {LogLevel::trace, 0.01},
+        {LogLevel::unknown, 0.1}
+    };  // Probability of keeping a message per level under OverflowPolicy::Sample
+    std::unordered_map<LogLevel, SiteLimit> site_limits;  // Per-call-site rate limits and repeat suppression by level (empty disables)
+    std::unordered_map<LogLevel, SampleRate> sampling;  // Per-level sampling, checked before the message is built (empty disables)
+    bool collect_stats = false;                        // Keep lock-free counters and latency histograms (see stats())
+    std::chrono::milliseconds stats_report_interval{0};  // Log LoggerStats::summary() at info this often when collecting (0 disables)
+#if COLORLOG_CXX20
+    std::function<void(std::coroutine_handle<>)> resume_executor;  // Resumes coroutines awaiting an AsyncLogger flush; empty resumes them on the worker thread
+#endif
+    LogFormatter formatter;                            // Legacy string-returning formatter; overrides buffer_formatter when set
+};
+
+// Locking strategies for BasicLogger policies (std::mutex works as well)
+
+// No locking, for loggers used by a single thread
+struct NullMutex {
+    void lock() {}
+    void unlock() {}
+};
+
+// Test-and-set spinlock; suits sinks whose writes are short, such as buffered files
+class SpinMutex {
+public:
+    void lock() {
+        while (flag_.test_and_set(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+    }
+
+    void unlock() { flag_.clear(std::memory_order_release); }
+
+private:
+    std::atomic_flag flag_ = ATOMIC_FLAG_INIT;  // Set while held
+};
+
+// Sink types for BasicLogger policies: plain classes with no virtual functions and no locking
+// of their own, since the logger's Mutex already serializes them. A sink type needs
+// write(std::string_view), flush() and is_terminal()
+
+// Writes to std::cerr (or another standard stream)
+class StaticConsoleSink {
+public:
+    explicit StaticConsoleSink(std::ostream& stream = std::cerr)
+        : stream_(stream), terminal_(TerminalCache::instance().is_terminal(&stream)) {}
+
+    void write(std::string_view text) { stream_.write(text.data(), static_cast<std::streamsize>(text.size())); }
+    void flush() { stream_.flush(); }
+    bool is_terminal() const { return terminal_; }
+
+private:
+    std::ostream& stream_;  // Destination stream
+    bool terminal_;  // Stream is a terminal, checked once
+};
+
+// Appends to a file
+class StaticFileSink {
+public:
+    explicit StaticFileSink(const std::string& path) : file_(path, std::ios::out | std::ios::app) {}
+
+    void write(std::string_view text) { file_.write(text.data(), static_cast<std::streamsize>(text.size())); }
+    void flush() { file_.flush(); }
+    bool is_terminal() const { return false; }
+    bool is_open() const { return file_.is_open(); }
+
+private:
+    std::ofstream file_;  // Output file
+};
+
+// Formatter type for BasicLogger policies wrapping default_format
+struct DefaultFormatter {
+    void operator()(FormatBuffer& out, LogLevel level, std::string_view file, int line, std::string_view msg) const {
+        default_format(out, level, file, line, msg);
+    }
+};
+
+// Default compile-time policy for BasicLogger; derive from it and override what differs
+struct StaticPolicy {
+    static constexpr LogLevel min_level = LogLevel::debug;  // Calls below this level compile to nothing
+    using Sinks = std::tuple<StaticConsoleSink>;  // Sink types, each record is written to all of them
+    using Formatter = DefaultFormatter;  // Callable (FormatBuffer&, level, file, line, msg), called directly
+    using Mutex = std::mutex;  // std::mutex, SpinMutex, or NullMutex for single-threaded use
+    static constexpr bool colored = true;  // Color level names on terminal sinks; false compiles color out
+    static constexpr bool flush_every_record = true;  // Flush the sinks after every record
+    static constexpr bool flush_on_error = true;  // Without flush_every_record, still flush error and fatal records
+};
+
+// Policy of the runtime-configured Logger (Logger is BasicLogger<DynamicPolicy>)
+struct DynamicPolicy {};
+
+// Logger configured entirely at compile time by `Policy` (see StaticPolicy). The level check,
+// formatter, sinks and locking are known to the compiler, so the hot path is inlined with no
+// virtual or std::function calls, and disabled levels cost nothing
+template <typename Policy>
+class BasicLogger {
+public:
+    using Sinks = typename Policy::Sinks;
+    using Formatter = typename Policy::Formatter;
+    using Mutex = typename Policy::Mutex;
+
+    // Construct the sinks from `sinks`, or default-construct them
+    template <typename... SinkArgs>
+    explicit BasicLogger(SinkArgs&&... sinks) : sinks_(std::forward<SinkArgs>(sinks)...) {}
+
+    BasicLogger(const BasicLogger&) = delete;              // Disable copy constructor
+    BasicLogger& operator=(const BasicLogger&) = delete;   // Disable copy assignment
+
+    // Check a level against Policy::min_level and the compile-time LOG_LEVEL
+    static constexpr bool should_log(LogLevel level) {
+        return static_cast<int>(level) >= LOG_LEVEL && static_cast<int>(level) >= static_cast<int>(Policy::min_level);
+    }
+
+    // Compile-time policies do not sample; the logging macros ask anyway
+    static constexpr bool sample(LogLevel) { return true; }
+
+    // Log a message
+    template <COLORLOG_CONSTRAINED(PrintableStringOrIterable, T)>
+    void log(LogLevel level, std::string_view file, int line, const T& msg) {
+        if (!should_log(level)) {
+            return;
+        }
+        if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+            write(level, file, line, std::string_view(msg));
+        } else {
+            detail::ScratchLease scratch;
+            detail::append_message(scratch->stream, scratch->message, msg);
+            write(level, file, line, scratch->message.view());
+        }
+    }
+
+    // Log a message built by a callable, invoked only if the level is enabled
+    template <COLORLOG_CONSTRAINED(LazyMessage, F)>
+    void log(LogLevel level, std::string_view file, int line, F&& make_msg) {
+        if (!should_log(level)) {
+            return;
+        }
+        log(level, file, line, make_msg());
+    }
+
+    // Log a "{}" format string, formatted only if the level is enabled
+    template <COLORLOG_CONSTRAINED_PACK(Formattable, Args)>
+    void logf(LogLevel level, std::string_view file, int line, const char* fmt, const Args&... args) {
+        if (!should_log(level)) {
+            return;
+        }
+        detail::ScratchLease scratch;
+        detail::format_into(scratch->stream, scratch->message, fmt, args...);
+        write(level, file, line, scratch->message.view());
+    }
+
+    // Log through a static call site (see COLORLOG_CALL_SITE)
+    template<typename T>
+    void log(const CallSite& site, T&& msg) {
+        log(site.level, site.file, site.line, std::forward<T>(msg));
+    }
+
+    template <COLORLOG_CONSTRAINED_PACK(Formattable, Args)>
+    void logf(const CallSite& site, const Args&... args) {
+        logf(site.level, site.file, site.line, site.format, args...);
+    }
+
+    // Level helpers; with a constant level the check folds away entirely
+    template<typename T>
+    void debug(T&& msg) { log(LogLevel::debug, "", 0, std::forward<T>(msg)); }
+
+    template<typename T>
+    void info(T&& msg) { log(LogLevel::info, "", 0, std::forward<T>(msg)); }
+
+    template<typename T>
+    void warn(T&& msg) { log(LogLevel::warn, "", 0, std::forward<T>(msg)); }
+
+    template<typename T>
+    void error(T&& msg) { log(LogLevel::error, "", 0, std::forward<T>(msg)); }
+
+    template<typename T>
+    void fatal(T&& msg) { log(LogLevel::fatal, "", 0, std::forward<T>(msg)); }
+
+    template<typename T>
+    void trace(T&& msg) { log(LogLevel::trace, "", 0, std::forward<T>(msg)); }
+
+    // Format-string level helpers, checked at compile time: info("req {} took {}us", id, us)
+    COLORLOG_TEMPLATE_PACK_IF(Formattable, Args, sizeof...(Args) > 0)
+    void debug(format_string<Args...> fmt, const Args&... args) { logf(LogLevel::debug, "", 0, fmt.get(), args...); }
+
+    COLORLOG_TEMPLATE_PACK_IF(Formattable, Args, sizeof...(Args) > 0)
+    void info(format_string<Args...> fmt, const Args&... args) { logf(LogLevel::info, "", 0, fmt.get(), args...); }
+
+    COLORLOG_TEMPLATE_PACK_IF(Formattable, Args, sizeof...(Args) > 0)
+    void warn(format_string<Args...> fmt, const Args&... args) { logf(LogLevel::warn, "", 0, fmt.get(), args...); }
+
+    COLORLOG_TEMPLATE_PACK_IF(Formattable, Args, sizeof...(Args) > 0)
+    void error(format_string<Args...> fmt, const Args&... args) { logf(LogLevel::error, "", 0, fmt.get(), args...); }
+
+    COLORLOG_TEMPLATE_PACK_IF(Formattable, Args, sizeof...(Args) > 0)
+    void fatal(format_string<Args...> fmt, const Args&... args) { logf(LogLevel::fatal, "", 0, fmt.get(), args...); }
+
+    COLORLOG_TEMPLATE_PACK_IF(Formattable, Args, sizeof...(Args) > 0)
+    void trace(format_string<Args...> fmt, const Args&... args) { logf(LogLevel::trace, "", 0, fmt.get(), args...); }
+
+    // Flush every sink
+    void flush() {
+        std::lock_guard<Mutex> lock(mutex_);
+        std::apply([](auto&... sink) { (sink.flush(), ...); }, sinks_);
+    }
+
+    // Access a sink by index, as in std::get
+    template <size_t I>
+    auto& sink() { return std::get<I>(sinks_); }
+
+private:
+    // Format the record once and write it to each sink with the prefix its color setting needs
+    void write(LogLevel level, std::string_view file, int line, std::string_view msg) {
+        std::lock_guard<Mutex> lock(mutex_);
+        body_.clear();
+        formatter_(body_, level, file, line, msg);
+        body_.push_back('\n');
+        std::apply([this, level](auto&... sink) { (writeTo(sink, level), ...); }, sinks_);
+    }
+
+    template <typename Sink>
+    void writeTo(Sink& sink, LogLevel level) {
+        bool colored = false;
+        if constexpr (Policy::colored) {
+            colored = is_global_colored && sink.is_terminal();
+        }
+        line_.clear();
+        line_.append(prefixes_.get(colored, level));
+        line_.append(body_.view());
+        sink.write(line_.view());
+        if constexpr (Policy::flush_every_record) {
+            sink.flush();
+        } else if constexpr (Policy::flush_on_error) {
+            if (level == LogLevel::error || level == LogLevel::fatal) {
+                sink.flush();  // Out before a crash or abort that may follow, as Logger does
+            }
+        }
+    }
+
+    Sinks sinks_;  // Sink objects, called directly
+    Formatter formatter_;  // Formatter object, called directly
+    Mutex mutex_;  // Serializes records
+    detail::LevelPrefixes prefixes_;  // Rendered "[LEVEL] " prefixes with the default colors
+    FormatBuffer body_;  // Formatted text of the current record
+    FormatBuffer line_;  // Prefix and text written to one sink
+};
+
+template <>
+class BasicLogger<DynamicPolicy>;
+
+// Logger class, configured at runtime (see LoggerConfig)
+using Logger = BasicLogger<DynamicPolicy>;
+
+template <>
+class BasicLogger<DynamicPolicy> {
+public:
+    // Constructor with optional configuration parameter
+    BasicLogger(const LoggerConfig& config = LoggerConfig())
+        : log_level_(config.log_level),
+          output_mode_(config.output_mode),
+          log_file_name_(config.log_file_name),
+          flush_policy_(config.flush_policy),
+          flush_every_n_(config.flush_every_n > 0 ? config.flush_every_n : 1),
+          flush_interval_(config.flush_interval),
+          flush_on_error_(config.flush_on_error),
+          mapped_segment_size_(config.mapped_segment_size),
+          rotation_{config.rotate_max_bytes, config.rotate_interval, config.rotate_keep, config.rotate_compression},
+          parallel_sinks_(config.parallel_sinks),
+          last_flush_(std::chrono::steady_clock::now()),
+          formatter_(config.formatter),
+          buffer_formatter_(config.buffer_formatter ? config.buffer_formatter : LogBufferFormatter(default_format)),
+          timestamp_format_(config.timestamp_format),
+          timestamp_utc_(config.timestamp_utc),
+          clock_source_(config.clock_source),
+          site_limiter_(config.site_limits.empty() ? nullptr : new detail::SiteLimiter(config.site_limits)),
+          sampler_(config.sampling.empty() ? nullptr : new detail::Sampler(config.sampling)),
+          stats_(config.collect_stats ? new detail::StatsCollector() : nullptr),
+          log_level_colors_{
+              {LogLevel::debug, ColorDefs::debug},
+              {LogLevel::info, ColorDefs::info},
+              {LogLevel::warn, ColorDefs::warn},
+              {LogLevel::error, ColorDefs::error},
+              {LogLevel::fatal, ColorDefs::fatal},
+              {LogLevel::trace, ColorDefs::trace},
+              {LogLevel::unknown, ColorDefs::unknown}
+          },
+          prefixes_(std::make_shared<const detail::LevelPrefixes>(log_level_colors_)),
+          default_handler_([](const std::exception& e) {
+              std::cerr << "Unhandled exception: " << e.what() << std::endl;
+          }) {
+        detail::prepare_clock(clock_source_);
+        if (config.sinks.empty()) {
+            makeDefaultSinks();
+        } else {
+            setSinks(config.sinks);
+        }
+        if (stats_ && config.stats_report_interval.count() > 0) {
+            stats_reporter_ = std::make_unique<detail::PeriodicTask>(config.stats_report_interval, [this] {
+                log(LogLevel::info, "", 0, stats().summary());
+            });
+        }
+    }
+
+    BasicLogger(const BasicLogger&) = delete;              // Disable copy constructor
+    BasicLogger& operator=(const BasicLogger&) = delete;   // Disable copy assignment
+
+    // Set log level
+    void set_log_level(LogLevel level) {
+        log_level_.store(level, std::memory_order_relaxed);
+    }
+
+    // Get log level
+    LogLevel get_log_level() const {
+        return log_level_.load(std::memory_order_relaxed);
+    }
+
+    // Check a level against the compile-time and runtime thresholds; this is the
+    // first thing done on the hot path, before any message is built
+    bool should_log(LogLevel level) const {
+        return static_cast<int>(level) >= LOG_LEVEL &&
+               static_cast<int>(level) >= static_cast<int>(log_level_.load(std::memory_order_relaxed));
+    }
+
+    // Sample a record at `level` before its message is built; the logging macros call this after
+    // should_log(). A kept record's decision is remembered for this thread, so the log call that
+    // follows does not sample it again
+    bool sample(LogLevel level) {
+        if (!sampler_ || !sampler_->samples(level)) {
+            return true;
+        }
+        uint32_t weight = sampler_->take(level);
+        if (weight != 0) {
+            detail::sample_ticket() = {this, level, weight};
+        }
+        return weight != 0;
+    }
+
+    // Sample a record from a call site that keeps one record in `one_in` (per thread, counted in
+    // `count`), on top of the level's own sampling (see COLORLOG_LOG_SAMPLED)
+    bool sample(LogLevel level, uint32_t& count, uint32_t one_in) {
+        if (one_in > 1) {
+            bool keep = count == 0;
+            count = count + 1 >= one_in ? 0 : count + 1;
+            if (!keep) {
+                return false;
+            }
+        }
+        uint32_t weight = sampler_ && sampler_->samples(level) ? sampler_->take(level) : 1;
+        if (weight == 0) {
+            return false;
+        }
+        weight = static_cast<uint32_t>(std::min<uint64_t>(uint64_t{weight} * std::max<uint32_t>(one_in, 1), UINT32_MAX));
+        if (weight > 1) {
+            detail::sample_ticket() = {this, level, weight};
+        }
+        return true;
+    }
+
+    // Weight of the record about to be logged at `level`: the one decided by sample(), else a
+    // fresh sampling decision (0 drops the record, 1 when the level is not sampled)
+    uint32_t take_sample(LogLevel level) {
+        detail::SampleTicket& ticket = detail::sample_ticket();
+        if (ticket.owner == this && ticket.level == level) {
+            ticket.owner = nullptr;
+            return ticket.weight;
+        }
+        if (!sampler_ || !sampler_->samples(level)) {
+            return 1;
+        }
+        return sampler_->take(level);
+    }
+
+    // Capture the current time (from the configured clock source) and thread for a record
+    // that is logged later through log_captured()
+    RecordInfo capture_info() const {
+        return RecordInfo::capture(clock_source_);
+    }
+
+    // Apply LoggerConfig::site_limits to a record from `site` before anything is formatted.
+    // `hash` returns a hash of the message and is only called when repeats are suppressed
+    // (pass detail::NoMessageHash to apply only the rate limit)
+    template <typename HashFn>
+    detail::SiteVerdict check_site(const CallSite& site, HashFn&& hash) {
+        if (!site_limiter_ || !site_limiter_->limits(site.level)) {
+            return {};
+        }
+        detail::SiteVerdict verdict = site_limiter_->check(site, std::forward<HashFn>(hash));
+        if (!verdict.write && stats_) {
+            stats_->record_suppressed();
+        }
+        return verdict;
+    }
+
+    // Snapshot of the counters kept with LoggerConfig::collect_stats (all zero without it)
+    LoggerStats stats() const {
+        LoggerStats snapshot;
+        if (stats_) {
+            stats_->add_to(snapshot);
+        }
+        return snapshot;
+    }
+
+    // Set log level color
+    void set_log_level_color(LogLevel level, const std::string& color) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        log_level_colors_[level].code = color;
+        prefixes_ = std::make_shared<const detail::LevelPrefixes>(log_level_colors_);
+    }
+
+    // Set output mode; the sinks are rebuilt from the output mode and log file, replacing custom sinks
+    void set_output_mode(OutputMode mode) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        output_mode_ = mode;
+        makeDefaultSinks();
+    }
+
+    // Set log file; the sinks are rebuilt from the output mode and log file, replacing custom sinks
+    void set_log_file(const std::string& filename) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        log_file_name_ = filename;
+        makeDefaultSinks();
+    }
+
+    // Add a sink that receives every record from now on
+    void add_sink(std::shared_ptr<Sink> sink) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        SinkList sinks = *sinks_;
+        sinks.push_back(std::move(sink));
+        setSinks(std::move(sinks));
+    }
+
+    // Replace all sinks
+    void set_sinks(SinkList sinks) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        setSinks(std::move(sinks));
+    }
+
+    // The current sinks
+    SinkList sinks() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return *sinks_;
+    }
+
+    // Set log formatter (legacy string-returning form; takes precedence over the buffer formatter)
+    void set_formatter(LogFormatter formatter) {
+        formatter_ = formatter;
+    }
+
+    // Set a formatter that appends into a caller-provided buffer and clear any legacy formatter
+    void set_buffer_formatter(LogBufferFormatter formatter) {
+        buffer_formatter_ = formatter ? formatter : LogBufferFormatter(default_format);
+        formatter_ = nullptr;
+    }
+
+    // Flush buffered output to the OS
+    void flush() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        flushStreams(*sinks_);
+    }
+
+    // Flush buffered output and wait until it is on stable storage (Sink::sync)
+    void sync() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& sink : *sinks_) {
+            sink->sync();
+        }
+        unflushed_ = 0;
+        last_flush_ = std::chrono::steady_clock::now();
+    }
+
+    // Flush if FlushPolicy::Interval output has been pending for flush_interval
+    void flush_if_due() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (flush_policy_ == FlushPolicy::Interval && unflushed_ > 0 &&
+            std::chrono::steady_clock::now() - last_flush_ >= flush_interval_) {
+            flushStreams(*sinks_);
+        }
+    }
+
+    // How long output may stay unflushed before flush_if_due() must run, or zero if nothing is pending
+    std::chrono::milliseconds pending_flush_delay() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (flush_policy_ != FlushPolicy::Interval || unflushed_ == 0) {
+            return std::chrono::milliseconds::zero();
+        }
+        auto due = last_flush_ + flush_interval_ - std::chrono::steady_clock::now();
+        return std::max(std::chrono::duration_cast<std::chrono::milliseconds>(due), std::chrono::milliseconds(1));
+    }
+
+    // Records collected in memory by begin_batch() and written together by end_batch();
+    // the buffers keep their capacity, so a reused Batch does not allocate
+    class Batch {
+    public:
+        size_t size() const { return records_; }
+
+    private:
+        friend class BasicLogger<DynamicPolicy>;
+
+        void clear() {
+            for (auto& output : outputs_) {
+                output->clear();
+            }
+            timestamps_.clear();
+            ends_.clear();
+            records_ = 0;
+            urgent_ = false;
+        }
+
+        // Byte range of record `record` in the output of sink `sink` (ordered batches only)
+        std::string_view slice(size_t record, size_t sink) const {
+            size_t width = outputs_.size();
+            size_t begin = record == 0 ? 0 : ends_[(record - 1) * width + sink];
+            return outputs_[sink]->view().substr(begin, ends_[record * width + sink] - begin);
+        }
+
+        std::shared_ptr<const SinkList> sinks_;  // Sinks captured by begin_batch()
+        std::shared_ptr<const detail::LevelPrefixes> prefixes_;  // Level prefixes captured by begin_batch()
+        std::vector<std::unique_ptr<FormatBuffer>> outputs_;  // Pending text per sink
+        detail::RenderCache render_;  // Render buffers for the current record
+        binary::Writer writer_;  // Encode buffer for binary sinks
+        bool ordered_ = false;  // Keep per-record timestamps and boundaries for merge_batches()
+        std::vector<uint64_t> timestamps_;  // Timestamp of each record (ordered batches)
+        std::vector<size_t> ends_;  // End offset of each record in each sink's output (ordered batches)
+        std::vector<size_t> cursors_;  // Next record of each input while merging into this batch
+        size_t records_ = 0;   // Records collected since the last end_batch()
+        bool urgent_ = false;  // Holds an error or fatal record
+    };
+
+    // Collect records logged by this thread into `batch` instead of writing each one;
+    // end_batch() writes them with a single write per sink. A thread batches one logger at a time
+    void begin_batch(Batch& batch) {
+        bindBatch(batch, false);
+    }
+
+    // Like begin_batch(), but the batch also keeps each record's timestamp and boundaries
+    // so that merge_batches() can interleave it with batches collected by other threads
+    void begin_ordered_batch(Batch& batch) {
+        bindBatch(batch, true);
+    }
+
+    // Write the records collected since begin_batch(), to several sinks concurrently when
+    // parallel_sinks is set, and apply the flush policy once for all of them
+    void end_batch() {
+        Batch* batch = activeBatch();
+        if (batch == nullptr) {
+            return;
+        }
+        currentBatch() = {nullptr, nullptr};
+        writeBatch(*batch);
+    }
+
+    // Stop collecting into the current batch without writing it; the records stay in the
+    // batch for merge_batches()
+    void release_batch() {
+        if (activeBatch() != nullptr) {
+            currentBatch() = {nullptr, nullptr};
+        }
+    }
+
+    // Write released ordered batches as one, interleaving their records by timestamp (each
+    // batch keeps its own order) through `out`; the input batches are cleared. Batches
+    // captured with a different sink list than the first are written on their own
+    void merge_batches(Batch* const* batches, size_t count, Batch& out) {
+        if (count == 0) {
+            return;
+        }
+        out.sinks_ = batches[0]->sinks_;
+        const size_t width = out.sinks_->size();
+        while (out.outputs_.size() < width) {
+            out.outputs_.push_back(std::make_unique<FormatBuffer>());
+        }
+        out.clear();
+        out.cursors_.assign(count, 0);
+        for (size_t b = 0; b < count; ++b) {
+            if (batches[b]->sinks_ != out.sinks_) {
+                writeBatch(*batches[b]);
+                out.cursors_[b] = batches[b]->records_;
+                continue;
+            }
+            out.records_ += batches[b]->records_;
+            out.urgent_ = out.urgent_ || batches[b]->urgent_;
+        }
+        for (;;) {
+            size_t next = count;
+            for (size_t b = 0; b < count; ++b) {
+                if (out.cursors_[b] < batches[b]->records_ &&
+                    (next == count || batches[b]->timestamps_[out.cursors_[b]] < batches[next]->timestamps_[out.cursors_[next]])) {
+                    next = b;
+                }
+            }
+            if (next == count) {
+                break;
+            }
+            size_t record = out.cursors_[next]++;
+            for (size_t i = 0; i < width; ++i) {
+                out.outputs_[i]->append(batches[next]->slice(record, i));
+            }
+        }
+        for (size_t b = 0; b < count; ++b) {
+            batches[b]->clear();
+        }
+        writeBatch(out);
+    }
+
+    // Logging functions for different log levels
+    template <COLORLOG_CONSTRAINED(PrintableStringOrIterable, T)>
+    void info(const T& msg) { log(LogLevel::info, "", 0, msg); }
+    
+    template <COLORLOG_CONSTRAINED(PrintableStringOrIterable, T)>
+    void debug(const T& msg) { log(LogLevel::debug, "", 0, msg); }
+    
+    template <COLORLOG_CONSTRAINED(PrintableStringOrIterable, T)>
+    void warn(const T& msg) { log(LogLevel::warn, "", 0, msg); }
+    
+    template <COLORLOG_CONSTRAINED(PrintableStringOrIterable, T)>
+    void error(const T& msg) { log(LogLevel::error, "", 0, msg); }
+    
+    template <COLORLOG_CONSTRAINED(PrintableStringOrIterable, T)>
+    void fatal(const T& msg) { log(LogLevel::fatal, "", 0, msg); }
+    
+    template <COLORLOG_CONSTRAINED(PrintableStringOrIterable, T)>
+    void trace(const T& msg) { log(LogLevel::trace, "", 0, msg); }
+
+    // Logging functions with file and line information
+    template <COLORLOG_CONSTRAINED(PrintableStringOrIterable, T)>
+    void info(const std::string& file, int line, const T& msg) { log(LogLevel::info, file, line, msg); }
+    
+    template <COLORLOG_CONSTRAINED(PrintableStringOrIterable, T)>
+    void debug(const std::string& file, int line, const T& msg) { log(LogLevel::debug, file, line, msg); }
+    
+    template <COLORLOG_CONSTRAINED(PrintableStringOrIterable, T)>
+    void warn(const std::string& file, int line, const T& msg) { log(LogLevel::warn, file, line, msg); }
+    
+    template <COLORLOG_CONSTRAINED(PrintableStringOrIterable, T)>
+    void error(const std::string& file, int line, const T& msg) { log(LogLevel::error, file, line, msg); }
+    
+    template <COLORLOG_CONSTRAINED(PrintableStringOrIterable, T)>
+    void fatal(const std::string& file, int line, const T& msg) { log(LogLevel::fatal, file, line, msg); }
+    
+    template <COLORLOG_CONSTRAINED(PrintableStringOrIterable, T)>
+    void trace(const std::string& file, int line, const T& msg) { log(LogLevel::trace, file, line, msg); }
+
+    // Lazy logging functions: the callable is only invoked if the level is enabled
+    template <COLORLOG_CONSTRAINED(LazyMessage, F)>
+    void info(F&& make_msg) { log(LogLevel::info, "", 0, std::forward<F>(make_msg)); }
+    
+    template <COLORLOG_CONSTRAINED(LazyMessage, F)>
+    void debug(F&& make_msg) { log(LogLevel::debug, "", 0, std::forward<F>(make_msg)); }
+    
+    template <COLORLOG_CONSTRAINED(LazyMessage, F)>
+    void warn(F&& make_msg) { log(LogLevel::warn, "", 0, std::forward<F>(make_msg)); }
+    
+    template <COLORLOG_CONSTRAINED(LazyMessage, F)>
+    void error(F&& make_msg) { log(LogLevel::error, "", 0, std::forward<F>(make_msg)); }
+    
+    template <COLORLOG_CONSTRAINED(LazyMessage, F)>
+    void fatal(F&& make_msg) { log(LogLevel::fatal, "", 0, std::forward<F>(make_msg)); }
+    
+    template <COLORLOG_CONSTRAINED(LazyMessage, F)>
+    void trace(F&& make_msg) { log(LogLevel::trace, "", 0, std::forward<F>(make_msg)); }
+
+    // Lazy logging functions with file and line information
+    template <COLORLOG_CONSTRAINED(LazyMessage, F)>
+    void info(const std::string& file, int line, F&& make_msg) { log(LogLevel::info, file, line, std::forward<F>(make_msg)); }
+    
+    template <COLORLOG_CONSTRAINED(LazyMessage, F)>
+    void debug(const std::string& file, int line, F&& make_msg) { log(LogLevel::debug, file, line, std::forward<F>(make_msg)); }
+    
+    template <COLORLOG_CONSTRAINED(LazyMessage, F)>
+    void warn(const std::string& file, int line, F&& make_msg) { log(LogLevel::warn, file, line, std::forward<F>(make_msg)); }
+    
+    template <COLORLOG_CONSTRAINED(LazyMessage, F)>
+    void error(const std::string& file, int line, F&& make_msg) { log(LogLevel::error, file, line, std::forward<F>(make_msg)); }
+    
+    template <COLORLOG_CONSTRAINED(LazyMessage, F)>
+    void fatal(const std::string& file, int line, F&& make_msg) { log(LogLevel::fatal, file, line, std::forward<F>(make_msg)); }
+    
+    template <COLORLOG_CONSTRAINED(LazyMessage, F)>
+    void trace(const std::string& file, int line, F&& make_msg) { log(LogLevel::trace, file, line, std::forward<F>(make_msg)); }
+
+    // Format-string logging functions: "{}" placeholders are replaced by the arguments if the level is enabled
+    template <COLORLOG_CONSTRAINED_PACK(Formattable, Args)>
+    void infof(const char* fmt, const Args&... args) { logf(LogLevel::info, "", 0, fmt, args...); }
+    
+    template <COLORLOG_CONSTRAINED_PACK(Formattable, Args)>
+    void debugf(const char* fmt, const Args&... args) { logf(LogLevel::debug, "", 0, fmt, args...); }
+    
+    template <COLORLOG_CONSTRAINED_PACK(Formattable, Args)>
+    void warnf(const char* fmt, const Args&... args) { logf(LogLevel::warn, "", 0, fmt, args...); }
+    
+    template <COLORLOG_CONSTRAINED_PACK(Formattable, Args)>
+    void errorf(const char* fmt, const Args&... args) { logf(LogLevel::error, "", 0, fmt, args...); }
+    
+    template <COLORLOG_CONSTRAINED_PACK(Formattable, Args)>
+    void fatalf(const char* fmt, const Args&... args) { logf(LogLevel::fatal, "", 0, fmt, args...); }
+    
+    template <COLORLOG_CONSTRAINED_PACK(Formattable, Args)>
+    void tracef(const char* fmt, const Args&... args) { logf(LogLevel::trace, "", 0, fmt, args...); }
+
+    // Format-string logging functions checked at compile time: info("req {} took {}us", id, us).
+    // A string, an int and a message still select the file and line overloads above; use infof there
+    COLORLOG_TEMPLATE_PACK_IF(Formattable, Args, sizeof...(Args) > 0 && !detail::is_location_call_v<Args...>)
+    void debug(format_string<Args...> fmt, const Args&... args) { logf(CallSite{"", 0, LogLevel::debug, fmt.get(), 0}, args...); }
+
+    COLORLOG_TEMPLATE_PACK_IF(Formattable, Args, sizeof...(Args) > 0 && !detail::is_location_call_v<Args...>)
+    void info(format_string<Args...> fmt, const Args&... args) { logf(CallSite{"", 0, LogLevel::info, fmt.get(), 0}, args...); }
+
+    COLORLOG_TEMPLATE_PACK_IF(Formattable, Args, sizeof...(Args) > 0 && !detail::is_location_call_v<Args...>)
+    void warn(format_string<Args...> fmt, const Args&... args) { logf(CallSite{"", 0, LogLevel::warn, fmt.get(), 0}, args...); }
+
+    COLORLOG_TEMPLATE_PACK_IF(Formattable, Args, sizeof...(Args) > 0 && !detail::is_location_call_v<Args...>)
+    void error(format_string<Args...> fmt, const Args&... args) { logf(CallSite{"", 0, LogLevel::error, fmt.get(), 0}, args...); }
+
+    COLORLOG_TEMPLATE_PACK_IF(Formattable, Args, sizeof...(Args) > 0 && !detail::is_location_call_v<Args...>)
+    void fatal(format_string<Args...> fmt, const Args&... args) { logf(CallSite{"", 0, LogLevel::fatal, fmt.get(), 0}, args...); }
+
+    COLORLOG_TEMPLATE_PACK_IF(Formattable, Args, sizeof...(Args) > 0 && !detail::is_location_call_v<Args...>)
+    void trace(format_string<Args...> fmt, const Args&... args) { logf(CallSite{"", 0, LogLevel::trace, fmt.get(), 0}, args...); }
+
+    // Logging functions for PrintableStringOrIterableOrOptional types
+    template <COLORLOG_CONSTRAINED(PrintableStringOrIterableOrOptional, T)>
+    void log_optional(LogLevel level, const std::string& file, int line, const T& msg) { log(level, file, line, msg); }
+
+    // Logging functions for PrintableOrException types
+    template <COLORLOG_CONSTRAINED(PrintableOrException, T)>
+    void log_exception(LogLevel level, const std::string& file, int line, const T& msg) { log(level, file, line, msg); }
+
+    // Handle exceptions with context
+    void handle_error(const std::exception& e, const std::string& context) {
+        error(context, 0, e.what());
+        log_stack_trace();
+
+        auto it = handlers_.find(typeid(e).name());
+        if (it != handlers_.end()) {
+            it->second(e);
+        } else {
+            default_handler_(e);
+        }
+    }
+
+    // Register error handler for specific exception types
+    void register_error_handler(const std::string& exception_type, std::function<void(const std::exception&)> handler) {
+        handlers_[exception_type] = handler;
+    }
+
+    // Set default error handler
+    void set_default_error_handler(std::function<void(const std::exception&)> handler) {
+        default_handler_ = handler;
+    }
+
+    // Log function with exception safety
+    template <COLORLOG_CONSTRAINED(PrintableStringOrIterable, T)>
+    void log(LogLevel level, const std::string& file, int line, const T& msg) {
+        if (!should_log(level)) {
+            return;
+        }
+        log(CallSite{file.c_str(), line, level, "{}", 0}, msg);
+    }
+
+    // Log through a static call site (see COLORLOG_CALL_SITE); nothing about the site is copied
+    template <COLORLOG_CONSTRAINED(PrintableStringOrIterable, T)>
+    void log(const CallSite& site, const T& msg) {
+        if (!should_log(site.level)) {
+            return;
+        }
+        uint32_t weight = take_sample(site.level);
+        if (weight == 0) {
+            return;
+        }
+        detail::SiteVerdict verdict = check_site(site, [&msg] { return detail::hash_value(msg); });
+        if (!verdict.write) {
+            return;
+        }
+        RecordInfo info = captureInfo(weight);
+        writeSuppressed(info, site, verdict);
+        log_captured(info, site, msg);
+    }
+
+    // Write a record whose metadata was captured earlier, e.g. on an AsyncLogger producer thread
+    template <COLORLOG_CONSTRAINED(PrintableStringOrIterable, T)>
+    void log_captured(const RecordInfo& info, const CallSite& site, const T& msg) {
+        writeRecord(info, site, [&](detail::FormatScratch& scratch) {
+            detail::append_message(scratch.stream, scratch.message, msg);
+        }, msg);
+    }
+
+    // Lazy log function: builds the message only after the level check passes
+    template <COLORLOG_CONSTRAINED(LazyMessage, F)>
+    void log(LogLevel level, const std::string& file, int line, F&& make_msg) {
+        if (!should_log(level)) {
+            return;
+        }
+        log(CallSite{file.c_str(), line, level, "{}", 0}, std::forward<F>(make_msg));
+    }
+
+    // Lazy log function through a static call site; a rate-limited message is never built
+    template <COLORLOG_CONSTRAINED(LazyMessage, F)>
+    void log(const CallSite& site, F&& make_msg) {
+        if (!should_log(site.level)) {
+            return;
+        }
+        uint32_t weight = take_sample(site.level);
+        if (weight == 0) {
+            return;
+        }
+        std::optional<std::remove_cv_t<std::remove_reference_t<std::invoke_result_t<F&>>>> built;
+        detail::SiteVerdict verdict = check_site(site, [&] {
+            built.emplace(make_msg());
+            return detail::hash_value(*built);
+        });
+        if (!verdict.write) {
+            return;
+        }
+        RecordInfo info = captureInfo(weight);
+        writeSuppressed(info, site, verdict);
+        if (built) {
+            log_captured(info, site, *built);
+        } else {
+            log_captured(info, site, make_msg());
+        }
+    }
+
+    // Format-string log function: formats only after the level check passes
+    template <COLORLOG_CONSTRAINED_PACK(Formattable, Args)>
+    void logf(LogLevel level, const std::string& file, int line, const char* fmt, const Args&... args) {
+        if (!should_log(level)) {
+            return;
+        }
+        logf(CallSite{file.c_str(), line, level, fmt, 0}, args...);
+    }
+
+    // Format-string log function through a static call site holding the format string
+    template <COLORLOG_CONSTRAINED_PACK(Formattable, Args)>
+    void logf(const CallSite& site, const Args&... args) {
+        if (!should_log(site.level)) {
+            return;
+        }
+        uint32_t weight = take_sample(site.level);
+        if (weight == 0) {
+            return;
+        }
+        detail::SiteVerdict verdict = check_site(site, [&] { return detail::hash_args(args...); });
+        if (!verdict.write) {
+            return;
+        }
+        RecordInfo info = captureInfo(weight);
+        writeSuppressed(info, site, verdict);
+        logf_captured(info, site, args...);
+    }
+
+    // Format-string variant of log_captured; binary sinks store the raw arguments unformatted
+    template <COLORLOG_CONSTRAINED_PACK(Formattable, Args)>
+    void logf_captured(const RecordInfo& info, const CallSite& site, const Args&... args) {
+        writeRecord(info, site, [&](detail::FormatScratch& scratch) {
+            detail::format_into(scratch.stream, scratch.message, site.format, args...);
+        }, args...);
+    }
+
+private:
+    // Build the sinks described by output_mode_ and log_file_name_; a file that cannot be
+    // opened falls back to the console. mutex_ must be held
+    void makeDefaultSinks() {
+        std::shared_ptr<Sink> file;
+        if (output_mode_ != OutputMode::Console && !log_file_name_.empty()) {
+            if (output_mode_ == OutputMode::Binary) {
+                auto sink = std::make_shared<BinaryFileSink>(log_file_name_, rotation_);
+                if (sink->is_open()) file = sink;
+            } else if (output_mode_ == OutputMode::Mapped) {
+                auto sink = std::make_shared<MappedFileSink>(log_file_name_, mapped_segment_size_);
+                if (sink->is_open()) file = sink;
+            } else if (output_mode_ == OutputMode::Json) {
+                auto sink = std::make_shared<JsonFileSink>(log_file_name_, rotation_);
+                if (sink->is_open()) file = sink;
+            } else {
+                auto sink = std::make_shared<FileSink>(log_file_name_, rotation_);
+                if (sink->is_open()) file = sink;
+            }
+        }
+        SinkList sinks;
+        if (!file || output_mode_ == OutputMode::Both) {
+            sinks.push_back(std::make_shared<ConsoleSink>());
+        }
+        if (file) {
+            sinks.push_back(file);
+        }
+        setSinks(std::move(sinks));
+    }
+
+    // Publish a new sink list; mutex_ must be held
+    void setSinks(SinkList sinks) {
+        bool text = false;
+        bool binary = false;
+        bool json = false;
+        for (const auto& sink : sinks) {
+            (sink->format() == SinkFormat::Binary ? binary : text) = true;
+            json = json || sink->format() == SinkFormat::Json;
+            sink->resolve_color();
+        }
+        sinks_ = std::make_shared<const SinkList>(std::move(sinks));
+        has_text_.store(text, std::memory_order_relaxed);
+        has_binary_.store(binary, std::memory_order_relaxed);
+        has_json_.store(json, std::memory_order_relaxed);
+    }
+
+    // Write the notes about records suppressed at `site` in front of the record that passed
+    void writeSuppressed(const RecordInfo& info, const CallSite& site, const detail::SiteVerdict& verdict) {
+        if (verdict.limited == 0 && verdict.repeated == 0) {
+            return;
+        }
+        CallSite note_site{site.file, site.line, site.level, "{}", 0};
+        if (verdict.repeated > 0) {
+            log_captured(info, note_site, detail::repeated_note(verdict.repeated));
+        }
+        if (verdict.limited > 0) {
+            log_captured(info, note_site, detail::limited_note(verdict.limited));
+        }
+    }
+
+    // Render the message with `fill` (only if a text sink exists) and hand the record to every
+    // sink accepting its level; `args` are what binary sinks encode
+    template<typename Fill, typename... Args>
+    void writeRecord(const RecordInfo& info, const CallSite& site, Fill&& fill, const Args&... args) {
+        try {
+            detail::ScratchLease scratch;
+            if (has_text_.load(std::memory_order_relaxed)) {
+                fill(*scratch.get());
+            }
+            size_t bytes = 0;
+            if (Batch* batch = activeBatch()) {
+                // Owned by this thread until end_batch(), so no lock is needed
+                if (dispatch(*batch->sinks_, *batch->prefixes_, info, site, scratch->message, batch->render_,
+                             batch->writer_, batch, bytes, args...)) {
+                    recordStats(info, site.level, bytes);
+                    ++batch->records_;
+                    batch->urgent_ = batch->urgent_ || isUrgent(site.level);
+                    if (batch->ordered_) {
+                        batch->timestamps_.push_back(info.timestamp_ns);
+                        for (const auto& output : batch->outputs_) {
+                            batch->ends_.push_back(output->size());
+                        }
+                    }
+                }
+                return;
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (dispatch(*sinks_, *prefixes_, info, site, scratch->message, render_, binary_writer_, nullptr, bytes, args...)) {
+                afterWrite(*sinks_, 1, isUrgent(site.level));
+                recordStats(info, site.level, bytes);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Logging exception: " << e.what() << std::endl;
+        }
+    }
+
+    // Count a written record and its capture-to-write latency
+    void recordStats(const RecordInfo& info, LogLevel level, size_t bytes) {
+        if (!stats_) {
+            return;
+        }
+        uint64_t now = detail::clock_now_ns(clock_source_);
+        bool timed = info.timestamp_ns != 0 && now >= info.timestamp_ns;
+        stats_->record_write(level, bytes, timed, timed ? now - info.timestamp_ns : 0);
+    }
+
+    // Pass one record to the sinks: text is rendered once per distinct formatter and color
+    // setting, binary records are encoded once. With a batch the text is queued per sink.
+    // Returns whether any sink accepted the record; `bytes` is increased by what they were given
+    template<typename... Args>
+    bool dispatch(const SinkList& sinks, const detail::LevelPrefixes& prefixes, const RecordInfo& info,
+                  const CallSite& site, const FormatBuffer& message, detail::RenderCache& cache,
+                  binary::Writer& writer, Batch* batch, size_t& bytes, const Args&... args) {
+        size_t rendered = 0;
+        bool encoded = false;
+        uint64_t id = 0;
+        bool accepted = false;
+        for (size_t i = 0; i < sinks.size(); ++i) {
+            Sink& sink = *sinks[i];
+            if (!sink.accepts(site.level)) {
+                continue;
+            }
+            accepted = true;
+            if (sink.format() == SinkFormat::Binary) {
+                if (!encoded) {
+                    id = site.id != 0 ? site.id : binary::site_id(site.file, site.line, site.format);
+                    writer.clear();
+                    binary::write_log(writer, info, site.level, id, args...);
+                    encoded = true;
+                }
+                sink.write_binary(site, id, writer.data());
+                bytes += writer.size();
+                continue;
+            }
+            const detail::RenderedRecord& record = sink.format() == SinkFormat::Json
+                ? renderJson(cache, rendered, info, site, message)
+                : render(cache, rendered, sink, prefixes, info, site, message);
+            bytes += record.text.size();
+            if (batch != nullptr) {
+                batch->outputs_[i]->append(record.text.view());
+            } else {
+                sink.write(record.text.view());
+            }
+        }
+        return accepted;
+    }
+
+    // Find or build the current record's text for the sink's formatter and color setting.
+    // The first `used` cache entries belong to the current record
+    detail::RenderedRecord& render(detail::RenderCache& cache, size_t& used, const Sink& sink,
+                                   const detail::LevelPrefixes& prefixes, const RecordInfo& info,
+                                   const CallSite& site, const FormatBuffer& message) {
+        const LogBufferFormatter* formatter = sink.formatter();
+        bool color = sink.colored();
+        const detail::RenderedRecord* same_formatter = nullptr;
+        for (size_t i = 0; i < used; ++i) {
+            detail::RenderedRecord& record = *cache[i];
+            if (record.formatter == formatter && !record.json) {
+                if (record.color == color) {
+                    return record;
+                }
+                same_formatter = &record;
+            }
+        }
+        if (used == cache.size()) {
+            cache.push_back(std::make_unique<detail::RenderedRecord>());
+        }
+        detail::RenderedRecord& record = *cache[used++];
+        record.formatter = formatter;
+        record.color = color;
+        record.json = false;
+        record.text.clear();
+        if (timestamp_format_ != TimestampFormat::None) {
+            append_timestamp(record.text, info.timestamp_ns, timestamp_format_, timestamp_utc_);
+            record.text.push_back(' ');
+        }
+        record.text.append(prefixes.get(color, site.level));
+        append_sample_tag(record.text, info.sample_weight);
+        if (info.component != nullptr) {
+            record.text.push_back('[');
+            record.text.append(info.component);
+            record.text.append("] ");
+        }
+        append_context(record.text, info.context);
+        record.prefix = record.text.size();
+        if (same_formatter != nullptr) {
+            // Same formatter with the other color setting: only the prefix differs
+            record.text.append(same_formatter->text.view().substr(same_formatter->prefix));
+        } else {
+            formatLine(record.text, formatter, site, message.view());
+        }
+        return record;
+    }
+
+    // Find or build the current record's JSON object, shared by every JSON sink
+    detail::RenderedRecord& renderJson(detail::RenderCache& cache, size_t& used, const RecordInfo& info,
+                                       const CallSite& site, const FormatBuffer& message) {
+        for (size_t i = 0; i < used; ++i) {
+            if (cache[i]->json) {
+                return *cache[i];
+            }
+        }
+        if (used == cache.size()) {
+            cache.push_back(std::make_unique<detail::RenderedRecord>());
+        }
+        detail::RenderedRecord& record = *cache[used++];
+        record.formatter = nullptr;
+        record.color = false;
+        record.json = true;
+        record.prefix = 0;
+        record.text.clear();
+        detail::append_json_record(record.text, info, site, message.view());
+        return record;
+    }
+
+    // Append the formatted line and its newline, using the logger's formatter when `formatter` is null
+    void formatLine(FormatBuffer& out, const LogBufferFormatter* formatter, const CallSite& site, std::string_view message) {
+        if (formatter != nullptr) {
+            (*formatter)(out, site.level, site.file, site.line, message);
+        } else if (formatter_) {
+            // Legacy string formatter: allocates, kept for compatibility
+            out.append(formatter_(site.level, site.file, site.line, std::string(message)));
+        } else {
+            buffer_formatter_(out, site.level, site.file, site.line, message);
+        }
+        out.push_back('\n');
+    }
+
+    static bool isUrgent(LogLevel level) {
+        return level == LogLevel::error || level == LogLevel::fatal;
+    }
+
+    // Capture the sinks and make `batch` the one this thread collects into
+    void bindBatch(Batch& batch, bool ordered) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            batch.sinks_ = sinks_;
+            batch.prefixes_ = prefixes_;
+        }
+        while (batch.outputs_.size() < batch.sinks_->size()) {
+            batch.outputs_.push_back(std::make_unique<FormatBuffer>());
+        }
+        batch.clear();
+        batch.ordered_ = ordered;
+        currentBatch() = {this, &batch};
+    }
+
+    // Write each sink's pending text from `batch`, apply the flush policy and clear it
+    void writeBatch(Batch& batch) {
+        if (batch.records_ == 0) {
+            return;
+        }
+        const SinkList& sinks = *batch.sinks_;
+        auto write_output = [&batch, &sinks](size_t index) {
+            FormatBuffer& output = *batch.outputs_[index];
+            if (output.empty()) {
+                return;
+            }
+            try {
+                sinks[index]->write(output.view());
+            } catch (const std::exception& e) {
+                std::cerr << "Logging exception: " << e.what() << std::endl;
+            }
+        };
+        size_t pending = 0;
+        for (size_t i = 0; i < sinks.size(); ++i) {
+            pending += batch.outputs_[i]->empty() ? 0 : 1;
+        }
+        if (pending > 1 && parallel_sinks_) {
+            fanOut(sinks.size()).run(sinks.size(), write_output);
+        } else {
+            for (size_t i = 0; i < sinks.size(); ++i) {
+                write_output(i);
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        afterWrite(sinks, batch.records_, batch.urgent_);
+        batch.clear();
+    }
+
+    // The batch this thread is collecting, if any
+    struct BatchBinding {
+        const Logger* logger;
+        Batch* batch;
+    };
+
+    static BatchBinding& currentBatch() {
+        thread_local BatchBinding binding{nullptr, nullptr};
+        return binding;
+    }
+
+    Batch* activeBatch() const {
+        const BatchBinding& binding = currentBatch();
+        return binding.logger == this ? binding.batch : nullptr;
+    }
+
+    // Helper threads for parallel sink writes, started on first use
+    detail::ParallelFor& fanOut(size_t sinks) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!fanout_) {
+            fanout_ = std::make_unique<detail::ParallelFor>(sinks - 1);
+        }
+        return *fanout_;
+    }
+
+    // Record metadata is only needed by sinks that store it and for timestamped text; the log
+    // context is always taken, as a view of the thread's fields
+    RecordInfo captureInfo(uint32_t sample_weight) const {
+        RecordInfo info = has_binary_.load(std::memory_order_relaxed) || has_json_.load(std::memory_order_relaxed) ||
+                          timestamp_format_ != TimestampFormat::None || stats_
+            ? capture_info() : RecordInfo();
+        info.sample_weight = sample_weight;
+        info.context = LogContext::current();
+        return info;
+    }
+
+    // Apply the flush policy after `records` messages were written to `sinks`, the current sink
+    // list or the one a batch captured; mutex_ must be held
+    void afterWrite(const SinkList& sinks, size_t records, bool urgent) {
+        unflushed_ += records;
+        bool flush = false;
+        switch (flush_policy_) {
+        case FlushPolicy::Always:
+            flush = true;
+            break;
+        case FlushPolicy::EveryN:
+            flush = unflushed_ >= flush_every_n_;
+            break;
+        case FlushPolicy::Interval:
+            flush = std::chrono::steady_clock::now() - last_flush_ >= flush_interval_;
+            break;
+        case FlushPolicy::Never:
+            break;
+        }
+        if (flush || (flush_on_error_ && urgent)) {
+            flushStreams(sinks);
+        }
+    }
+
+    // Flush every sink of `sinks`; mutex_ must be held
+    void flushStreams(const SinkList& sinks) {
+        for (const auto& sink : sinks) {
+            sink->flush();
+        }
+        unflushed_ = 0;
+        last_flush_ = std::chrono::steady_clock::now();
+    }
+
+    // Write a stack trace to stderr; backtrace_symbols_fd writes directly, without allocating
+    void log_stack_trace() {
+        void* frames[10];
+        int size = backtrace(frames, 10);
+        std::cerr << "Stack trace:" << std::endl;
+        backtrace_symbols_fd(frames, size, 2);
+    }
+
+    mutable std::mutex mutex_;  // Guards the sink list, flush state and synchronous writes
+    std::atomic<LogLevel> log_level_;  // Current log level
+    OutputMode output_mode_;  // Output mode the default sinks are built from
+    std::string log_file_name_;  // Log file the default sinks are built from
+    FlushPolicy flush_policy_;  // When output is flushed
+    size_t flush_every_n_;  // Messages between flushes for FlushPolicy::EveryN
+    std::chrono::milliseconds flush_interval_;  // Maximum flush delay for FlushPolicy::Interval
+    bool flush_on_error_;  // Always flush error and fatal messages
+    size_t mapped_segment_size_;  // Bytes per segment for OutputMode::Mapped
+    RotationOptions rotation_;  // Rotation of the default file sink
+    bool parallel_sinks_;  // Write batches to several sinks concurrently
+    size_t unflushed_ = 0;  // Messages written since the last flush
+    std::chrono::steady_clock::time_point last_flush_;  // Time of the last flush
+    LogFormatter formatter_;  // Legacy formatter function, used instead of buffer_formatter_ when set
+    LogBufferFormatter buffer_formatter_;  // Formatter appending into the per-thread buffer
+    TimestampFormat timestamp_format_;  // Timestamp written in front of text records
+    bool timestamp_utc_;  // Timestamps in UTC instead of local time
+    ClockSource clock_source_;  // Clock used to timestamp records
+    std::unique_ptr<detail::SiteLimiter> site_limiter_;  // Call-site limits, nullptr when none are configured
+    std::unique_ptr<detail::Sampler> sampler_;  // Level sampling, nullptr when none is configured
+    std::unique_ptr<detail::StatsCollector> stats_;  // Self-instrumentation counters, nullptr unless collect_stats
+    std::unordered_map<LogLevel, ColorAttr> log_level_colors_;  // Color definitions for log levels
+    std::shared_ptr<const detail::LevelPrefixes> prefixes_;  // Rendered "[LEVEL] " prefixes; replaced, never modified in place
+    std::shared_ptr<const SinkList> sinks_;  // Current sinks; replaced, never modified in place
+    std::atomic<bool> has_text_{false};  // Some sink takes text records
+    std::atomic<bool> has_binary_{false};  // Some sink takes binary records
+    std::atomic<bool> has_json_{false};  // Some sink takes JSON records
+    detail::RenderCache render_;  // Render buffers for synchronous writes
+    binary::Writer binary_writer_;  // Encode buffer for synchronous binary writes
+    std::unique_ptr<detail::ParallelFor> fanout_;  // Helper threads for parallel sink writes
+    std::unordered_map<std::string, std::function<void(const std::exception&)>> handlers_;  // Exception handlers
+    std::function<void(const std::exception&)> default_handler_;  // Default exception handler
+    std::unique_ptr<detail::PeriodicTask> stats_reporter_;  // Periodic stats line; declared last so it stops first
+};
+
+namespace detail {
+
+// Bounded lock-free queue of preallocated slots (Vyukov-style sequence ring).
+// Any number of threads may push; the consumer side uses the same CAS protocol,
+// so it stays correct even if more than one thread pops.
+template <typename T>
+class BoundedRing {
+public:
+    explicit BoundedRing(size_t capacity)
+        : mask_(round_up_pow2(capacity) - 1), cells_(new Cell[mask_ + 1]) {
+        for (size_t i = 0; i <= mask_; ++i) {
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+        enqueue_pos_.store(0, std::memory_order_relaxed);
+        dequeue_pos_.store(0, std::memory_order_relaxed);
+    }
+
+    BoundedRing(const BoundedRing&) = delete;
+    BoundedRing& operator=(const BoundedRing&) = delete;
+
+    // Claim a free slot and fill it in place; returns false when the ring is full
+    template <typename Fill>
+    bool try_push(Fill&& fill) {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos & mask_];
+            size_t seq = cell.seq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    fill(cell.data);
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Consume the oldest published slot in place; returns false when the ring is empty
+    template <typename Consume>
+    bool try_pop(Consume&& consume) {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos & mask_];
+            size_t seq = cell.seq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    consume(cell.data);
+                    cell.seq.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // True when the oldest slot has not been published yet
+    bool empty() const {
+        size_t pos = dequeue_pos_.load(std::memory_order_acquire);
+        return cells_[pos & mask_].seq.load(std::memory_order_acquire) != pos + 1;
+    }
+
+    // Number of claimed slots not yet consumed (may be momentarily stale)
+    size_t size_approx() const {
+        size_t head = dequeue_pos_.load(std::memory_order_relaxed);
+        size_t tail = enqueue_pos_.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+    // Monotonic count of slots claimed by producers
+    size_t enqueue_position() const { return enqueue_pos_.load(std::memory_order_acquire); }
+
+    // Monotonic count of slots claimed by consumers
+    size_t dequeue_position() const { return dequeue_pos_.load(std::memory_order_acquire); }
+
+    // Call `visit` on every published slot not yet consumed, oldest first, without claiming them.
+    // Only atomic loads are used, so this is safe from a signal handler (the slots may be stale)
+    template <typename Visit>
+    void visit_pending(Visit&& visit) const {
+        size_t end = enqueue_pos_.load(std::memory_order_acquire);
+        for (size_t pos = dequeue_pos_.load(std::memory_order_acquire); pos != end; ++pos) {
+            const Cell& cell = cells_[pos & mask_];
+            if (cell.seq.load(std::memory_order_acquire) == pos + 1) {
+                visit(cell.data);
+            }
+        }
+    }
+
+private:
+    static size_t round_up_pow2(size_t n) {
+        size_t p = 2;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    struct alignas(64) Cell {
+        std::atomic<size_t> seq;
+        T data;
+    };
+
+    const size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+    alignas(64) std::atomic<size_t> enqueue_pos_;
+    alignas(64) std::atomic<size_t> dequeue_pos_;
+};
+
+// Chunked storage for queued text too large for a ring slot. Producers bump-allocate blocks
+// from the current chunk under a short lock; each chunk counts its live blocks and returns to a
+// free list once the worker has released all of them, which it does in bulk after every batch.
+// Chunks are reused by whichever thread allocates next, so steady-state logging allocates
+// nothing and nothing is freed across threads
+class SpillArena {
+public:
+    static constexpr size_t chunk_size = 64 * 1024;  // Bytes per chunk; larger blocks get a chunk of their own
+    static constexpr size_t max_free_bytes = 16 * 1024 * 1024;  // Free chunk bytes kept for reuse
+
+    struct Chunk {
+        std::unique_ptr<char[]> data;  // Storage
+        size_t capacity = 0;  // Bytes in data
+        size_t used = 0;  // Bytes handed out
+        size_t live = 0;  // Blocks handed out and not released yet
+    };
+
+    SpillArena() { free_.reserve(max_free_bytes / chunk_size); }
+    SpillArena(const SpillArena&) = delete;
+    SpillArena& operator=(const SpillArena&) = delete;
+
+    // Allocate `size` bytes aligned for any type; `owner` receives the chunk to release it to
+    char* allocate(size_t size, Chunk*& owner) {
+        size = (size + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (current_ == nullptr || current_->used + size > current_->capacity) {
+            if (current_ != nullptr && current_->live == 0) {
+                recycle(current_);
+            }
+            current_ = take(size);
+        }
+        char* block = current_->data.get() + current_->used;
+        current_->used += size;
+        ++current_->live;
+        owner = current_;
+        return block;
+    }
+
+    // Release the blocks of written entries, taking the lock once; clears `chunks`
+    void release(std::vector<Chunk*>& chunks) {
+        if (chunks.empty()) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (Chunk* chunk : chunks) {
+            if (--chunk->live == 0 && chunk != current_) {
+                recycle(chunk);
+            }
+        }
+        chunks.clear();
+    }
+
+    void release(Chunk* chunk) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--chunk->live == 0 && chunk != current_) {
+            recycle(chunk);
+        }
+    }
+
+    // Chunks currently allocated, in use or free
+    size_t chunk_count() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return chunks_.size();
+    }
+
+private:
+    // A free chunk with room for `size` bytes, or a new one; mutex_ must be held
+    Chunk* take(size_t size) {
+        for (size_t i = free_.size(); i-- > 0;) {
+            if (free_[i]->capacity >= size) {
+                Chunk* chunk = free_[i];
+                free_.erase(free_.begin() + static_cast<std::ptrdiff_t>(i));
+                free_bytes_ -= chunk->capacity;
+                return chunk;
+            }
+        }
+        auto chunk = std::make_unique<Chunk>();
+        chunk->capacity = std::max(size, chunk_size);
+        chunk->data.reset(new char[chunk->capacity]);
+        chunks_.push_back(std::move(chunk));
+        return chunks_.back().get();
+    }
+
+    // Make an unused chunk available again, or free it when enough are kept; mutex_ must be held
+    void recycle(Chunk* chunk) {
+        chunk->used = 0;
+        if (current_ == chunk) {
+            current_ = nullptr;
+        }
+        if (free_bytes_ + chunk->capacity <= max_free_bytes) {
+            free_.push_back(chunk);
+            free_bytes_ += chunk->capacity;
+            return;
+        }
+        chunks_.erase(std::find_if(chunks_.begin(), chunks_.end(),
+                                   [chunk](const std::unique_ptr<Chunk>& owned) { return owned.get() == chunk; }));
+    }
+
+    mutable std::mutex mutex_;  // Guards everything below
+    std::vector<std::unique_ptr<Chunk>> chunks_;  // Every chunk, in use or free
+    std::vector<Chunk*> free_;  // Chunks without live blocks
+    size_t free_bytes_ = 0;  // Capacity of the chunks in free_
+    Chunk* current_ = nullptr;  // Chunk blocks are carved from
+};
+
+// Text of one queued entry (file name, message, captured string arguments), stored inline in
+// the ring slot when it fits and in a SpillArena block otherwise. reserve() sizes the storage
+// up front, so the views handed out by append() stay valid until the entry is consumed
+class EntryText {
+public:
+    static constexpr size_t inline_capacity = 256;
+
+    EntryText() = default;
+    EntryText(const EntryText&) = delete;
+    EntryText& operator=(const EntryText&) = delete;
+
+    // Make room for `size` bytes, dropping the previous contents; the previous arena block
+    // must have been taken with take_chunk()
+    void reserve(size_t size, SpillArena& arena) {
+        size_ = 0;
+        data_ = size <= inline_capacity ? inline_ : arena.allocate(size, chunk_);
+    }
+
+    std::string_view append(std::string_view text) {
+        char* start = data_ + size_;
+        if (!text.empty()) {  // An empty view may have no data, e.g. an empty file name or log context
+            std::memcpy(start, text.data(), text.size());
+        }
+        size_ += text.size();
+        return std::string_view(start, text.size());
+    }
+
+    // Raw storage for an object; reserve() must have counted size + align bytes for it
+    void* allocate(size_t size, size_t align) {
+        uintptr_t start = reinterpret_cast<uintptr_t>(data_ + size_);
+        size_t padding = (align - start % align) % align;
+        size_ += padding + size;
+        return data_ + (size_ - size);
+    }
+
+    // Arena chunk holding the text, for the consumer to release; nullptr when stored inline
+    SpillArena::Chunk* take_chunk() {
+        SpillArena::Chunk* chunk = chunk_;
+        chunk_ = nullptr;
+        return chunk;
+    }
+
+private:
+    alignas(std::max_align_t) char inline_[inline_capacity];
+    char* data_ = inline_;  // inline_ or the arena block
+    size_t size_ = 0;  // Bytes used
+    SpillArena::Chunk* chunk_ = nullptr;  // Arena chunk of data_, nullptr when inline
+};
+
+// Whether a deferred callable can write its message for the crash handler
+template <typename Fn, typename = void>
+inline constexpr bool has_crash_render_v = false;
+
+template <typename Fn>
+inline constexpr bool has_crash_render_v<Fn, std::void_t<decltype(std::declval<const Fn&>().crash_render(std::declval<FdWriter&>(), ""))>> = true;
+
+// Type-erased deferred log call stored in an AsyncLogger slot. The worker replays it
+// against the Logger, so lazy messages are built and formatted there. Small callables
+// live inline in the slot; larger ones go to caller-provided spill storage (see
+// spill_size) or, without it, the heap.
+class DeferredMessage {
+public:
+    static constexpr size_t inline_capacity = 96;
+
+    DeferredMessage() = default;
+    DeferredMessage(const DeferredMessage&) = delete;
+    DeferredMessage& operator=(const DeferredMessage&) = delete;
+    ~DeferredMessage() { reset(); }
+
+    // Bytes of spill storage (including alignment slack) a callable of type Fn needs, 0 if it fits inline
+    template <typename Fn>
+    static constexpr size_t spill_size() {
+        return sizeof(Fn) <= inline_capacity && alignof(Fn) <= alignof(std::max_align_t) ? 0 : sizeof(Fn) + alignof(Fn);
+    }
+
+    // Store a callable invoked as fn(logger, info, site) by the worker. An oversized one is
+    // constructed in `spill` when given (sized by spill_size, owned by the caller)
+    template <typename F>
+    void emplace(F&& fn, void* spill = nullptr) {
+        using Fn = std::decay_t<F>;
+        reset();
+        if constexpr (spill_size<Fn>() == 0) {
+            target_ = ::new (static_cast<void*>(storage_)) Fn(std::forward<F>(fn));
+            destroy_ = [](void* p) { static_cast<Fn*>(p)->~Fn(); };
+        } else if (spill != nullptr) {
+            target_ = ::new (spill) Fn(std::forward<F>(fn));
+            destroy_ = [](void* p) { static_cast<Fn*>(p)->~Fn(); };
+        } else {
+            target_ = new Fn(std::forward<F>(fn));
+            destroy_ = [](void* p) { delete static_cast<Fn*>(p); };
+        }
+        invoke_ = [](void* p, Logger& logger, const RecordInfo& info, const CallSite& site) {
+            (*static_cast<Fn*>(p))(logger, info, site);
+        };
+        if constexpr (has_crash_render_v<Fn>) {
+            crash_render_ = [](const void* p, FdWriter& out, const char* fmt) {
+                static_cast<const Fn*>(p)->crash_render(out, fmt);
+            };
+        }
+    }
+
+    explicit operator bool() const { return invoke_ != nullptr; }
+
+    // Replay the deferred call against the logger
+    void invoke(Logger& logger, const RecordInfo& info, const CallSite& site) {
+        invoke_(target_, logger, info, site);
+    }
+
+    // Render the message for the crash handler without allocating, if the callable supports it
+    // (captured format arguments do, lazy callables do not); returns whether it did
+    bool crash_render(FdWriter& out, const char* fmt) const {
+        if (crash_render_ == nullptr || target_ == nullptr) {
+            return false;
+        }
+        crash_render_(target_, out, fmt);
+        return true;
+    }
+
+    // Destroy the stored callable
+    void reset() {
+        if (destroy_) destroy_(target_);
+        target_ = nullptr;
+        invoke_ = nullptr;
+        destroy_ = nullptr;
+        crash_render_ = nullptr;
+    }
+
+private:
+    alignas(std::max_align_t) unsigned char storage_[inline_capacity];
+    void* target_ = nullptr;
+    void (*invoke_)(void*, Logger&, const RecordInfo&, const CallSite&) = nullptr;
+    void (*destroy_)(void*) = nullptr;
+    void (*crash_render_)(const void*, FdWriter&, const char*) = nullptr;
+};
+
+} // namespace detail
+
+class AsyncLogger;
+
+namespace detail {
+
+// AsyncLoggers whose queued records the crash handler writes out. A fixed array of atomic
+// pointers, so the handler can walk it without locking; loggers beyond capacity are not covered
+struct CrashRegistry {
+    static constexpr size_t capacity = 32;
+
+    std::atomic<AsyncLogger*> loggers[capacity] = {};
+
+    void add(AsyncLogger* logger) {
+        for (auto& slot : loggers) {
+            AsyncLogger* expected = nullptr;
+            if (slot.compare_exchange_strong(expected, logger)) {
+                return;
+            }
+        }
+    }
+
+    void remove(AsyncLogger* logger) {
+        for (auto& slot : loggers) {
+            AsyncLogger* expected = logger;
+            if (slot.compare_exchange_strong(expected, nullptr)) {
+                return;
+            }
+        }
+    }
+};
+
+inline CrashRegistry crash_registry;
+
+} // namespace detail
+
+// Asynchronous logger class
+class AsyncLogger {
+public:
+    // Constructor with optional configuration parameter
+    AsyncLogger(const LoggerConfig& config = LoggerConfig())
+        : logger_(workerConfig(config)),
+          overflow_policy_(config.overflow_policy),
+          batch_size_(config.batch_size > 0 ? config.batch_size : 1),
+          merged_(config.worker_count > 1 && config.shard_ordering == ShardOrdering::Merged),
+          stop_thread_(false),
+          // Before the workers start: a record logged from a formatter on a worker reaches it
+          stats_(config.collect_stats ? new detail::StatsCollector() : nullptr) {
+#if COLORLOG_CXX20
+        resume_executor_ = config.resume_executor;
+#endif
+        for (size_t i = 0; i < log_level_count; ++i) {
+            sample_rates_[i] = 1.0;
+            dropped_[i].store(0, std::memory_order_relaxed);
+        }
+        for (const auto& [level, rate] : config.overflow_sample_rates) {
+            sample_rates_[static_cast<size_t>(level)] = rate;
+        }
+        size_t count = std::max<size_t>(config.worker_count, 1);
+        for (size_t i = 0; i < count; ++i) {
+            auto shard = std::make_unique<Shard>(config.queue_capacity);
+            if (!merged_ && i > 0) {
+                // Unordered shards write to their own sinks, built from the config with a per-shard file name
+                LoggerConfig shard_config = workerConfig(config);
+                shard_config.log_file_name = shard_file_name(config.log_file_name, i);
+                shard->own = std::make_unique<Logger>(shard_config);
+            }
+            shard->logger = shard->own ? shard->own.get() : &logger_;
+            shards_.push_back(std::move(shard));
+        }
+        sample_threshold_ = static_cast<size_t>(config.overflow_sample_threshold *
+                                                static_cast<double>(shards_[0]->ring.capacity()));
+        for (size_t i = 0; i < count; ++i) {
+            Shard& shard = *shards_[i];
+            shard.worker = std::thread(&AsyncLogger::processQueue, this, std::ref(shard));
+            if (!config.worker_cpus.empty()) {
+                pinThread(shard.worker, config.worker_cpus[i % config.worker_cpus.size()]);
+            }
+        }
+        if (merged_) {
+            merge_thread_ = std::thread(&AsyncLogger::mergeShards, this);
+        }
+        detail::crash_registry.add(this);
+        if (stats_ && config.stats_report_interval.count() > 0) {
+            stats_reporter_ = std::make_unique<detail::PeriodicTask>(config.stats_report_interval, [this] {
+                log(LogLevel::info, "", 0, stats().summary());
+            });
+        }
+    }
+
+    AsyncLogger(const AsyncLogger&) = delete;              // Disable copy constructor
+    AsyncLogger& operator=(const AsyncLogger&) = delete;   // Disable copy assignment
+
+    // Destructor to clean up resources
+    ~AsyncLogger() {
+        stats_reporter_.reset();
+        detail::crash_registry.remove(this);
+        stop_thread_.store(true);
+        for (auto& shard : shards_) {
+            wakeWorker(*shard, true);
+        }
+        for (auto& shard : shards_) {
+            shard->worker.join();
+        }
+        if (merge_thread_.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(merge_mutex_);
+                merge_stop_ = true;
+            }
+            merge_cv_.notify_all();
+            merge_thread_.join();
+        }
+    }
+
+    // Set log level; filtering happens before a message is enqueued
+    void set_log_level(LogLevel level) {
+        logger_.set_log_level(level);
+        for (auto& shard : shards_) {
+            if (shard->own) shard->own->set_log_level(level);
+        }
+    }
+
+    // Get log level
+    LogLevel get_log_level() const {
+        return logger_.get_log_level();
+    }
+
+    // Check a level against the compile-time and runtime thresholds
+    bool should_log(LogLevel level) const {
+        return logger_.should_log(level);
+    }
+
+    // Sample a record before its message is built (see Logger::sample)
+    bool sample(LogLevel level) { return logger_.sample(level); }
+    bool sample(LogLevel level, uint32_t& count, uint32_t one_in) { return logger_.sample(level, count, one_in); }
+
+    // Asynchronous log function
+    template <COLORLOG_CONSTRAINED(PrintableStringOrIterable, T)>
+    void log(LogLevel level, const std::string& file, int line, const T& msg) {
+        uint32_t weight = logger_.should_log(level)
+            ? admit(CallSite{file.c_str(), line, level, "{}", 0}, [&msg] { return detail::hash_value(msg); }) : 0;
+        if (weight == 0) {
+            return;
+        }
+        enqueue(level, weight, [&](LogEntry& entry) {
+            entry.setLocation(level, file, line);
+            entry.setMessage(msg);
+        });
+    }
+
+    // Asynchronous log function through a static call site; only the site pointer is queued
+    template <COLORLOG_CONSTRAINED(PrintableStringOrIterable, T)>
+    void log(const CallSite& site, const T& msg) {
+        uint32_t weight = logger_.should_log(site.level) ? admit(site, [&msg] { return detail::hash_value(msg); }) : 0;
+        if (weight == 0) {
+            return;
+        }
+        enqueue(site.level, weight, [&](LogEntry& entry) {
+            entry.setSite(site);
+            entry.setMessage(msg);
+        });
+    }
+
+    // Lazy asynchronous log function: the callable is moved into the queue and
+    // invoked on the worker thread, so anything it captures by reference must outlive it.
+    // Only the rate limit applies, since repeats could not be detected without building the message
+    template <COLORLOG_CONSTRAINED(LazyMessage, F)>
+    void log(LogLevel level, const std::string& file, int line, F&& make_msg) {
+        uint32_t weight = logger_.should_log(level)
+            ? admit(CallSite{file.c_str(), line, level, "{}", 0}, detail::NoMessageHash{}) : 0;
+        if (weight == 0) {
+            return;
+        }
+        enqueue(level, weight, [&](LogEntry& entry) {
+            entry.setLocation(level, file, line);
+            entry.setLazy(std::forward<F>(make_msg));
+        });
+    }
+
+    // Lazy asynchronous log function through a static call site
+    template <COLORLOG_CONSTRAINED(LazyMessage, F)>
+    void log(const CallSite& site, F&& make_msg) {
+        uint32_t weight = logger_.should_log(site.level) ? admit(site, detail::NoMessageHash{}) : 0;
+        if (weight == 0) {
+            return;
+        }
+        enqueue(site.level, weight, [&](LogEntry& entry) {
+            entry.setSite(site);
+            entry.setLazy(std::forward<F>(make_msg));
+        });
+    }
+
+    // Format-string asynchronous log function: arguments are captured by value and formatted on
+    // the worker thread; `fmt` is copied with them, so it may be a runtime string
+    template <COLORLOG_CONSTRAINED_PACK(Formattable, Args)>
+    void logf(LogLevel level, const std::string& file, int line, const char* fmt, const Args&... args) {
+        uint32_t weight = logger_.should_log(level)
+            ? admit(CallSite{file.c_str(), line, level, fmt, 0}, [&] { return detail::hash_args(args...); }) : 0;
+        if (weight == 0) {
+            return;
+        }
+        enqueue(level, weight, [&](LogEntry& entry) {
+            entry.setLocation(level, file, line, fmt);
+            entry.setFormatted(args...);
+        });
+    }
+
+    // Format-string asynchronous log function through a static call site holding the format string
+    template <COLORLOG_CONSTRAINED_PACK(Formattable, Args)>
+    void logf(const CallSite& site, const Args&... args) {
+        uint32_t weight = logger_.should_log(site.level) ? admit(site, [&] { return detail::hash_args(args...); }) : 0;
+        if (weight == 0) {
+            return;
+        }
+        enqueue(site.level, weight, [&](LogEntry& entry) {
+            entry.setSite(site);
+            entry.setFormatted(args...);
+        });
+    }
+
+    // Position in the queue of the calling thread's shard; wait_durable() and durable() on it
+    // cover every message the thread logged before taking it
+    struct Sequence {
+        size_t shard = 0;     // Shard of the thread that took it
+        size_t position = 0;  // Ring position after the thread's last message
+    };
+
+#if COLORLOG_CXX20
+    // Awaitable returned by flush_async() and durable(). The coroutine is suspended without
+    // blocking a thread and resumed, through LoggerConfig::resume_executor or else directly on
+    // the worker thread, once the messages it covers are written and flushed (and synced to
+    // storage for durable()). Await it in the full expression that created it
+    class FlushAwaiter {
+    public:
+        bool await_ready() const { return logger_->reached(targets_, durable_); }
+        void await_suspend(std::coroutine_handle<> handle) {
+            handle_ = handle;
+            logger_->suspend(*this);
+        }
+        void await_resume() const noexcept {}
+
+    private:
+        friend class AsyncLogger;
+        FlushAwaiter(AsyncLogger& logger, std::vector<size_t> targets, bool durable)
+            : logger_(&logger), targets_(std::move(targets)), durable_(durable) {}
+
+        AsyncLogger* logger_;  // Logger being waited on
+        std::vector<size_t> targets_;  // Ring position to reach per shard
+        bool durable_;  // Wait for the sinks to be synced, not just flushed
+        std::coroutine_handle<> handle_;  // Suspended coroutine
+        FlushAwaiter* next_ = nullptr;  // Next suspended awaiter in awaiters_
+    };
+#endif
+
+    // Sequence of the calling thread's messages so far
+    Sequence sequence() const {
+        size_t index = currentShardIndex();
+        return Sequence{index, shards_[index]->ring.enqueue_position()};
+    }
+
+    // Block until every message logged before this call has been written and flushed.
+    // While a caller waits here the workers flush after every batch
+    void flush() { waitAll(false); }
+
+    // Block until the messages up to `sequence` (or, without one, everything logged before the
+    // call) have been written and synced to storage with Sink::sync, e.g. fsync for files
+    void wait_durable(Sequence sequence) {
+        addWaiter(true);
+        Shard& shard = *shards_[std::min(sequence.shard, shards_.size() - 1)];
+        shard.flush_requested.store(true);
+        wakeWorker(shard, true);
+        waitReached(shard, sequence.position, true);
+        removeWaiter(true);
+    }
+    void wait_durable() { waitAll(true); }
+
+#if COLORLOG_CXX20
+    // Awaitable counterparts of flush() and wait_durable(): co_await logger.flush_async()
+    FlushAwaiter flush_async() { return FlushAwaiter(*this, allTargets(), false); }
+    FlushAwaiter durable(Sequence sequence) { return FlushAwaiter(*this, targetsOf(sequence), true); }
+    FlushAwaiter durable() { return FlushAwaiter(*this, allTargets(), true); }
+#endif
+
+    // Snapshot of the counters kept with LoggerConfig::collect_stats, summed over the shards.
+    // The latency histogram measures from enqueue on the producer to the worker writing the record
+    LoggerStats stats() const {
+        LoggerStats snapshot = logger_.stats();
+        for (const auto& shard : shards_) {
+            if (shard->own) snapshot.merge(shard->own->stats());
+        }
+        if (stats_) {
+            stats_->add_to(snapshot);
+            for (const auto& shard : shards_) {
+                snapshot.queue_depth += shard->ring.size_approx();
+            }
+        }
+        return snapshot;
+    }
+
+    // Number of messages dropped at the given level and not yet reported
+    uint64_t dropped(LogLevel level) const {
+        return dropped_[static_cast<size_t>(level)].load(std::memory_order_relaxed);
+    }
+
+    // Write the records still queued in the rings as plain text lines, using only
+    // async-signal-safe operations (see CrashHandler). Lazily built messages are listed without
+    // their text; records a worker has already taken but not yet written are not included
+    void dump_pending(detail::FdWriter& out) const {
+        for (const auto& shard : shards_) {
+            shard->ring.visit_pending([&out](const LogEntry& entry) { entry.dumpTo(out); });
+        }
+    }
+
+    // File name used by unordered shard `index` (ShardOrdering::PerShard): "app.log" becomes
+    // "app.shard1.log"; shard 0 and an empty name are unchanged
+    static std::string shard_file_name(const std::string& file, size_t index) {
+        if (index == 0 || file.empty()) {
+            return file;
+        }
+        std::filesystem::path path(file);
+        std::string extension = path.extension().string();
+        path.replace_extension();
+        return path.string() + ".shard" + std::to_string(index) + extension;
+    }
+
+private:
+    // Struct to represent a log entry; slots are preallocated and reused. The file name, message
+    // and captured string arguments are copied into the slot's inline text storage, or into the
+    // shard's arena when they do not fit, so publishing an entry does not allocate
+    struct LogEntry {
+        RecordInfo info;  // Captured on the producer thread when the entry is published
+        const CallSite* site = nullptr;  // Static call site, or nullptr when file/line/format below are used
+        LogLevel level = LogLevel::unknown;
+        std::string_view file;  // Into text
+        int line = 0;
+        const char* format = "{}";  // Into text when copy_format is set
+        bool copy_format = false;  // Whether format came from the caller and is copied by storeText
+        std::string_view msg;  // Into text
+        detail::SpillArena* arena = nullptr;  // Arena of the entry's shard, set when it is published
+        detail::EntryText text;  // Storage behind file, msg and captured string arguments
+        detail::DeferredMessage deferred;  // Set instead of msg for lazily built messages
+
+        void setSite(const CallSite& s) {
+            site = &s;
+            level = s.level;
+            file = std::string_view();
+            copy_format = false;
+        }
+
+        // `f` and `fmt` are only referenced here; the set* call that follows copies them into text
+        void setLocation(LogLevel lvl, std::string_view f, int l, const char* fmt = nullptr) {
+            site = nullptr;
+            level = lvl;
+            file = f;
+            line = l;
+            format = fmt != nullptr ? fmt : "{}";
+            copy_format = fmt != nullptr;
+        }
+
+        // Store the rendered message; types without a string conversion go through the
+        // thread's scratch stream. Contiguous ranges of arithmetic values are copied instead and
+        // formatted by the worker, iterables concatenating their elements as Logger::log does
+        template <typename T>
+        void setMessage(const T& m) {
+            if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+                storeText(std::string_view(m), 0);
+            } else if constexpr (detail::is_range_view_v<T>) {
+                if constexpr (std::is_same_v<detail::capture_t<T>, std::string>) {
+                    setFormattedMessage(m);
+                } else {
+                    setRange(m);
+                }
+            } else if constexpr (detail::copies_iterable_v<T>) {
+                setRange(join(m, ""));
+            } else {
+                setFormattedMessage(m);
+            }
+        }
+
+        template <typename T>
+        void setFormattedMessage(const T& m) {
+            detail::ScratchLease scratch;
+            detail::append_message(scratch->stream, scratch->message, m);
+            storeText(scratch->message.view(), 0);
+        }
+
+        template <typename It>
+        void setRange(const RangeView<It>& view) {
+            using Call = RangeCall<detail::capture_t<RangeView<It>>>;
+            constexpr size_t spill = detail::DeferredMessage::spill_size<Call>();
+            storeText(std::string_view(), capturedSize(view) + spill);
+            void* storage = spill ? text.allocate(sizeof(Call), alignof(Call)) : nullptr;
+            deferred.emplace(Call{capture(view)}, storage);
+        }
+
+        template <typename F>
+        void setLazy(F&& make_msg) {
+            auto call = [fn = std::forward<F>(make_msg)](Logger& logger, const RecordInfo& captured,
+                                                         const CallSite& call_site) mutable {
+                logger.log_captured(captured, call_site, fn());
+            };
+            using Call = decltype(call);
+            constexpr size_t spill = detail::DeferredMessage::spill_size<Call>();
+            storeText(std::string_view(), spill);
+            deferred.emplace(std::move(call), spill ? text.allocate(sizeof(Call), alignof(Call)) : nullptr);
+        }
+
+        // Capture the arguments by value, string-like ones as views of copies in text
+        template <typename... Args>
+        void setFormatted(const Args&... args) {
+            using Call = FormattedCall<detail::capture_t<Args>...>;
+            constexpr size_t spill = detail::DeferredMessage::spill_size<Call>();
+            storeText(std::string_view(), (capturedSize(args) + ... + spill));
+            void* storage = spill ? text.allocate(sizeof(Call), alignof(Call)) : nullptr;
+            deferred.emplace(Call{{capture(args)...}}, storage);
+        }
+
+        // Replace a message whose capture threw (an operator<< or the arena) with a note about it.
+        // Only inline storage is used and the log context is dropped, so this cannot throw
+        void setFailed(std::string_view reason) {
+            constexpr std::string_view prefix = "<formatting failed: ";
+            char note[detail::EntryText::inline_capacity];
+            size_t name_size = std::min(file.size(), sizeof(note) / 2);
+            size_t reason_size = std::min(reason.size(), sizeof(note) - name_size - 1 - prefix.size() - 1);
+            char* out = note;
+            if (name_size > 0) {  // Copied out first: file may point into the text dropped below
+                std::memcpy(out, file.data(), name_size);
+                out += name_size;
+            }
+            *out++ = '\0';
+            std::memcpy(out, prefix.data(), prefix.size());
+            out += prefix.size();
+            std::memcpy(out, reason.data(), reason_size);
+            out += reason_size;
+            *out++ = '>';
+            deferred.reset();
+            if (detail::SpillArena::Chunk* chunk = text.take_chunk()) {
+                arena->release(chunk);
+            }
+            text.reserve(sizeof(note), *arena);
+            file = text.append(std::string_view(note, name_size));
+            text.append(std::string_view("", 1));
+            msg = text.append(std::string_view(note + name_size + 1, static_cast<size_t>(out - note) - name_size - 1));
+            info.context = std::string_view();
+            format = "{}";
+            copy_format = false;
+        }
+
+        // Size text for the file name, the caller's format string, `message`, the log context and
+        // `extra` more bytes, then copy all but the last. The file name and format string are
+        // NUL-terminated, since the worker hands them on as CallSite::file and CallSite::format
+        void storeText(std::string_view message, size_t extra) {
+            std::string_view fmt = copy_format ? std::string_view(format) : std::string_view();
+            text.reserve(file.size() + 1 + (copy_format ? fmt.size() + 1 : 0) + message.size() + info.context.size() + extra,
+                         *arena);
+            file = text.append(file);
+            text.append(std::string_view("", 1));
+            if (copy_format) {
+                format = text.append(fmt).data();
+                text.append(std::string_view("", 1));
+            }
+            msg = text.append(message);
+            info.context = text.append(info.context);
+        }
+
+        template <typename T>
+        static size_t capturedSize(const T& value) {
+            using Captured = detail::capture_t<T>;
+            if constexpr (std::is_same_v<Captured, std::string_view>) {
+                return std::string_view(value).size();
+            } else if constexpr (detail::is_range_view_v<Captured>) {
+                using Element = detail::iter_value_t<decltype(value.first)>;
+                return keptElements(value) * sizeof(Element) + alignof(Element) + value.separator.size();
+            } else {
+                return 0;
+            }
+        }
+
+        template <typename T>
+        detail::capture_t<T> capture(const T& value) {
+            using Captured = detail::capture_t<T>;
+            if constexpr (std::is_same_v<Captured, std::string_view>) {
+                return text.append(std::string_view(value));
+            } else if constexpr (detail::is_range_view_v<Captured>) {
+                // Copy the elements that will be written; the rest only count towards "(N more)"
+                using Element = detail::iter_value_t<decltype(value.first)>;
+                size_t count = static_cast<size_t>(value.last - value.first);
+                size_t kept = keptElements(value);
+                auto* elements = static_cast<Element*>(text.allocate(kept * sizeof(Element), alignof(Element)));
+                if (kept != 0) {
+                    std::memcpy(elements, std::addressof(*value.first), kept * sizeof(Element));
+                }
+                std::string_view separator = text.append(value.separator);
+                return Captured{elements, elements + kept, separator, 0, value.omitted + count - kept};
+            } else if constexpr (detail::is_range_view_v<T>) {
+                detail::ScratchLease scratch;
+                detail::append_value(scratch->stream, scratch->message, value);
+                return std::string(scratch->message.view());
+            } else {
+                return value;
+            }
+        }
+
+        template <typename It>
+        static size_t keptElements(const RangeView<It>& view) {
+            size_t count = static_cast<size_t>(view.last - view.first);
+            return view.max_elements != 0 ? std::min(count, view.max_elements) : count;
+        }
+
+        // Write the entry as a plain "[LEVEL] file:line msg" line for the crash handler
+        void dumpTo(detail::FdWriter& out) const {
+            std::string_view entry_file = site != nullptr && site->file != nullptr ? std::string_view(site->file) : file;
+            int entry_line = site != nullptr ? site->line : line;
+            out.push_back('[');
+            out.append(log_level_name(level));
+            out.append("] ");
+            if (!entry_file.empty() && entry_line > 0) {
+                out.append(entry_file);
+                out.push_back(':');
+                out.append_value(entry_line);
+                out.push_back(' ');
+            }
+            if (!deferred) {
+                out.append(msg);
+            } else if (!deferred.crash_render(out, site != nullptr ? site->format : format)) {
+                out.append("(lazy message not built)");
+            }
+            out.push_back('\n');
+        }
+    };
+
+    // Deferred format call holding the captured arguments, formatted on the worker thread
+    template <typename... Values>
+    struct FormattedCall {
+        std::tuple<Values...> values;
+
+        void operator()(Logger& logger, const RecordInfo& captured, const CallSite& call_site) const {
+            std::apply([&](const auto&... v) { logger.logf_captured(captured, call_site, v...); }, values);
+        }
+
+        void crash_render(detail::FdWriter& out, const char* fmt) const {
+            std::apply([&](const auto&... v) { out.format(fmt, v...); }, values);
+        }
+    };
+
+    // Deferred message of a range whose elements were copied into the entry
+    template <typename View>
+    struct RangeCall {
+        View view;
+
+        void operator()(Logger& logger, const RecordInfo& captured, const CallSite& call_site) const {
+            logger.log_captured(captured, call_site, view);
+        }
+
+        void crash_render(detail::FdWriter& out, const char*) const { out.append_value(view); }
+    };
+
+    // One ring and its worker. Producer threads are assigned to shards by thread id, so each
+    // thread's messages stay in order; merged shards hand their batches to the merge thread
+    struct Shard {
+        explicit Shard(size_t capacity) : ring(capacity) {}
+
+        detail::BoundedRing<LogEntry> ring;  // Preallocated slots shared by this shard's producers and its worker
+        detail::SpillArena arena;  // Storage for entry text too large for a slot
+        Logger* logger = nullptr;  // Logger the worker writes through (logger_ unless unordered)
+        std::unique_ptr<Logger> own;  // Per-shard logger for ShardOrdering::PerShard
+        Logger::Batch batches[2];  // Reused batch buffers; merged shards fill one while the other is merged
+        size_t filling = 0;  // Index of the batch being filled
+        Logger::Batch* ready = nullptr;  // Batch handed to the merge thread, guarded by merge_mutex_
+        size_t ready_pos = 0;  // Ring position covered by the ready batch
+        bool ready_flush = false;  // The ready batch must be flushed once written
+        std::thread worker;  // Worker thread draining the ring
+        std::mutex park_mutex;  // Mutex used only to park and wake an idle worker
+        std::condition_variable cv;  // Condition variable for parking the worker
+        std::atomic<bool> parked{false};  // Set while the worker is waiting for work
+        std::atomic<bool> flush_requested{false};  // Set by flush() to make the worker flush its output
+        std::atomic<size_t> flushed_pos{0};  // Ring position up to which entries are written and flushed
+        std::atomic<size_t> synced_pos{0};  // Ring position up to which entries are synced to storage
+    };
+
+    // Shard of the calling thread
+    size_t currentShardIndex() const {
+        return shards_.size() == 1 ? 0 : RecordInfo::current_thread_id() % shards_.size();
+    }
+    Shard& currentShard() { return *shards_[currentShardIndex()]; }
+
+    // Current enqueue position of every shard, or of the sequence's shard only (0 for the others)
+    std::vector<size_t> allTargets() const {
+        std::vector<size_t> targets(shards_.size());
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            targets[i] = shards_[i]->ring.enqueue_position();
+        }
+        return targets;
+    }
+    std::vector<size_t> targetsOf(Sequence sequence) const {
+        std::vector<size_t> targets(shards_.size());
+        targets[std::min(sequence.shard, shards_.size() - 1)] = sequence.position;
+        return targets;
+    }
+
+    // Whether every shard has flushed (or synced, when `durable`) up to its target
+    bool reached(const std::vector<size_t>& targets, bool durable) const {
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            const Shard& shard = *shards_[i];
+            if ((durable ? shard.synced_pos : shard.flushed_pos).load() < targets[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Count a waiter, so the workers flush (and sync) after every batch
+    void addWaiter(bool durable) {
+        flush_waiters_.fetch_add(1);
+        if (durable) {
+            sync_waiters_.fetch_add(1);
+        }
+    }
+
+    // Ask the shards a waiter targets to flush now
+    void requestFlush(const std::vector<size_t>& targets) {
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            if (targets[i] > 0) {
+                shards_[i]->flush_requested.store(true);
+                wakeWorker(*shards_[i], true);
+            }
+        }
+    }
+
+    void removeWaiter(bool durable) {
+        if (durable) {
+            sync_waiters_.fetch_sub(1);
+        }
+        flush_waiters_.fetch_sub(1);
+    }
+
+    // Block until every shard has flushed (or synced) what was logged before the call
+    void waitAll(bool durable) {
+        addWaiter(durable);
+        for (auto& shard : shards_) {
+            shard->flush_requested.store(true);
+            wakeWorker(*shard, true);
+        }
+        for (auto& shard : shards_) {
+            waitReached(*shard, shard->ring.enqueue_position(), durable);
+        }
+        removeWaiter(durable);
+    }
+
+    void waitReached(Shard& shard, size_t target, bool durable) {
+        std::unique_lock<std::mutex> lock(flush_mutex_);
+        flushed_cv_.wait(lock, [&shard, target, durable] {
+            return (durable ? shard.synced_pos : shard.flushed_pos).load() >= target;
+        });
+    }
+
+#if COLORLOG_CXX20
+    // Park a suspended awaiter on the lock-free awaiters_ stack. It is counted before the push, since
+    // a worker may resume it (ending its lifetime) as soon as it is on the stack, and the shards are
+    // woken after, so the flush that follows is guaranteed to see it
+    void suspend(FlushAwaiter& awaiter) {
+        std::vector<size_t> targets = awaiter.targets_;
+        addWaiter(awaiter.durable_);
+        awaiter.next_ = awaiters_.load();
+        while (!awaiters_.compare_exchange_weak(awaiter.next_, &awaiter)) {}
+        requestFlush(targets);
+    }
+
+    // Resume the awaiters whose targets have been reached and put the others back. A flush that
+    // lands while the list is taken bumps resume_epoch_, which sends this round back for another look
+    void resumeAwaiters() {
+        uint64_t epoch = resume_epoch_.fetch_add(1) + 1;
+        while (awaiters_.load() != nullptr) {
+            FlushAwaiter* pending = awaiters_.exchange(nullptr);
+            FlushAwaiter* ready = nullptr;
+            while (pending != nullptr) {
+                FlushAwaiter* next = pending->next_;
+                if (reached(pending->targets_, pending->durable_)) {
+                    pending->next_ = ready;
+                    ready = pending;
+                } else {
+                    pending->next_ = awaiters_.load();
+                    while (!awaiters_.compare_exchange_weak(pending->next_, pending)) {}
+                }
+                pending = next;
+            }
+            while (ready != nullptr) {
+                FlushAwaiter* next = ready->next_;  // The awaiter is gone once its coroutine resumes
+                removeWaiter(ready->durable_);
+                if (resume_executor_) {
+                    resume_executor_(ready->handle_);
+                } else {
+                    ready->handle_.resume();
+                }
+                ready = next;
+            }
+            uint64_t latest = resume_epoch_.load();
+            if (latest == epoch) {
+                break;
+            }
+            epoch = latest;
+        }
+    }
+#endif
+
+    // Apply sampling and the site limits on the producer thread, before anything is formatted or
+    // captured; notes about records suppressed earlier are queued ahead of the record that passed.
+    // Returns the record's sample weight, or 0 to drop it
+    template <typename HashFn>
+    uint32_t admit(const CallSite& site, HashFn&& hash) {
+        uint32_t weight = logger_.take_sample(site.level);
+        if (weight == 0) {
+            return 0;
+        }
+        detail::SiteVerdict verdict = logger_.check_site(site, std::forward<HashFn>(hash));
+        if (!verdict.write) {
+            return 0;
+        }
+        auto note = [&](const std::string& text) {
+            enqueue(site.level, 1, [&](LogEntry& entry) {
+                entry.setLocation(site.level, site.file, site.line);
+                entry.setMessage(text);
+            });
+        };
+        if (verdict.repeated > 0) note(detail::repeated_note(verdict.repeated));
+        if (verdict.limited > 0) note(detail::limited_note(verdict.limited));
+        return weight;
+    }
+
+    // Publish an entry into the ring, applying the overflow policy when it is full
+    template <typename Fill>
+    void enqueue(LogLevel level, uint32_t sample_weight, Fill&& fill) {
+        Shard& shard = currentShard();
+        detail::BoundedRing<LogEntry>& ring = shard.ring;
+        if (overflow_policy_ == OverflowPolicy::Sample && ring.size_approx() >= sample_threshold_ &&
+            detail::fast_random() >= sample_rates_[static_cast<size_t>(level)]) {
+            countDropped(level);
+            return;
+        }
+        // The timestamp is taken here, on the calling thread, however late the worker formats the entry
+        auto publish = [this, &fill, &shard, sample_weight](LogEntry& entry) {
+            entry.info = logger_.capture_info();
+            entry.info.sample_weight = sample_weight;
+            entry.info.component = detail::current_component();
+            entry.arena = &shard.arena;
+            // The slot is claimed by now and has to be published, or the worker would wait on it forever
+            try {
+                fill(entry);
+            } catch (const std::exception& e) {
+                std::cerr << "Logging exception: " << e.what() << std::endl;
+                entry.setFailed(e.what());
+            } catch (...) {
+                entry.setFailed("unknown exception");
+            }
+        };
+        while (!ring.try_push(publish)) {
+            switch (overflow_policy_) {
+            case OverflowPolicy::Block:
+                if (onOwnThread()) {
+                    // Logged while a worker or the merge thread writes records (a formatter or a lazy
+                    // message): only those threads free slots, so waiting here would never end
+                    countDropped(level);
+                    return;
+                }
+                // Backpressure: yield to the worker until a slot frees up
+                wakeWorker(shard, true);
+                std::this_thread::yield();
+                break;
+            case OverflowPolicy::DropOldest:
+                // Evict the oldest queued entry, then retry
+                ring.try_pop([this, &shard](LogEntry& oldest) {
+                    countDropped(oldest.level);
+                    oldest.deferred.reset();
+                    if (detail::SpillArena::Chunk* chunk = oldest.text.take_chunk()) {
+                        shard.arena.release(chunk);
+                    }
+                });
+                break;
+            case OverflowPolicy::DropNewest:
+            case OverflowPolicy::Sample:
+                countDropped(level);
+                wakeWorker(shard, false);
+                return;
+            }
+        }
+        if (stats_) {
+            stats_->record_depth(ring.size_approx());
+        }
+        wakeWorker(shard, false);
+        // A fatal message must be on its way to disk before the caller can abort; the logger's
+        // own threads cannot wait for that, it is written once they return to their loop
+        if (level == LogLevel::fatal && !onOwnThread()) {
+            flush();
+        }
+    }
+
+    void countDropped(LogLevel level) {
+        dropped_[static_cast<size_t>(level)].fetch_add(1, std::memory_order_relaxed);
+        if (stats_) {
+            stats_->record_drop();
+        }
+    }
+
+    // Config of the Loggers the workers write through; the periodic stats line is reported by the
+    // AsyncLogger itself, so that it covers the queues
+    static LoggerConfig workerConfig(const LoggerConfig& config) {
+        LoggerConfig worker = config;
+        worker.stats_report_interval = std::chrono::milliseconds(0);
+        return worker;
+    }
+
+    // Emit one summary line for messages dropped since the last report
+    void reportDropped(Logger& logger) {
+        static const char* const names[log_level_count] = {"debug", "info", "warn", "error", "fatal", "trace", "unknown"};
+        uint64_t counts[log_level_count];
+        uint64_t total = 0;
+        for (size_t i = 0; i < log_level_count; ++i) {
+            counts[i] = dropped_[i].exchange(0, std::memory_order_relaxed);
+            total += counts[i];
+        }
+        if (total == 0) return;
+        std::ostringstream oss;
+        oss << "colorlog: dropped " << total << " messages (";
+        const char* separator = "";
+        for (size_t i = 0; i < log_level_count; ++i) {
+            if (counts[i] == 0) continue;
+            oss << separator << names[i] << "=" << counts[i];
+            separator = ", ";
+        }
+        oss << ")";
+        logger.log(LogLevel::warn, "", 0, oss.str());
+    }
+
+    // Wake the shard's worker if it is parked (or unconditionally when forced)
+    void wakeWorker(Shard& shard, bool force) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (force || shard.parked.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(shard.park_mutex);
+            shard.cv.notify_one();
+        }
+    }
+
+    // Pin a worker to one CPU; best effort, ignored where affinity is unsupported
+    static void pinThread(std::thread& thread, int cpu) {
+#if defined(__linux__)
+        if (cpu < 0 || cpu >= CPU_SETSIZE) return;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+        (void)thread;
+        (void)cpu;
+#endif
+    }
+
+    // AsyncLogger whose worker or merge thread the calling thread is, or nullptr
+    static const AsyncLogger*& ownerOfThread() {
+        thread_local const AsyncLogger* owner = nullptr;
+        return owner;
+    }
+    bool onOwnThread() const { return ownerOfThread() == this; }
+
+    // Drain one shard's ring
+    void processQueue(Shard& shard) {
+        ownerOfThread() = this;
+        Logger& logger = *shard.logger;
+        std::vector<detail::SpillArena::Chunk*> spilled;  // Arena blocks of the entries in the current batch
+        auto write_entry = [&logger, &spilled](LogEntry& entry) {
+            if (detail::SpillArena::Chunk* chunk = entry.text.take_chunk()) {
+                spilled.push_back(chunk);
+            }
+            CallSite location{entry.file.data(), entry.line, entry.level, entry.format, 0};
+            const CallSite& site = entry.site != nullptr ? *entry.site : location;
+            if (!entry.deferred) {
+                logger.log_captured(entry.info, site, entry.msg);
+                return;
+            }
+            try {
+                entry.deferred.invoke(logger, entry.info, site);
+            } catch (const std::exception& e) {
+                std::cerr << "Logging exception: " << e.what() << std::endl;
+            }
+            entry.deferred.reset();
+        };
+        size_t handed = 0;  // Ring position covered by the last batch handed to the merge thread
+        while (true) {
+            // Drain in batches: each one is formatted into memory and written with one call per stream,
+            // or handed to the merge thread when the shards share their sinks
+            size_t popped;
+            do {
+                if (merged_) {
+                    logger.begin_ordered_batch(shard.batches[shard.filling]);
+                } else {
+                    logger.begin_batch(shard.batches[0]);
+                }
+                popped = 0;
+                while (popped < batch_size_ && shard.ring.try_pop(write_entry)) {
+                    ++popped;
+                }
+                // The batch holds its own copy of the text, so the arena blocks can go back now
+                shard.arena.release(spilled);
+                if (merged_) {
+                    logger.release_batch();
+                    size_t consumed = shard.ring.dequeue_position();
+                    bool flush = flushWanted(shard);
+                    if (popped > 0 || flush || consumed != handed) {
+                        handOff(shard, consumed, flush);
+                        handed = consumed;
+                    }
+                } else {
+                    logger.end_batch();
+                }
+            } while (popped == batch_size_);
+            reportDropped(logger);
+            if (!merged_) {
+                // Everything before this position has now been written (or evicted)
+                size_t consumed = shard.ring.dequeue_position();
+                if (flushWanted(shard)) {
+                    publishFlushed(shard, consumed, flushOrSync(logger));
+                } else {
+                    logger.flush_if_due();
+                }
+            }
+            if (stop_thread_.load()) {
+                if (shard.ring.empty()) break;
+                continue;
+            }
+            // Park until a producer publishes a slot, a flush is requested or pending output is due
+            auto ready = [this, &shard] {
+                return !shard.ring.empty() || stop_thread_.load() || shard.flush_requested.load();
+            };
+            std::chrono::milliseconds flush_delay = merged_ ? std::chrono::milliseconds::zero() : logger.pending_flush_delay();
+            std::unique_lock<std::mutex> lock(shard.park_mutex);
+            shard.parked.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (flush_delay.count() > 0) {
+                shard.cv.wait_for(lock, flush_delay, ready);
+            } else {
+                shard.cv.wait(lock, ready);
+            }
+            shard.parked.store(false, std::memory_order_relaxed);
+        }
+        if (merged_) {
+            handOff(shard, shard.ring.dequeue_position(), true);
+        } else {
+            size_t consumed = shard.ring.dequeue_position();
+            publishFlushed(shard, consumed, flushOrSync(logger));
+        }
+    }
+
+    // Flush the logger's sinks, or sync them while someone waits for durability; returns whether it synced
+    bool flushOrSync(Logger& logger) {
+        if (sync_waiters_.load() > 0) {
+            logger.sync();
+            return true;
+        }
+        logger.flush();
+        return false;
+    }
+
+    // Whether the worker must flush now: flush() asked for it or is still waiting
+    bool flushWanted(Shard& shard) {
+        return shard.flush_requested.exchange(false) || flush_waiters_.load() > 0;
+    }
+
+    // Give the shard's filled batch to the merge thread and switch to its other batch,
+    // waiting until the merge thread has finished with that one
+    void handOff(Shard& shard, size_t position, bool flush) {
+        std::unique_lock<std::mutex> lock(merge_mutex_);
+        handoff_cv_.wait(lock, [&shard] { return shard.ready == nullptr; });
+        shard.ready = &shard.batches[shard.filling];
+        shard.ready_pos = position;
+        shard.ready_flush = flush;
+        shard.filling ^= 1;
+        merge_cv_.notify_one();
+    }
+
+    // Merge thread for ShardOrdering::Merged: writes the batches the shards have handed off,
+    // interleaved by timestamp, and applies the flush policy once per round
+    void mergeShards() {
+        ownerOfThread() = this;
+        std::vector<Shard*> round;
+        std::vector<Logger::Batch*> batches;
+        round.reserve(shards_.size());
+        batches.reserve(shards_.size());
+        while (true) {
+            bool flush = false;
+            {
+                std::chrono::milliseconds flush_delay = logger_.pending_flush_delay();
+                std::unique_lock<std::mutex> lock(merge_mutex_);
+                auto ready = [this] {
+                    return merge_stop_ || std::any_of(shards_.begin(), shards_.end(),
+                                                      [](const auto& shard) { return shard->ready != nullptr; });
+                };
+                if (flush_delay.count() > 0) {
+                    merge_cv_.wait_for(lock, flush_delay, ready);
+                } else {
+                    merge_cv_.wait(lock, ready);
+                }
+                round.clear();
+                batches.clear();
+                for (auto& shard : shards_) {
+                    if (shard->ready != nullptr) {
+                        round.push_back(shard.get());
+                        batches.push_back(shard->ready);
+                        flush = flush || shard->ready_flush;
+                    }
+                }
+                if (round.empty() && merge_stop_) break;
+            }
+            logger_.merge_batches(batches.data(), batches.size(), merged_batch_);
+            flush = flush || flush_waiters_.load() > 0;
+            bool synced = false;
+            if (flush) {
+                synced = flushOrSync(logger_);
+            } else {
+                logger_.flush_if_due();
+            }
+            {
+                std::lock_guard<std::mutex> lock(merge_mutex_);
+                for (Shard* shard : round) {
+                    if (synced) shard->synced_pos.store(shard->ready_pos);
+                    if (flush) shard->flushed_pos.store(shard->ready_pos);
+                    shard->ready = nullptr;
+                }
+            }
+            handoff_cv_.notify_all();
+            if (flush) notifyFlushed();
+        }
+    }
+
+    // Record the shard's flushed (and synced) position and wake threads blocked in flush()
+    void publishFlushed(Shard& shard, size_t position, bool synced) {
+        if (synced) {
+            shard.synced_pos.store(position);
+        }
+        shard.flushed_pos.store(position);
+        notifyFlushed();
+    }
+
+    void notifyFlushed() {
+        if (flush_waiters_.load() > 0) {
+            {
+                std::lock_guard<std::mutex> lock(flush_mutex_);
+                flushed_cv_.notify_all();
+            }
+#if COLORLOG_CXX20
+            resumeAwaiters();
+#endif
+        }
+    }
+
+    Logger logger_;  // Logger instance, shared by all shards unless they are unordered
+    OverflowPolicy overflow_policy_;  // Behaviour when a ring is full
+    size_t sample_threshold_ = 0;  // Ring depth at which OverflowPolicy::Sample starts sampling
+    double sample_rates_[log_level_count];  // Keep probability per level under OverflowPolicy::Sample
+    size_t batch_size_;  // Maximum entries written per batch
+    bool merged_;  // Several shards merged by timestamp into logger_'s sinks
+    std::vector<std::unique_ptr<Shard>> shards_;  // Rings and workers; producers pick one by thread id
+    std::atomic<uint64_t> dropped_[log_level_count];  // Dropped messages per level since the last report
+    std::atomic<bool> stop_thread_;  // Flag to stop the worker threads
+    std::thread merge_thread_;  // Merge thread, running only for merged shards
+    Logger::Batch merged_batch_;  // Output buffers of the merge thread
+    std::mutex merge_mutex_;  // Guards the shards' ready batches and merge_stop_
+    std::condition_variable merge_cv_;  // Signalled when a shard hands off a batch
+    std::condition_variable handoff_cv_;  // Signalled when the merge thread is done with handed-off batches
+    bool merge_stop_ = false;  // Set once the shard workers have exited
+    std::atomic<int> flush_waiters_{0};  // Threads blocked in flush() or wait_durable() and suspended awaiters
+    std::atomic<int> sync_waiters_{0};  // Those of them waiting for durability
+#if COLORLOG_CXX20
+    std::atomic<FlushAwaiter*> awaiters_{nullptr};  // Suspended awaiters, linked through FlushAwaiter::next_
+    std::atomic<uint64_t> resume_epoch_{0};  // Bumped by every resumeAwaiters() round
+    std::function<void(std::coroutine_handle<>)> resume_executor_;  // LoggerConfig::resume_executor
+#endif
+    std::mutex flush_mutex_;  // Mutex for flushed_cv_
+    std::condition_variable flushed_cv_;  // Signalled when a shard's flushed position advances
+    std::unique_ptr<detail::StatsCollector> stats_;  // Drop and queue-depth counters, nullptr unless collect_stats
+    std::unique_ptr<detail::PeriodicTask> stats_reporter_;  // Periodic stats line
+};
+
+#if !defined(_WIN32) && !defined(_WIN64)
+// Crash handler for SIGSEGV, SIGABRT, SIGBUS, SIGILL and SIGFPE. It writes the records still
+// queued in every AsyncLogger and a stack trace to a file descriptor, then re-raises the signal
+// with the previous handler so the process still terminates (and dumps core) as before. The
+// handler allocates nothing and takes no locks: text goes out with write(2), the trace with
+// backtrace_symbols_fd
+class CrashHandler {
+public:
+    // Install the handlers, writing to `fd`; returns false if a handler could not be installed
+    static bool install(int fd = STDERR_FILENO) {
+        void* frame;
+        ::backtrace(&frame, 1);  // Loads the unwinder now; its first use may allocate
+        stack_t stack{};
+        stack.ss_sp = alt_stack_;
+        stack.ss_size = sizeof(alt_stack_);
+        ::sigaltstack(&stack, nullptr);  // Lets the handler run after a stack overflow on this thread
+        fd_.store(fd);
+        struct sigaction action{};
+        action.sa_sigaction = &CrashHandler::onSignal;
+        action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+        sigemptyset(&action.sa_mask);
+        bool ok = true;
+        for (size_t i = 0; i < signal_count; ++i) {
+            struct sigaction replaced{};
+            bool installed = ::sigaction(signals_[i], &action, &replaced) == 0;
+            // Installing again keeps the handler from before the first install, not this one
+            if (installed && !isOwn(replaced)) {
+                previous_[i] = replaced;
+            }
+            ok = installed && ok;
+        }
+        return ok;
+    }
+
+    // Install the handlers, appending to `path`; the file is opened now so the crash path does not open it
+    static bool install(const std::string& path) {
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        return fd >= 0 && install(fd);
+    }
+
+    // Restore the handlers that were installed before install()
+    static void uninstall() {
+        for (size_t i = 0; i < signal_count; ++i) {
+            ::sigaction(signals_[i], &previous_[i], nullptr);
+        }
+    }
+
+    // Write the queued records and a stack trace to `fd` now, as the signal handler does; also
+    // usable from fatal paths that do not raise a signal
+    static void dump(int fd, const char* reason) {
+        {
+            detail::FdWriter out(fd);
+            out.append("*** colorlog: ");
+            out.append(reason);
+            out.append(", queued records follow\n");
+            for (const auto& slot : detail::crash_registry.loggers) {
+                if (AsyncLogger* logger = slot.load()) {
+                    logger->dump_pending(out);
+                }
+            }
+            out.append("*** colorlog: stack trace\n");
+        }
+        void* frames[64];
+        int count = ::backtrace(frames, 64);
+        ::backtrace_symbols_fd(frames, count, fd);
+    }
+
+private:
+    static constexpr size_t signal_count = 5;
+
+    static const char* signalName(int signal) {
+        switch (signal) {
+            case SIGSEGV: return "caught SIGSEGV";
+            case SIGABRT: return "caught SIGABRT";
+            case SIGBUS: return "caught SIGBUS";
+            case SIGILL: return "caught SIGILL";
+            case SIGFPE: return "caught SIGFPE";
+            default: return "caught signal";
+        }
+    }
+
+    static void onSignal(int signal, siginfo_t*, void*) {
+        if (!entered_.test_and_set()) {  // A crash inside the handler skips straight to the re-raise
+            dump(fd_.load(), signalName(signal));
+        }
+        for (size_t i = 0; i < signal_count; ++i) {
+            if (signals_[i] != signal) {
+                continue;
+            }
+            if (isOwn(previous_[i])) {  // Re-raising into this handler would never end
+                struct sigaction fallback{};
+                fallback.sa_handler = SIG_DFL;
+                sigemptyset(&fallback.sa_mask);
+                ::sigaction(signal, &fallback, nullptr);
+            } else {
+                ::sigaction(signal, &previous_[i], nullptr);
+            }
+        }
+        ::raise(signal);
+    }
+
+    static bool isOwn(const struct sigaction& action) {
+        return (action.sa_flags & SA_SIGINFO) != 0 && action.sa_sigaction == &CrashHandler::onSignal;
+    }
+
+    static constexpr int signals_[signal_count] = {SIGSEGV, SIGABRT, SIGBUS, SIGILL, SIGFPE};
+    inline static struct sigaction previous_[signal_count] = {};  // Handlers replaced by install()
+    inline static std::atomic<int> fd_{STDERR_FILENO};  // Destination of the crash report
+    inline static std::atomic_flag entered_ = ATOMIC_FLAG_INIT;  // Set once a crash is being reported
+    inline static char alt_stack_[64 * 1024];  // Alternate signal stack for the installing thread
+};
+#endif
+
+// Logger of one component, created by LoggerFactory::get(). It has its own name and level but
+// no queue or thread: records go through the shared default AsyncLogger and its sinks, with the
+// name written after the level ("[INFO] [net] ..."). Usable with the COLORLOG_LOG macros
+class NamedLogger {
+public:
+    NamedLogger(std::string name, AsyncLogger& backend) : name_(std::move(name)), backend_(backend) {}
+
+    NamedLogger(const NamedLogger&) = delete;
+    NamedLogger& operator=(const NamedLogger&) = delete;
+
+    const std::string& name() const { return name_; }
+
+    // Level threshold of this component, on top of the shared logger's
+    void set_log_level(LogLevel level) { log_level_.store(level, std::memory_order_relaxed); }
+    LogLevel get_log_level() const { return log_level_.load(std::memory_order_relaxed); }
+
+    bool should_log(LogLevel level) const {
+        return static_cast<int>(level) >= static_cast<int>(log_level_.load(std::memory_order_relaxed)) &&
+               backend_.should_log(level);
+    }
+
+    bool sample(LogLevel level) { return backend_.sample(level); }
+    bool sample(LogLevel level, uint32_t& count, uint32_t one_in) { return backend_.sample(level, count, one_in); }
+
+    // Same as the AsyncLogger functions of the same name
+    template <COLORLOG_CONSTRAINED(PrintableStringOrIterable, T)>
+    void log(LogLevel level, const std::string& file, int line, const T& msg) {
+        if (should_log(level)) {
+            Scope scope(name_);
+            backend_.log(level, file, line, msg);
+        }
+    }
+
+    template <COLORLOG_CONSTRAINED(PrintableStringOrIterable, T)>
+    void log(const CallSite& site, const T& msg) {
+        if (should_log(site.level)) {
+            Scope scope(name_);
+            backend_.log(site, msg);
+        }
+    }
+
+    template <COLORLOG_CONSTRAINED(LazyMessage, F)>
+    void log(LogLevel level, const std::string& file, int line, F&& make_msg) {
+        if (should_log(level)) {
+            Scope scope(name_);
+            backend_.log(level, file, line, std::forward<F>(make_msg));
+        }
+    }
+
+    template <COLORLOG_CONSTRAINED(LazyMessage, F)>
+    void log(const CallSite& site, F&& make_msg) {
+        if (should_log(site.level)) {
+            Scope scope(name_);
+            backend_.log(site, std::forward<F>(make_msg));
+        }
+    }
+
+    template <COLORLOG_CONSTRAINED_PACK(Formattable, Args)>
+    void logf(LogLevel level, const std::string& file, int line, const char* fmt, const Args&... args) {
+        if (should_log(level)) {
+            Scope scope(name_);
+            backend_.logf(level, file, line, fmt, args...);
+        }
+    }
+
+    template <COLORLOG_CONSTRAINED_PACK(Formattable, Args)>
+    void logf(const CallSite& site, const Args&... args) {
+        if (should_log(site.level)) {
+            Scope scope(name_);
+            backend_.logf(site, args...);
+        }
+    }
+
+    // The shared logger records go through
+    AsyncLogger& backend() const { return backend_; }
+
+private:
+    // Marks the records enqueued on this thread as this component's while it lives
+    class Scope {
+    public:
+        explicit Scope(const std::string& name) : outer_(detail::current_component()) {
+            detail::current_component() = name.c_str();
+        }
+        ~Scope() { detail::current_component() = outer_; }
+
+    private:
+        const char* outer_;  // Component active before, for nested calls
+    };
+
+    std::string name_;  // Component name, stable for the life of the process
+    AsyncLogger& backend_;  // Shared logger
+    std::atomic<LogLevel> log_level_{LogLevel::debug};  // Component threshold
+};
+
+// Factory class for creating logger instances
+class LoggerFactory {
+public:
+    // Create a synchronous logger
+    static Logger createLogger(const LoggerConfig& config = LoggerConfig()) {
+        return Logger(config);
+    }
+    // Create an asynchronous logger
+    static AsyncLogger createAsyncLogger(const LoggerConfig& config = LoggerConfig()) {
+        return AsyncLogger(config);
+    }
+
+    // The process-wide default AsyncLogger used by the LOG_* macros. Its pointer is constant-initialized,
+    // so once the logger exists this is a single atomic load with no magic-static guard. Call init()
+    // at startup to create it there; otherwise the first call creates it with a default LoggerConfig
+    static AsyncLogger& instance() {
+        AsyncLogger* logger = default_.load(std::memory_order_acquire);
+        return logger != nullptr ? *logger : createDefault(LoggerConfig());
+    }
+
+    // Create the default logger from `config`; if it already exists it is returned unchanged
+    static AsyncLogger& init(const LoggerConfig& config) {
+        AsyncLogger* logger = default_.load(std::memory_order_acquire);
+        return logger != nullptr ? *logger : createDefault(config);
+    }
+
+    // The component logger called `name`, registered on first use. Lookups read an immutable
+    // snapshot of the registry with one atomic load and a binary search, taking no lock; the
+    // returned logger lives until exit
+    static NamedLogger& get(std::string_view name) {
+        if (NamedLogger* logger = find(name)) {
+            return *logger;
+        }
+        return add(name);
+    }
+
+    // The registered component logger called `name`, or nullptr
+    static NamedLogger* find(std::string_view name) {
+        const Registry* registry = registry_.load(std::memory_order_acquire);
+        return registry != nullptr ? registry->find(name) : nullptr;
+    }
+
+private:
+    // Registered loggers sorted by name; a registration publishes a new copy
+    struct Registry {
+        std::vector<NamedLogger*> loggers;
+
+        NamedLogger* find(std::string_view name) const {
+            auto it = std::lower_bound(loggers.begin(), loggers.end(), name,
+                                       [](const NamedLogger* logger, std::string_view key) { return logger->name() < key; });
+            return it != loggers.end() && (*it)->name() == name ? *it : nullptr;
+        }
+    };
+
+    // Slow paths, kept out of line so instance() and get() stay small
+#if defined(__GNUC__)
+    __attribute__((noinline))
+#endif
+    static AsyncLogger& createDefault(const LoggerConfig& config) {
+        std::lock_guard<std::mutex> lock(default_mutex_);
+        if (!owned_default_) {
+            owned_default_ = std::make_unique<AsyncLogger>(config);
+            default_.store(owned_default_.get(), std::memory_order_release);
+        }
+        return *owned_default_;
+    }
+
+#if defined(__GNUC__)
+    __attribute__((noinline))
+#endif
+    static NamedLogger& add(std::string_view name) {
+        AsyncLogger& backend = instance();
+        std::lock_guard<std::mutex> lock(registry_mutex_);
+        const Registry* current = registry_.load(std::memory_order_relaxed);
+        if (current != nullptr) {
+            if (NamedLogger* logger = current->find(name)) {
+                return *logger;
+            }
+        }
+        named_.push_back(std::make_unique<NamedLogger>(std::string(name), backend));
+        NamedLogger* logger = named_.back().get();
+        auto next = std::make_unique<Registry>();
+        if (current != nullptr) {
+            next->loggers = current->loggers;
+        }
+        next->loggers.insert(std::lower_bound(next->loggers.begin(), next->loggers.end(), logger,
+                                              [](const NamedLogger* a, const NamedLogger* b) { return a->name() < b->name(); }),
+                             logger);
+        registry_.store(next.get(), std::memory_order_release);
+        // Replaced snapshots are kept, since a reader may still be searching one
+        snapshots_.push_back(std::move(next));
+        return *logger;
+    }
+
+    static inline COLORLOG_CONSTINIT std::atomic<AsyncLogger*> default_{nullptr};  // Default logger once created
+    static inline COLORLOG_CONSTINIT std::atomic<const Registry*> registry_{nullptr};  // Current registry snapshot
+    static inline COLORLOG_CONSTINIT std::mutex default_mutex_;  // Serializes creating the default logger
+    static inline COLORLOG_CONSTINIT std::mutex registry_mutex_;  // Serializes registrations
+    static inline std::unique_ptr<AsyncLogger> owned_default_;  // Owns the default logger; flushed at exit
+    static inline std::vector<std::unique_ptr<NamedLogger>> named_;  // Owns the registered loggers
+    // Every published snapshot. A registration copies the current one and nothing is freed before
+    // exit, since a lock-free reader may still be searching an old snapshot; memory is therefore
+    // O(n^2) pointers in the number of distinct names. Names are registered once per component, so
+    // this stays small, but registering derived names (per request, per connection) would not
+    static inline std::vector<std::unique_ptr<const Registry>> snapshots_;
+};
+
+} // namespace colorlog
+
+#endif // COLORLOG_CORE_HPP_
@@ -0,0 +1,167 @@
+#include "../include/colorlog.hpp"
+#include <iostream>
+#include <cassert>
+#include <atomic>
+#include <cstdlib>
+#include <cstdio> // For std::remove
+#include <new>
+#include <thread>
+#include <vector>
+
+using namespace colorlog;
+
+// Global allocation counter; only counts while counting_enabled is set
+static std::atomic<long> allocation_count{0};
+static std::atomic<bool> counting_enabled{false};
+
+void* operator new(std::size_t size) {
+    if (counting_enabled.load(std::memory_order_relaxed)) {
+        allocation_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    void* p = std::malloc(size ? size : 1);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+// Kept out of line: once inlined, the free() inside is paired
+// with a call to the replaceable operator new, which -Wmismatched-new-delete reports
+[[gnu::noinline]] void operator delete(void* p) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete[](void* p) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+// A user type logged through operator<<
+struct Point {
+    int x;
+    int y;
+};
+
+std::ostream& operator<<(std::ostream& os, const Point& p) {
+    return os << "(" << p.x << ", " << p.y << ")";
+}
+
+// Log one message of kind 0..mix_kinds - 1
+static constexpr int mix_kinds = 7;
+template <typename LoggerT>
+static void log_kind(LoggerT& logger, int kind, int i, const std::string& prebuilt) {
+    static const std::vector<int> ids(64, 7);
+    switch (kind) {
+    case 0: COLORLOG_LOG(logger, LogLevel::info, "This is a literal message"); break;
+    case 1: COLORLOG_LOG(logger, LogLevel::info, prebuilt); break;
+    case 2: COLORLOG_LOG(logger, LogLevel::warn, (Point{i, -i})); break;
+    case 3: COLORLOG_LOGF(logger, LogLevel::info, "value {} ratio {} name {}", i, 2.5, "short"); break;
+    case 4: COLORLOG_LOG(logger, LogLevel::info, ids); break;
+    case 5: COLORLOG_LOGF(logger, LogLevel::info, "ids {} of {}", join(ids, ",", 16), ids.size()); break;
+    default: logger.log(LogLevel::error, "alloc.cpp", 42, "This is a legacy file and line message"); break;
+    }
+}
+
+// Log one message of every kind
+template <typename LoggerT>
+static void log_mix(LoggerT& logger, int i, const std::string& prebuilt) {
+    for (int kind = 0; kind < mix_kinds; ++kind) {
+        log_kind(logger, kind, i, prebuilt);
+    }
+}
+
+// Count the allocations made while running fn
+template <typename Fn>
+static long count_allocations(Fn&& fn) {
+    allocation_count.store(0);
+    counting_enabled.store(true);
+    fn();
+    counting_enabled.store(false);
+    return allocation_count.load();
+}
+
+// Function to test that synchronous logging does not allocate in steady state
+void test_sync_steady_state_allocations() {
+    std::string log_file = "test_alloc_sync.txt";
+    std::remove(log_file.c_str());
+
+    LoggerConfig config;
+    config.log_level = LogLevel::debug;
+    config.output_mode = OutputMode::File;
+    config.log_file_name = log_file;
+    config.timestamp_format = TimestampFormat::Microseconds;  // The cached timestamp prefix does not allocate either
+    Logger logger(config);
+    std::string prebuilt = "This is a prebuilt message that is longer than the small string buffer";
+    LogContext::Scope tenant("tenant", "acme");  // Context fields are rendered without allocating
+
+    log_mix(logger, 0, prebuilt);  // Warm up thread-local buffers and the file buffer
+    long allocations = count_allocations([&] {
+        for (int i = 0; i < 1000; ++i) {
+            LogContext::Scope request("request_id", i);
+            log_mix(logger, i, prebuilt);
+        }
+    });
+    std::cout << "sync allocations: " << allocations << std::endl;
+    assert(allocations == 0);
+}
+
+// Function to test that asynchronous logging does not allocate in steady state
+void test_async_steady_state_allocations() {
+    std::string log_file = "test_alloc_async.txt";
+    std::remove(log_file.c_str());
+
+    LoggerConfig config;
+    config.log_level = LogLevel::debug;
+    config.output_mode = OutputMode::File;
+    config.log_file_name = log_file;
+    config.queue_capacity = 64;
+    AsyncLogger logger(config);
+    std::string prebuilt = "This is a prebuilt message that is longer than the small string buffer";
+    std::string large(1000, 'x');  // Too large for a ring slot, so it goes through the spill arena
+    LogContext::Scope tenant("tenant", "acme");  // Copied into every entry, never allocated
+
+    // Fill the ring with each kind of message while the worker is held, so the batch buffers grow
+    // to the largest batch the ring can produce; slots need no warm-up. The large messages go
+    // twice, the second time starting in a partly used arena chunk, so both chunks exist
+    for (int kind = 0; kind <= mix_kinds + 1; ++kind) {
+        std::atomic<bool> held{false};
+        std::atomic<bool> release{false};
+        logger.log(LogLevel::info, "alloc.cpp", 1, [&held, &release] {
+            held = true;
+            while (!release) std::this_thread::yield();
+            return std::string("held");
+        });
+        while (!held) std::this_thread::yield();
+        for (int i = 0; i < 63; ++i) {
+            LogContext::Scope request("request_id", i);
+            if (kind < mix_kinds) {
+                log_kind(logger, kind, i, prebuilt);
+            } else {
+                logger.logf(LogLevel::info, "alloc.cpp", 7, "large {}", large);
+            }
+        }
+        release = true;
+        logger.flush();
+    }
+    long allocations = count_allocations([&] {
+        for (int i = 0; i < 1000; ++i) {
+            LogContext::Scope request("request_id", i);
+            log_mix(logger, i, prebuilt);
+            if (i % 8 == 0) {
+                logger.logf(LogLevel::info, "alloc.cpp", 7, "large {}", large);
+            }
+        }
+        logger.flush();
+    });
+    std::cout << "async allocations: " << allocations << std::endl;
+    assert(allocations == 0);
+}
+
+int main() {
+    std::cout << "Testing synchronous steady-state allocations..." << std::endl;
+    test_sync_steady_state_allocations();
+
+    std::cout << "Testing asynchronous steady-state allocations..." << std::endl;
+    test_async_steady_state_allocations();
+
+    std::cout << "All tests passed!" << std::endl;
+    return 0;
+}
@@ -5,6 +5,12 @@
 #include <functional>
 #include <stdexcept>
 #include <cstdio> // For std::remove
+#include <vector>
+#include <array>
+#include <coroutine>
+#include <deque>
+#include <list>
+#include <mutex>
 
 using namespace colorlog;
 
@@ -20,6 +26,12 @@ void custom_error_handler(const std::exception& e) {
     std::cerr << "Custom handler caught exception: " << e.what() << std::endl;
 }
 
+// Read a whole file into a string
+static std::string read_file(const std::string& path) {
+    std::ifstream in(path);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
 // Function to test synchronous logging with default configuration
 void test_sync_logging_default() {
     colorlog::Logger logger;
@@ -114,6 +126,959 @@ void test_file_logging() {
     assert(count == 6);  // Ensure all messages were logged
 }
 
+// Function to test many producers wrapping around a small async ring
+void test_async_multi_producer() {
+    std::string log_file = "test_async_ring.txt";
+    std::remove(log_file.c_str());
+
+    colorlog::LoggerConfig config;
+    config.log_level = colorlog::LogLevel::debug;
+    config.output_mode = colorlog::OutputMode::File;
+    config.log_file_name = log_file;
+    config.queue_capacity = 16;
+
+    const int threads = 4;
+    const int per_thread = 500;
+    {
+        colorlog::AsyncLogger async_logger(config);
+        std::vector<std::thread> producers;
+        for (int t = 0; t < threads; ++t) {
+            producers.emplace_back([&async_logger, t] {
+                for (int i = 0; i < per_thread; ++i) {
+                    async_logger.log(colorlog::LogLevel::info, "test_async.cpp", t, "This is a ring message");
+                }
+            });
+        }
+        for (auto& producer : producers) producer.join();
+    }
+
+    std::ifstream infile(log_file);
+    std::string line;
+    int count = 0;
+    while (std::getline(infile, line)) {
+        count++;
+    }
+    assert(count == threads * per_thread);  // Nothing lost when the ring wraps
+}
+
+// Function to test that drop policies account for every message
+void test_async_overflow_policy(colorlog::OverflowPolicy policy) {
+    std::string log_file = "test_async_overflow.txt";
+    std::remove(log_file.c_str());
+
+    colorlog::LoggerConfig config;
+    config.log_level = colorlog::LogLevel::debug;
+    config.output_mode = colorlog::OutputMode::File;
+    config.log_file_name = log_file;
+    config.queue_capacity = 8;
+    config.overflow_policy = policy;
+
+    const int total = 5000;
+    {
+        colorlog::AsyncLogger async_logger(config);
+        for (int i = 0; i < total; ++i) {
+            async_logger.log(colorlog::LogLevel::info, "test_async.cpp", i, "This is an overflow message");
+        }
+    }
+
+    // Every message is either written or counted in a drop summary line
+    std::ifstream infile(log_file);
+    std::string line;
+    long written = 0;
+    long dropped = 0;
+    const std::string marker = "colorlog: dropped ";
+    while (std::getline(infile, line)) {
+        auto pos = line.find(marker);
+        if (pos != std::string::npos) {
+            dropped += std::stol(line.substr(pos + marker.size()));
+        } else {
+            written++;
+        }
+    }
+    assert(written + dropped == total);
+}
+
+// Function to test that records logged on the worker thread never block on a full ring
+void test_async_block_on_worker() {
+    std::string log_file = "test_async_worker_block.txt";
+    std::remove(log_file.c_str());
+
+    colorlog::LoggerConfig config;
+    config.output_mode = colorlog::OutputMode::File;
+    config.log_file_name = log_file;
+    config.queue_capacity = 8;
+    config.overflow_policy = colorlog::OverflowPolicy::Block;
+
+    const int nested = 100;
+    {
+        colorlog::AsyncLogger async_logger(config);
+        // Built on the worker, which is then the only thread that could drain the ring it fills
+        async_logger.log(colorlog::LogLevel::info, "test_async.cpp", 1, [&async_logger] {
+            for (int i = 0; i < nested; ++i) {
+                async_logger.log(colorlog::LogLevel::info, "test_async.cpp", 2, "This is a nested message");
+            }
+            async_logger.log(colorlog::LogLevel::fatal, "test_async.cpp", 3, "This is a nested fatal message");
+            return std::string("outer");
+        });
+    }
+
+    std::string text = read_file(log_file);
+    assert(text.find("[INFO] test_async.cpp:1 outer") != std::string::npos);
+    assert(text.find("This is a nested message") != std::string::npos);
+    assert(text.find("colorlog: dropped ") != std::string::npos);  // What did not fit is dropped, not waited for
+}
+
+// Type whose operator<< throws, run while its record's slot is claimed
+struct ThrowingPrintable {};
+
+std::ostream& operator<<(std::ostream& os, const ThrowingPrintable&) {
+    throw std::runtime_error("boom");
+    return os;
+}
+
+// Function to test that a message whose formatting throws still releases its slot
+void test_async_throwing_message() {
+    std::string log_file = "test_async_throwing.txt";
+    std::remove(log_file.c_str());
+
+    colorlog::LoggerConfig config;
+    config.output_mode = colorlog::OutputMode::File;
+    config.log_file_name = log_file;
+    config.queue_capacity = 8;
+
+    colorlog::AsyncLogger async_logger(config);
+    async_logger.log(colorlog::LogLevel::error, "test_async.cpp", 1, ThrowingPrintable{});
+    async_logger.log(colorlog::LogLevel::info, "test_async.cpp", 2, "This is the next message");
+    async_logger.flush();  // Never returned while the failed record's slot stayed unpublished
+
+    std::string text = read_file(log_file);
+    assert(text.find("[ERROR] test_async.cpp:1 <formatting failed: boom>") != std::string::npos);
+    assert(text.find("This is the next message") != std::string::npos);
+}
+
+// Function to test that deferred messages are built on the worker thread
+void test_async_deferred_formatting() {
+    std::string log_file = "test_async_deferred.txt";
+    std::remove(log_file.c_str());
+
+    colorlog::LoggerConfig config;
+    config.log_level = colorlog::LogLevel::info;
+    config.output_mode = colorlog::OutputMode::File;
+    config.log_file_name = log_file;
+
+    std::thread::id producer_id = std::this_thread::get_id();
+    std::thread::id builder_id = producer_id;
+    {
+        colorlog::AsyncLogger async_logger(config);
+        async_logger.log(colorlog::LogLevel::debug, "test_async.cpp", 10, [&] {
+            builder_id = std::thread::id();  // Never runs: debug is filtered
+            return std::string("filtered");
+        });
+        async_logger.log(colorlog::LogLevel::info, "", 0, [&builder_id] {
+            builder_id = std::this_thread::get_id();
+            return std::string("built on the worker");
+        });
+
+        // Arguments are captured by value, so later changes are not visible
+        std::string name = "captured";
+        char buffer[16] = "buffer";
+        async_logger.logf(colorlog::LogLevel::info, "", 0, "{} {} {}", name, buffer, 7);
+        name = "changed";
+        buffer[0] = 'X';
+
+        // So is a runtime format string
+        std::string format = "runtime {} format";
+        async_logger.logf(colorlog::LogLevel::info, "", 0, format.c_str(), 8);
+        format.assign(format.size(), 'X');
+    }
+    assert(builder_id != producer_id && builder_id != std::thread::id());
+
+    std::ifstream infile(log_file);
+    std::string line;
+    std::getline(infile, line);
+    assert(line == "[INFO] built on the worker");
+    std::getline(infile, line);
+    assert(line == "[INFO] captured buffer 7");
+    std::getline(infile, line);
+    assert(line == "[INFO] runtime 8 format");
+}
+
+// Function to test entries whose text does not fit in a ring slot and goes to the spill arena
+void test_async_large_entries() {
+    std::string log_file = "test_async_large.txt";
+    std::remove(log_file.c_str());
+
+    colorlog::LoggerConfig config;
+    config.output_mode = colorlog::OutputMode::File;
+    config.log_file_name = log_file;
+    config.queue_capacity = 16;
+    std::string long_file(300, 'f');
+    std::string small(100, 's');
+    std::string large(100000, 'l');
+    std::array<double, 16> many{};  // Makes the lazy callable too large for the slot's inline storage
+    many[15] = 1.5;
+    {
+        colorlog::AsyncLogger async_logger(config);
+        for (int i = 0; i < 200; ++i) {
+            async_logger.log(colorlog::LogLevel::info, long_file, i + 1, small);
+            async_logger.log(colorlog::LogLevel::info, "test_async.cpp", i + 1, large);
+            async_logger.logf(colorlog::LogLevel::info, "test_async.cpp", i + 1, "{}|{}|{}", small, i, large);
+            async_logger.log(colorlog::LogLevel::info, "test_async.cpp", i + 1, [many] { return std::to_string(many[15]); });
+        }
+    }
+
+    std::ifstream infile(log_file);
+    std::string line;
+    for (int i = 0; i < 200; ++i) {
+        std::string location = ":" + std::to_string(i + 1) + " ";
+        assert(std::getline(infile, line) && line == "[INFO] " + long_file + location + small);
+        assert(std::getline(infile, line) && line == "[INFO] test_async.cpp" + location + large);
+        assert(std::getline(infile, line) && line == "[INFO] test_async.cpp" + location + small + "|" + std::to_string(i) + "|" + large);
+        assert(std::getline(infile, line) && line == "[INFO] test_async.cpp" + location + "1.500000");
+    }
+    assert(!std::getline(infile, line));
+}
+
+// Function to test that ranges are copied into the queue, so the producer may change them right away
+void test_async_ranges() {
+    std::string log_file = "test_async_ranges.txt";
+    std::remove(log_file.c_str());
+
+    colorlog::LoggerConfig config;
+    config.output_mode = colorlog::OutputMode::File;
+    config.log_file_name = log_file;
+    config.queue_capacity = 16;
+    std::vector<int> values(10000);
+    std::string expected;
+    for (int i = 0; i < 10000; ++i) {
+        values[i] = i;
+        expected += std::to_string(i);
+    }
+    std::list<std::string> names = {"x", "y"};
+    {
+        colorlog::AsyncLogger async_logger(config);
+        // Hold the worker so the records below are still queued when the ranges change
+        std::atomic<bool> held{false};
+        std::atomic<bool> release{false};
+        async_logger.log(colorlog::LogLevel::info, "test_async.cpp", 1, [&held, &release] {
+            held = true;
+            while (!release) std::this_thread::yield();
+            return std::string("held");
+        });
+        while (!held) std::this_thread::yield();
+        for (int i = 0; i < 4; ++i) {
+            async_logger.log(colorlog::LogLevel::info, "test_async.cpp", 2, values);
+            async_logger.logf(colorlog::LogLevel::info, "test_async.cpp", 3, "head {} of {}", join(values, ",", 4), values.size());
+            async_logger.log(colorlog::LogLevel::info, "test_async.cpp", 4, join(names, "+"));
+        }
+        std::fill(values.begin(), values.end(), -1);
+        names.clear();
+        release = true;
+    }
+
+    std::ifstream infile(log_file);
+    std::string line;
+    assert(std::getline(infile, line) && line == "[INFO] test_async.cpp:1 held");
+    for (int i = 0; i < 4; ++i) {
+        assert(std::getline(infile, line) && line == "[INFO] test_async.cpp:2 " + expected);
+        assert(std::getline(infile, line) && line == "[INFO] test_async.cpp:3 head 0,1,2,3 ... (9996 more) of 10000");
+        assert(std::getline(infile, line) && line == "[INFO] test_async.cpp:4 x+y");
+    }
+    assert(!std::getline(infile, line));
+}
+
+// Function to test that the log context is captured when a record is enqueued
+void test_async_context() {
+    std::string log_file = "test_async_context.txt";
+    std::string json_file = "test_async_context.json";
+    std::remove(log_file.c_str());
+    std::remove(json_file.c_str());
+
+    colorlog::LoggerConfig config;
+    config.sinks = {std::make_shared<colorlog::FileSink>(log_file), std::make_shared<colorlog::JsonFileSink>(json_file)};
+    {
+        colorlog::AsyncLogger async_logger(config);
+        // Hold the worker so the scopes below have ended before their records are written
+        std::atomic<bool> held{false};
+        std::atomic<bool> release{false};
+        async_logger.log(colorlog::LogLevel::info, "test_async.cpp", 1, [&held, &release] {
+            held = true;
+            while (!release) std::this_thread::yield();
+            return std::string("held");
+        });
+        while (!held) std::this_thread::yield();
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 2; ++t) {
+            threads.emplace_back([&async_logger, t] {
+                colorlog::LogContext::Scope thread("thread", t == 0 ? "first" : "second");
+                for (int i = 0; i < 3; ++i) {
+                    colorlog::LogContext::Scope request("request_id", t * 10 + i);
+                    async_logger.logf(colorlog::LogLevel::info, "test_async.cpp", 2, "request {}", t * 10 + i);
+                }
+            });
+        }
+        for (auto& thread : threads) thread.join();
+        {
+            colorlog::LogContext::Scope lazy("lazy", true);
+            async_logger.log(colorlog::LogLevel::warn, "test_async.cpp", 3, [] { return std::string("built later"); });
+        }
+        release = true;
+    }
+
+    std::string text = read_file(log_file);
+    for (int t = 0; t < 2; ++t) {
+        for (int i = 0; i < 3; ++i) {
+            std::string id = std::to_string(t * 10 + i);
+            std::string expected = "[INFO] [thread=" + std::string(t == 0 ? "first" : "second") + " request_id=" + id +
+                                   "] test_async.cpp:2 request " + id + "\n";
+            assert(text.find(expected) != std::string::npos);
+        }
+    }
+    assert(text.find("[WARNING] [lazy=true] test_async.cpp:3 built later\n") != std::string::npos);
+    assert(text.find("[INFO] test_async.cpp:1 held\n") != std::string::npos);
+
+    std::string json = read_file(json_file);
+    assert(json.find("\"message\":\"request 11\",\"context\":{\"thread\":\"second\",\"request_id\":\"11\"}}\n") != std::string::npos);
+    assert(json.find("\"message\":\"built later\",\"context\":{\"lazy\":\"true\"}}\n") != std::string::npos);
+}
+
+// Function to test that binary records keep the producer's metadata
+void test_async_binary_logging() {
+    std::string log_file = "test_async_binary.bin";
+    std::remove(log_file.c_str());
+
+    colorlog::LoggerConfig config;
+    config.output_mode = colorlog::OutputMode::Binary;
+    config.log_file_name = log_file;
+
+    uint32_t producer_thread = colorlog::RecordInfo::current_thread_id();
+    {
+        colorlog::AsyncLogger async_logger(config);
+        async_logger.logf(colorlog::LogLevel::info, "test_async.cpp", 10, "value={} name={}", 42, "async");
+        async_logger.log(colorlog::LogLevel::error, "test_async.cpp", 20, "This is an async binary message");
+        COLORLOG_LOGF(async_logger, colorlog::LogLevel::warn, "site value={}", 7);
+        COLORLOG_LOG(async_logger, colorlog::LogLevel::warn, "site message");
+    }
+
+    std::ifstream infile(log_file, std::ios::binary);
+    colorlog::binary::Reader reader(infile);
+    assert(reader.read_header());
+    colorlog::binary::DecodedRecord record;
+    assert(reader.next(record));
+    assert(record.msg == "value=42 name=async" && record.info.thread_id == producer_thread);
+    assert(reader.next(record));
+    assert(record.level == colorlog::LogLevel::error && record.line == 20);
+    assert(reader.next(record));
+    assert(record.file == __FILE__ && record.msg == "site value=7");
+    assert(reader.next(record));
+    assert(record.level == colorlog::LogLevel::warn && record.msg == "site message");
+    assert(!reader.next(record));
+}
+
+// Count the lines currently visible in a file
+static int count_lines(const std::string& path) {
+    std::ifstream infile(path);
+    std::string line;
+    int count = 0;
+    while (std::getline(infile, line)) {
+        count++;
+    }
+    return count;
+}
+
+// Function to test flushing driven by the async worker
+void test_async_flush_policy() {
+    std::string log_file = "test_async_flush.txt";
+    std::remove(log_file.c_str());
+
+    colorlog::LoggerConfig config;
+    config.log_level = colorlog::LogLevel::debug;
+    config.output_mode = colorlog::OutputMode::File;
+    config.log_file_name = log_file;
+    config.flush_policy = colorlog::FlushPolicy::Interval;
+    config.flush_interval = std::chrono::milliseconds(20);
+
+    colorlog::AsyncLogger async_logger(config);
+    async_logger.log(colorlog::LogLevel::info, "test_async.cpp", 10, "This is an interval message");
+    for (int i = 0; i < 100 && count_lines(log_file) < 1; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    assert(count_lines(log_file) == 1);  // Flushed by the idle worker
+
+    async_logger.log(colorlog::LogLevel::info, "test_async.cpp", 20, "This is a flushed message");
+    async_logger.flush();
+    assert(count_lines(log_file) == 2);
+
+    async_logger.log(colorlog::LogLevel::fatal, "test_async.cpp", 30, "This is a fatal message");
+    assert(count_lines(log_file) == 3);  // Fatal messages are written before log() returns
+}
+
+// Minimal fire-and-forget coroutine: starts eagerly and frees itself when it finishes
+struct Task {
+    struct promise_type {
+        Task get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+// Log, await the flush and record what the file held when the coroutine resumed
+static Task flush_and_count(colorlog::AsyncLogger& async_logger, const std::string& path,
+                            std::atomic<int>& lines, std::atomic<bool>& done) {
+    async_logger.log(colorlog::LogLevel::info, "test_async.cpp", 10, "This is an awaited message");
+    co_await async_logger.flush_async();
+    lines = count_lines(path);
+    async_logger.log(colorlog::LogLevel::info, "test_async.cpp", 20, "This is a durable message");
+    co_await async_logger.durable(async_logger.sequence());
+    lines = count_lines(path);
+    done = true;
+}
+
+// Function to test awaitable and durable flushes
+void test_async_awaitable_flush() {
+    std::string log_file = "test_async_await.txt";
+    std::remove(log_file.c_str());
+
+    colorlog::LoggerConfig config;
+    config.log_level = colorlog::LogLevel::debug;
+    config.output_mode = colorlog::OutputMode::File;
+    config.log_file_name = log_file;
+    config.flush_policy = colorlog::FlushPolicy::Never;
+
+    {
+        // Resumed inline on the worker thread
+        colorlog::AsyncLogger async_logger(config);
+        std::atomic<int> lines{0};
+        std::atomic<bool> done{false};
+        flush_and_count(async_logger, log_file, lines, done);
+        for (int i = 0; i < 500 && !done; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        assert(done);
+        assert(lines == 2);
+
+        async_logger.log(colorlog::LogLevel::info, "test_async.cpp", 30, "This is a blocking durable message");
+        async_logger.wait_durable();
+        assert(count_lines(log_file) == 3);
+    }
+
+    // Resumed by an executor run on this thread, with the worker held so the flush has to wait
+    std::mutex queue_mutex;
+    std::deque<std::coroutine_handle<>> queue;
+    config.resume_executor = [&](std::coroutine_handle<> handle) {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        queue.push_back(handle);
+    };
+    config.worker_count = 2;
+    colorlog::AsyncLogger async_logger(config);
+    std::atomic<bool> release{false};
+    std::atomic<bool> held{false};
+    async_logger.log(colorlog::LogLevel::info, "test_async.cpp", 1, [&release, &held] {
+        held = true;
+        while (!release) std::this_thread::yield();
+        return std::string("held");
+    });
+    while (!held) std::this_thread::yield();
+    std::atomic<int> lines{0};
+    std::atomic<bool> done{false};
+    flush_and_count(async_logger, log_file, lines, done);
+    assert(!done);  // Suspended until the worker gets past the held message
+    release = true;
+    for (int i = 0; i < 500 && !done; ++i) {
+        std::coroutine_handle<> handle;
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            if (!queue.empty()) {
+                handle = queue.front();
+                queue.pop_front();
+            }
+        }
+        if (handle) {
+            handle.resume();
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    assert(done);
+    assert(lines == 6);  // Three from the first logger, the held message and the two awaited ones
+}
+
+// Function to test that batched worker writes keep every message, in order
+void test_async_batched_writes() {
+    std::string log_file = "test_async_batched.txt";
+    std::remove(log_file.c_str());
+
+    colorlog::LoggerConfig config;
+    config.log_level = colorlog::LogLevel::debug;
+    config.output_mode = colorlog::OutputMode::File;
+    config.log_file_name = log_file;
+    config.flush_policy = colorlog::FlushPolicy::Never;
+    config.batch_size = 7;
+    {
+        colorlog::AsyncLogger async_logger(config);
+        for (int i = 0; i < 1000; ++i) {
+            async_logger.logf(colorlog::LogLevel::info, "test_async.cpp", 10, "batched message {}", i);
+        }
+        async_logger.flush();
+        assert(count_lines(log_file) == 1000);
+    }
+
+    std::ifstream infile(log_file);
+    std::string line;
+    for (int i = 0; i < 1000; ++i) {
+        assert(std::getline(infile, line));
+        assert(line == "[INFO] test_async.cpp:10 batched message " + std::to_string(i));
+    }
+    assert(!std::getline(infile, line));
+}
+
+// Function to test that a batch reaches several sinks written in parallel
+void test_async_parallel_sinks() {
+    std::string first_file = "test_async_sink_a.txt";
+    std::string second_file = "test_async_sink_b.txt";
+    std::remove(first_file.c_str());
+    std::remove(second_file.c_str());
+
+    colorlog::LoggerConfig config;
+    config.log_level = colorlog::LogLevel::debug;
+    config.flush_policy = colorlog::FlushPolicy::Never;
+    config.parallel_sinks = true;
+    config.sinks = {std::make_shared<colorlog::FileSink>(first_file), std::make_shared<colorlog::FileSink>(second_file)};
+    {
+        colorlog::AsyncLogger async_logger(config);
+        for (int i = 0; i < 1000; ++i) {
+            async_logger.logf(colorlog::LogLevel::info, "test_async.cpp", 10, "parallel message {}", i);
+        }
+    }
+
+    for (const auto& log_file : {first_file, second_file}) {
+        std::ifstream infile(log_file);
+        std::string line;
+        for (int i = 0; i < 1000; ++i) {
+            assert(std::getline(infile, line));
+            assert(line == "[INFO] test_async.cpp:10 parallel message " + std::to_string(i));
+        }
+        assert(!std::getline(infile, line));
+    }
+}
+
+// Parse "[INFO] test_async.cpp:<producer + 1> shard message <i>" and check each producer's messages arrive in order
+static int check_shard_lines(const std::string& path, std::vector<int>& next) {
+    std::ifstream infile(path);
+    std::string line;
+    int count = 0;
+    while (std::getline(infile, line)) {
+        int producer = 0;
+        int index = 0;
+        assert(std::sscanf(line.c_str(), "[INFO] test_async.cpp:%d shard message %d", &producer, &index) == 2);
+        assert(index == next[producer - 1]);
+        next[producer - 1]++;
+        count++;
+    }
+    return count;
+}
+
+// Function to test sharded workers merged into one file
+void test_async_sharded_merged() {
+    std::string log_file = "test_async_sharded.txt";
+    std::remove(log_file.c_str());
+
+    colorlog::LoggerConfig config;
+    config.log_level = colorlog::LogLevel::debug;
+    config.output_mode = colorlog::OutputMode::File;
+    config.log_file_name = log_file;
+    config.flush_policy = colorlog::FlushPolicy::Never;
+    config.queue_capacity = 64;
+    config.batch_size = 16;
+    config.worker_count = 4;
+    config.worker_cpus = {0};
+
+    const int threads = 8;
+    const int per_thread = 500;
+    {
+        colorlog::AsyncLogger async_logger(config);
+        std::vector<std::thread> producers;
+        for (int t = 0; t < threads; ++t) {
+            producers.emplace_back([&async_logger, t] {
+                for (int i = 0; i < per_thread; ++i) {
+                    async_logger.logf(colorlog::LogLevel::info, "test_async.cpp", t + 1, "shard message {}", i);
+                }
+            });
+        }
+        for (auto& producer : producers) producer.join();
+        async_logger.flush();
+        assert(count_lines(log_file) == threads * per_thread);  // flush() covers every shard
+    }
+
+    std::vector<int> next(threads, 0);
+    assert(check_shard_lines(log_file, next) == threads * per_thread);
+}
+
+// Function to test unordered shards writing one file each
+void test_async_sharded_per_shard() {
+    std::string log_file = "test_async_per_shard.txt";
+    std::string shard_file = colorlog::AsyncLogger::shard_file_name(log_file, 1);
+    assert(shard_file == "test_async_per_shard.shard1.txt");
+    std::remove(log_file.c_str());
+    std::remove(shard_file.c_str());
+
+    colorlog::LoggerConfig config;
+    config.log_level = colorlog::LogLevel::debug;
+    config.output_mode = colorlog::OutputMode::File;
+    config.log_file_name = log_file;
+    config.worker_count = 2;
+    config.shard_ordering = colorlog::ShardOrdering::PerShard;
+
+    const int threads = 4;
+    const int per_thread = 250;
+    {
+        colorlog::AsyncLogger async_logger(config);
+        std::vector<std::thread> producers;
+        for (int t = 0; t < threads; ++t) {
+            producers.emplace_back([&async_logger, t] {
+                for (int i = 0; i < per_thread; ++i) {
+                    async_logger.logf(colorlog::LogLevel::info, "test_async.cpp", t + 1, "shard message {}", i);
+                }
+            });
+        }
+        for (auto& producer : producers) producer.join();
+    }
+
+    // Each producer's messages land in a single shard file, in order
+    std::vector<int> next(threads, 0);
+    int total = check_shard_lines(log_file, next) + check_shard_lines(shard_file, next);
+    assert(total == threads * per_thread);
+    for (int t = 0; t < threads; ++t) {
+        assert(next[t] == per_thread);
+    }
+}
+
+// Function to test that site limits are applied on the producer thread
+void test_async_site_limits() {
+    std::string log_file = "test_async_site_limits.txt";
+    std::remove(log_file.c_str());
+
+    colorlog::LoggerConfig config;
+    config.output_mode = colorlog::OutputMode::File;
+    config.log_file_name = log_file;
+    config.site_limits[colorlog::LogLevel::error] = {0.001, 5, true};
+
+    {
+        colorlog::AsyncLogger async_logger(config);
+        std::vector<std::thread> producers;
+        for (int t = 0; t < 4; ++t) {
+            producers.emplace_back([&async_logger, t] {
+                for (int i = 0; i < 1000; ++i) {
+                    async_logger.logf(colorlog::LogLevel::error, "test_async.cpp", 1, "failure {} {}", t, i);
+                }
+            });
+        }
+        for (auto& producer : producers) producer.join();
+        async_logger.log(colorlog::LogLevel::error, "test_async.cpp", 2, "repeated");
+        async_logger.log(colorlog::LogLevel::error, "test_async.cpp", 2, "repeated");
+        async_logger.log(colorlog::LogLevel::error, "test_async.cpp", 2, "done");
+    }
+
+    std::ifstream infile(log_file);
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(infile, line);) {
+        lines.push_back(line);
+    }
+    assert(lines.size() == 8);  // The burst of five, then one repeat note before "done"
+    assert(lines[6] == "[ERROR] test_async.cpp:2 Previous message repeated 1 time");
+    assert(lines[7] == "[ERROR] test_async.cpp:2 done");
+}
+
+// Function to test sampling on the producer threads
+void test_async_sampling() {
+    std::string log_file = "test_async_sampling.txt";
+    std::remove(log_file.c_str());
+
+    colorlog::LoggerConfig config;
+    config.log_level = colorlog::LogLevel::debug;
+    config.output_mode = colorlog::OutputMode::File;
+    config.log_file_name = log_file;
+    config.sampling[colorlog::LogLevel::debug] = {4, 1.0};
+
+    {
+        colorlog::AsyncLogger async_logger(config);
+        std::vector<std::thread> producers;
+        for (int t = 0; t < 4; ++t) {
+            producers.emplace_back([&async_logger] {
+                for (int i = 0; i < 100; ++i) {
+                    COLORLOG_LOGF(async_logger, colorlog::LogLevel::debug, "sampled {}", i);
+                    async_logger.log(colorlog::LogLevel::debug, "test_async.cpp", 1, [] { return std::string("lazy"); });
+                    COLORLOG_LOG_SAMPLED(async_logger, colorlog::LogLevel::info, 10, "site sampled");
+                }
+            });
+        }
+        for (auto& producer : producers) producer.join();
+    }
+
+    std::ifstream infile(log_file);
+    int sampled = 0;
+    int site = 0;
+    for (std::string line; std::getline(infile, line);) {
+        if (line.rfind("[DEBUG] [1/4] ", 0) == 0) ++sampled;
+        if (line.rfind("[INFO] [1/10] ", 0) == 0) ++site;
+    }
+    assert(sampled == 4 * 50);  // Per thread every fourth of the 200 debug records
+    assert(site == 4 * 10);
+}
+
+// Function to test AsyncLogger stats: drops, queue depth and enqueue-to-write latency
+void test_async_stats() {
+    std::string log_file = "test_async_stats.txt";
+    std::remove(log_file.c_str());
+
+    colorlog::LoggerConfig config;
+    config.output_mode = colorlog::OutputMode::File;
+    config.log_file_name = log_file;
+    config.collect_stats = true;
+    config.queue_capacity = 8;
+    config.overflow_policy = colorlog::OverflowPolicy::DropNewest;
+
+    const int messages = 2000;
+    colorlog::LoggerStats stats;
+    {
+        colorlog::AsyncLogger async_logger(config);
+        for (int i = 0; i < messages; ++i) {
+            async_logger.logf(colorlog::LogLevel::info, "test_async.cpp", 1, "stats message {}", i);
+        }
+        async_logger.flush();
+        stats = async_logger.stats();
+    }
+    assert(stats.messages[static_cast<size_t>(colorlog::LogLevel::info)] + stats.dropped == messages);
+    assert(stats.queue_high_water > 0 && stats.queue_high_water <= 8);
+    assert(stats.latency.count == stats.messages[static_cast<size_t>(colorlog::LogLevel::info)] +
+                                  stats.messages[static_cast<size_t>(colorlog::LogLevel::warn)]);
+    assert(stats.latency.max_ns > 0);
+}
+
+// Log into an AsyncLogger whose worker is held inside a lazy message, so later records stay queued
+static void log_while_held(colorlog::AsyncLogger& async_logger, std::atomic<bool>& release) {
+    std::atomic<bool> held{false};
+    async_logger.log(colorlog::LogLevel::info, "test_async.cpp", 1, [&release, &held] {
+        held = true;
+        while (!release) std::this_thread::yield();
+        return std::string("held");
+    });
+    while (!held) std::this_thread::yield();
+    async_logger.logf(colorlog::LogLevel::error, "test_async.cpp", 2, "queued {} {} {}", 7, 2.5, "text");
+    COLORLOG_LOG(async_logger, colorlog::LogLevel::warn, std::string("queued site"));
+    async_logger.log(colorlog::LogLevel::info, "test_async.cpp", 3, [] { return std::string("lazy"); });
+}
+
+// Function to test the default logger and the named-logger registry
+void test_logger_factory() {
+    std::string log_file = "test_factory_log.txt";
+    std::remove(log_file.c_str());
+
+    colorlog::LoggerConfig config;
+    config.log_level = colorlog::LogLevel::debug;
+    config.output_mode = colorlog::OutputMode::File;
+    config.log_file_name = log_file;
+    colorlog::AsyncLogger& shared = colorlog::LoggerFactory::init(config);
+    assert(&colorlog::LoggerFactory::instance() == &shared);
+    assert(&colorlog::LoggerFactory::init(colorlog::LoggerConfig()) == &shared);  // Already created
+
+    LOG_INFO("This is a default logger message");
+    LOG_WARNF("default {} {}", 1, "two");
+
+    colorlog::NamedLogger& net = colorlog::LoggerFactory::get("net");
+    assert(&colorlog::LoggerFactory::get("net") == &net && &net.backend() == &shared);
+    assert(colorlog::LoggerFactory::find("missing") == nullptr);
+    net.set_log_level(colorlog::LogLevel::warn);
+    COLORLOG_LOG(net, colorlog::LogLevel::info, "hidden by the component level");
+    COLORLOG_LOGF(net, colorlog::LogLevel::error, "connection {} reset", 7);
+
+    // Many components registered and looked up concurrently share the one worker
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([t] {
+            for (int i = 0; i < 100; ++i) {
+                colorlog::NamedLogger& component = colorlog::LoggerFactory::get("component" + std::to_string((i * 7 + t) % 100));
+                assert(colorlog::LoggerFactory::find(component.name()) == &component);
+                if (t == 0) {
+                    component.logf(colorlog::LogLevel::debug, "test_async.cpp", 3, "component {}", i);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    for (int i = 0; i < 100; ++i) {
+        assert(colorlog::LoggerFactory::find("component" + std::to_string(i)) != nullptr);
+    }
+    shared.flush();
+
+    std::string text = read_file(log_file);
+    assert(text.find("This is a default logger message") != std::string::npos);
+    assert(text.find("default 1 two") != std::string::npos);
+    assert(text.find("hidden") == std::string::npos);
+    assert(text.find("[ERROR] [net] ") != std::string::npos && text.find("connection 7 reset") != std::string::npos);
+    assert(text.find("[DEBUG] [component0] test_async.cpp:3 component 0") != std::string::npos);
+    assert(count_lines(log_file) == 103);
+}
+
+// Function to test the crash dump of queued records and the signal handler
+void test_crash_handler() {
+    std::string dump_file = "test_crash_dump.txt";
+    std::remove(dump_file.c_str());
+
+    colorlog::LoggerConfig config;
+    config.output_mode = colorlog::OutputMode::File;
+    config.log_file_name = "test_crash_log.txt";
+    {
+        std::atomic<bool> release{false};
+        colorlog::AsyncLogger async_logger(config);
+        log_while_held(async_logger, release);
+        int fd = ::open(dump_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        colorlog::CrashHandler::dump(fd, "test dump");
+        ::close(fd);
+        release = true;
+    }
+    std::string dump = read_file(dump_file);
+    assert(dump.find("*** colorlog: test dump, queued records follow\n") == 0);
+    assert(dump.find("[ERROR] test_async.cpp:2 queued 7 2.5 text\n") != std::string::npos);
+    assert(dump.find("queued site\n") != std::string::npos);
+    assert(dump.find("[INFO] test_async.cpp:3 (lazy message not built)\n") != std::string::npos);
+    assert(dump.find("held") == std::string::npos);  // Already taken by the worker
+    assert(dump.find("*** colorlog: stack trace\n") != std::string::npos);
+
+    // A real crash: the child aborts with records queued, the handler writes them and re-raises.
+    // Installed twice, which must still re-raise into the default action rather than itself
+    std::remove(dump_file.c_str());
+    pid_t child = ::fork();
+    if (child == 0) {
+        colorlog::CrashHandler::install(dump_file);
+        colorlog::CrashHandler::install(dump_file);
+        std::atomic<bool> release{false};
+        colorlog::AsyncLogger async_logger(config);
+        log_while_held(async_logger, release);
+        std::abort();
+    }
+    int status = 0;
+    ::waitpid(child, &status, 0);
+    assert(WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT);
+    dump = read_file(dump_file);
+    assert(dump.find("*** colorlog: caught SIGABRT, queued records follow\n") == 0);
+    assert(dump.find("[ERROR] test_async.cpp:2 queued 7 2.5 text\n") != std::string::npos);
+    std::remove("test_crash_log.txt");
+}
+
+// Listening socket on an ephemeral loopback port; returns the descriptor and sets `port`
+static int listen_loopback(int type, uint16_t& port) {
+    int fd = ::socket(AF_INET, type, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    assert(::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0);
+    assert(::getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length) == 0);
+    port = ntohs(address.sin_port);
+    if (type == SOCK_STREAM) {
+        assert(::listen(fd, 1) == 0);
+    }
+    return fd;
+}
+
+// Function to test shipping records to TCP and UDP collectors and spooling while none listens
+void test_network_sink() {
+    // Compressed length-prefixed frames over TCP
+    uint16_t port = 0;
+    int listener = listen_loopback(SOCK_STREAM, port);
+    std::string received;
+    std::thread collector([listener, &received] {
+        int connection = ::accept(listener, nullptr, nullptr);
+        char buffer[4096];
+        ssize_t n;
+        while ((n = ::read(connection, buffer, sizeof(buffer))) > 0) {
+            received.append(buffer, static_cast<size_t>(n));
+        }
+        ::close(connection);
+    });
+    colorlog::NetworkSinkOptions options;
+    options.port = port;
+    options.compress = true;
+    options.frame_bytes = 4096;
+    auto sink = std::make_shared<colorlog::NetworkSink>(options);
+    colorlog::LoggerConfig config;
+    config.sinks = {sink};
+    {
+        colorlog::AsyncLogger async_logger(config);
+        for (int i = 0; i < 1000; ++i) {
+            async_logger.logf(colorlog::LogLevel::info, "test_async.cpp", 10, "network message {}", i);
+        }
+    }
+    config.sinks.clear();
+    sink.reset();
+    collector.join();
+    ::close(listener);
+
+    std::string records;
+    size_t pos = 0;
+    int frames = 0;
+    while (pos + 4 <= received.size()) {
+        size_t size = 0;
+        for (int i = 0; i < 4; ++i) {
+            size = (size << 8) | static_cast<uint8_t>(received[pos + i]);
+        }
+        assert(colorlog::NetworkSink::decode_frame(std::string_view(received).substr(pos + 4, size), records));
+        pos += 4 + size;
+        ++frames;
+    }
+    assert(pos == received.size() && frames > 1);
+    assert(received.size() < records.size() / 2);
+    std::istringstream lines(records);
+    std::string line;
+    for (int i = 0; i < 1000; ++i) {
+        assert(std::getline(lines, line));
+        assert(line == "[INFO] test_async.cpp:10 network message " + std::to_string(i));
+    }
+    assert(!std::getline(lines, line));
+
+    // RFC 5424 messages over UDP
+    int datagrams = listen_loopback(SOCK_DGRAM, port);
+    options = colorlog::NetworkSinkOptions();
+    options.port = port;
+    options.protocol = colorlog::NetworkProtocol::Udp;
+    options.framing = colorlog::NetworkFraming::Syslog;
+    options.app_name = "tester";
+    config.sinks = {std::make_shared<colorlog::NetworkSink>(options)};
+    {
+        colorlog::AsyncLogger async_logger(config);
+        async_logger.logf(colorlog::LogLevel::warn, "test_async.cpp", 20, "disk {} full", 97);
+    }
+    config.sinks.clear();
+    char datagram[1024];
+    ssize_t n = ::recv(datagrams, datagram, sizeof(datagram), 0);
+    ::close(datagrams);
+    std::string message(datagram, static_cast<size_t>(n));
+    assert(message.find("<12>1 - ") == 0);
+    assert(message.find(" tester " + std::to_string(::getpid()) + " - - test_async.cpp:20 disk 97 full") != std::string::npos);
+
+    // No collector: logging goes on, the spool keeps only the newest records and shutdown is prompt
+    ::close(listen_loopback(SOCK_STREAM, port));
+    options = colorlog::NetworkSinkOptions();
+    options.port = port;
+    options.spool_bytes = 4096;
+    sink = std::make_shared<colorlog::NetworkSink>(options);
+    config.sinks = {sink};
+    auto start = std::chrono::steady_clock::now();
+    {
+        colorlog::AsyncLogger async_logger(config);
+        for (int i = 0; i < 1000; ++i) {
+            async_logger.logf(colorlog::LogLevel::info, "test_async.cpp", 30, "unsent message {}", i);
+        }
+    }
+    config.sinks.clear();
+    assert(!sink->connected() && sink->frames_sent() == 0 && sink->dropped() > 0);
+    sink.reset();
+    assert(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+}
+
 int main() {
     std::cout << "Testing synchronous logging with default configuration..." << std::endl;
     test_sync_logging_default();
@@ -127,6 +1092,72 @@ int main() {
     std::cout << "Testing file logging..." << std::endl;
     test_file_logging();
 
+    std::cout << "Testing async multi-producer ring..." << std::endl;
+    test_async_multi_producer();
+
+    std::cout << "Testing async overflow policies..." << std::endl;
+    test_async_overflow_policy(colorlog::OverflowPolicy::DropNewest);
+    test_async_overflow_policy(colorlog::OverflowPolicy::DropOldest);
+    test_async_overflow_policy(colorlog::OverflowPolicy::Sample);
+
+    std::cout << "Testing blocking overflow on the worker thread..." << std::endl;
+    test_async_block_on_worker();
+
+    std::cout << "Testing async messages whose formatting throws..." << std::endl;
+    test_async_throwing_message();
+
+    std::cout << "Testing async deferred formatting..." << std::endl;
+    test_async_deferred_formatting();
+
+    std::cout << "Testing large async entries..." << std::endl;
+    test_async_large_entries();
+
+    std::cout << "Testing async ranges..." << std::endl;
+    test_async_ranges();
+
+    std::cout << "Testing async log context..." << std::endl;
+    test_async_context();
+
+    std::cout << "Testing async binary logging..." << std::endl;
+    test_async_binary_logging();
+
+    std::cout << "Testing async flush policy..." << std::endl;
+    test_async_flush_policy();
+
+    std::cout << "Testing async awaitable flush..." << std::endl;
+    test_async_awaitable_flush();
+
+    std::cout << "Testing async batched writes..." << std::endl;
+    test_async_batched_writes();
+
+    std::cout << "Testing async parallel sinks..." << std::endl;
+    test_async_parallel_sinks();
+
+    std::cout << "Testing merged async shards..." << std::endl;
+    test_async_sharded_merged();
+
+    std::cout << "Testing per-shard async files..." << std::endl;
+    test_async_sharded_per_shard();
+
+    std::cout << "Testing async site limits..." << std::endl;
+    test_async_site_limits();
+
+    std::cout << "Testing async sampling..." << std::endl;
+    test_async_sampling();
+
+    std::cout << "Testing async stats..." << std::endl;
+    test_async_stats();
+
+    std::cout << "Testing crash handler..." << std::endl;
+    test_crash_handler();
+
+    std::cout << "Testing network sink..." << std::endl;
+    test_network_sink();
+
+    // Last, since the default logger's worker lives until exit
+    std::cout << "Testing logger factory..." << std::endl;
+    test_logger_factory();
+
     std::cout << "All tests passed!" << std::endl;
     return 0;
 }
@@ -0,0 +1,405 @@
+#include "../include/colorlog.hpp"
+#include "colorlog_bench_common.hpp"
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <queue>
+#include <string>
+#include <cstdio> // For std::remove
+#include <cstdlib>
+#include <algorithm>
+#include <atomic>
+
+using namespace colorlog;
+
+// Reference implementation of the previous AsyncLogger design (std::queue guarded by a
+// single mutex that the worker holds while writing), kept here as a baseline
+class LockedQueueLogger {
+public:
+    LockedQueueLogger(const LoggerConfig& config) : logger_(config) {
+        worker_thread_ = std::thread(&LockedQueueLogger::processQueue, this);
+    }
+
+    ~LockedQueueLogger() {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            stop_thread_ = true;
+        }
+        cv_.notify_all();
+        worker_thread_.join();
+    }
+
+    void log(LogLevel level, const std::string& file, int line, const std::string& msg) {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        log_queue_.push({level, file, line, msg});
+        cv_.notify_one();
+    }
+
+private:
+    struct LogEntry {
+        LogLevel level;
+        std::string file;
+        int line;
+        std::string msg;
+    };
+
+    void processQueue() {
+        while (true) {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            cv_.wait(lock, [this] { return !log_queue_.empty() || stop_thread_; });
+            while (!log_queue_.empty()) {
+                auto& log_entry = log_queue_.front();
+                logger_.log(log_entry.level, log_entry.file, log_entry.line, log_entry.msg);
+                log_queue_.pop();
+            }
+            if (stop_thread_) break;
+        }
+    }
+
+    Logger logger_;
+    std::thread worker_thread_;
+    std::queue<LogEntry> log_queue_;
+    std::mutex queue_mutex_;
+    std::condition_variable cv_;
+    bool stop_thread_ = false;
+};
+
+// Compare synchronous, mutex-queue async and ring-buffer async throughput
+void bench_throughput(BenchReport& report, int threads, int per_thread) {
+    run_throughput(report, "sync", threads, per_thread, [] { return std::make_unique<Logger>(bench_config()); });
+    run_throughput(report, "async_locked_queue", threads, per_thread, [] { return std::make_unique<LockedQueueLogger>(bench_config()); });
+    run_throughput(report, "async_ring", threads, per_thread, [] { return std::make_unique<AsyncLogger>(bench_config()); });
+}
+
+// Compare AsyncLogger batch sizes in a burst; with FlushPolicy::Always each batch is one write and one flush
+void bench_batching(BenchReport& report, int threads, int per_thread) {
+    auto make_batched = [](size_t batch_size) {
+        return [batch_size] {
+            LoggerConfig config = bench_config();
+            config.flush_policy = FlushPolicy::Always;
+            config.batch_size = batch_size;
+            return std::make_unique<AsyncLogger>(config);
+        };
+    };
+    run_throughput(report, "async_batch_1", threads, per_thread, make_batched(1));
+    run_throughput(report, "async_batch_16", threads, per_thread, make_batched(16));
+    run_throughput(report, "async_batch_256", threads, per_thread, make_batched(256));
+}
+
+// Scale producers from 1 to 128 threads against one worker and against sharded workers,
+// keeping the total message count fixed
+void bench_scaling(BenchReport& report, int total, size_t workers) {
+    auto make_sharded = [](size_t worker_count, ShardOrdering ordering) {
+        return [worker_count, ordering] {
+            LoggerConfig config = bench_config();
+            config.worker_count = worker_count;
+            config.shard_ordering = ordering;
+            return std::make_unique<AsyncLogger>(config);
+        };
+    };
+    std::string merged = "async_shards_" + std::to_string(workers) + "_merged";
+    std::string per_shard = "async_shards_" + std::to_string(workers) + "_per_shard";
+    for (int threads = 1; threads <= 128; threads *= 2) {
+        int per_thread = std::max(total / threads, 1);
+        run_throughput(report, "async_shards_1", threads, per_thread, make_sharded(1, ShardOrdering::Merged));
+        run_throughput(report, merged.c_str(), threads, per_thread, make_sharded(workers, ShardOrdering::Merged));
+        run_throughput(report, per_shard.c_str(), threads, per_thread, make_sharded(workers, ShardOrdering::PerShard));
+    }
+    for (size_t i = 1; i < workers; ++i) {
+        std::remove(AsyncLogger::shard_file_name(kBenchLogFile, i).c_str());
+    }
+}
+
+// Time `iterations` calls of log_one and report the cost per call
+template <typename LogOne>
+static void run_calls(BenchReport& report, const char* name, long iterations, LogOne log_one) {
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; ++i) {
+        log_one();
+    }
+    report.add(name, {}, {{"ns_per_call", elapsed_ns(start) / static_cast<double>(iterations)}});
+}
+
+// Measure synchronous append latency for ofstream and memory-mapped file output
+void bench_file_append(BenchReport& report, long iterations) {
+    auto run = [&report, iterations](const char* name, OutputMode mode) {
+        std::remove(kBenchLogFile);
+        LoggerConfig config = bench_config();
+        config.output_mode = mode;
+        config.flush_policy = FlushPolicy::Never;
+        Logger logger(config);
+        run_calls(report, name, iterations, [&logger] { logger.log(LogLevel::info, "bench.cpp", 42, "append latency benchmark message"); });
+    };
+    run("append_file", OutputMode::File);
+#if !defined(_WIN32) && !defined(_WIN64)
+    run("append_mapped", OutputMode::Mapped);
+    for (int i = 0; i < 64; ++i) {
+        std::remove((std::string(kBenchLogFile) + "." + std::to_string(i)).c_str());
+    }
+#endif
+}
+
+// Sink write throughput for memory-mapped output, next to the console and file sinks of bench_common
+void bench_mapped_sink(BenchReport& report, long iterations) {
+#if !defined(_WIN32) && !defined(_WIN64)
+    LoggerConfig config = bench_config();
+    config.output_mode = OutputMode::Mapped;
+    run_sink(report, "sink_mapped", config, iterations);
+    for (int i = 0; i < 64; ++i) {
+        std::remove((std::string(kBenchLogFile) + "." + std::to_string(i)).c_str());
+    }
+#else
+    (void)report;
+    (void)iterations;
+#endif
+}
+
+// Measure synchronous logging with a cached timestamp prefix from each clock source
+void bench_timestamps(BenchReport& report, long iterations) {
+    auto run = [&report, iterations](const char* name, TimestampFormat format, ClockSource source) {
+        std::remove(kBenchLogFile);
+        LoggerConfig config = bench_config();
+        config.flush_policy = FlushPolicy::Never;
+        config.timestamp_format = format;
+        config.clock_source = source;
+        Logger logger(config);
+        run_calls(report, name, iterations, [&logger] { logger.log(LogLevel::info, "bench.cpp", 42, "timestamp benchmark message"); });
+    };
+    run("timestamp_none", TimestampFormat::None, ClockSource::System);
+    run("timestamp_system", TimestampFormat::Microseconds, ClockSource::System);
+    run("timestamp_coarse", TimestampFormat::Microseconds, ClockSource::Coarse);
+    run("timestamp_tsc", TimestampFormat::Microseconds, ClockSource::Tsc);
+}
+
+// Compare message formatting alone: std::ostringstream composition, the previous operator<< path
+// over a reused FormatStream, and the "{}" engine converting built-in types in place
+void bench_formatting(BenchReport& report, long iterations) {
+    auto run = [&report, iterations](const char* name, auto format_one) {
+        size_t total = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (long i = 0; i < iterations; ++i) {
+            total += format_one(static_cast<int>(i), 0.25 * static_cast<double>(i));
+        }
+        report.add(name, {}, {{"ns_per_message", elapsed_ns(start) / static_cast<double>(iterations)},
+                              {"bytes", static_cast<double>(total)}});
+    };
+    run("format_ostringstream", [](int id, double ratio) {
+        std::ostringstream oss;
+        oss << "req " << id << " took " << ratio << "us from " << "client";
+        return oss.str().size();
+    });
+    detail::FormatStream stream;
+    FormatBuffer buffer;
+    run("format_stream", [&](int id, double ratio) {
+        buffer.clear();
+        detail::format_to(stream.attach(buffer), "req {} took {}us from {}", id, ratio, "client");
+        return buffer.size();
+    });
+    run("format_engine", [&](int id, double ratio) {
+        buffer.clear();
+        detail::format_into(stream, buffer, "req {} took {}us from {}", id, ratio, "client");
+        return buffer.size();
+    });
+}
+
+// Policy for a static file logger comparable to bench_config() with FlushPolicy::Never
+struct BenchFilePolicy : StaticPolicy {
+    using Sinks = std::tuple<StaticFileSink>;
+    static constexpr bool flush_every_record = false;
+};
+
+// Same, with everything below error compiled out
+struct BenchErrorPolicy : BenchFilePolicy {
+    static constexpr LogLevel min_level = LogLevel::error;
+};
+
+template <typename LoggerT>
+static void run_append(BenchReport& report, const char* name, LoggerT& logger, long iterations) {
+    run_calls(report, name, iterations, [&logger] { logger.log(LogLevel::info, "bench.cpp", 42, "static policy benchmark message"); });
+}
+
+// Compare the runtime-configured Logger with a compile-time BasicLogger policy, locked and unlocked
+void bench_static_logger(BenchReport& report, long iterations) {
+    {
+        std::remove(kBenchLogFile);
+        LoggerConfig config = bench_config();
+        config.flush_policy = FlushPolicy::Never;
+        Logger logger(config);
+        run_append(report, "dynamic_logger", logger, iterations);
+    }
+    {
+        std::remove(kBenchLogFile);
+        BasicLogger<BenchFilePolicy> logger(kBenchLogFile);
+        run_append(report, "static_logger_mutex", logger, iterations);
+    }
+    {
+        struct UnlockedPolicy : BenchFilePolicy {
+            using Mutex = NullMutex;
+        };
+        std::remove(kBenchLogFile);
+        BasicLogger<UnlockedPolicy> logger(kBenchLogFile);
+        run_append(report, "static_logger_unlocked", logger, iterations);
+    }
+}
+
+// Disabled-level call cost of the static-policy logger, next to the sync and async ones of bench_common
+void bench_disabled_static(BenchReport& report, long iterations) {
+    BasicLogger<BenchErrorPolicy> logger(kBenchLogFile);
+    run_disabled(report, "disabled_static", logger, iterations);
+}
+
+// Measure a flood from one call site against an unlimited logger, a per-site rate limit and repeat suppression
+void bench_site_limits(BenchReport& report, long iterations) {
+    auto run = [&report, iterations](const char* name, std::unordered_map<LogLevel, SiteLimit> limits) {
+        std::remove(kBenchLogFile);
+        LoggerConfig config = bench_config();
+        config.flush_policy = FlushPolicy::Never;
+        config.site_limits = std::move(limits);
+        Logger logger(config);
+        run_calls(report, name, iterations, [&logger] { COLORLOG_LOGF(logger, LogLevel::error, "dependency {} unavailable", "db"); });
+    };
+    run("site_unlimited", {});
+    run("site_rate_limited", {{LogLevel::error, SiteLimit{100, 10, false}}});
+    run("site_repeats_suppressed", {{LogLevel::error, SiteLimit{0, 1, true}}});
+}
+
+// Measure the overhead of collect_stats on synchronous logging, and report the async latency histogram
+void bench_stats(BenchReport& report, long iterations, int threads) {
+    auto run = [&report, iterations](const char* name, bool collect) {
+        std::remove(kBenchLogFile);
+        LoggerConfig config = bench_config();
+        config.flush_policy = FlushPolicy::Never;
+        config.collect_stats = collect;
+        Logger logger(config);
+        run_calls(report, name, iterations, [&logger] { logger.log(LogLevel::info, "bench.cpp", 42, "stats benchmark message"); });
+    };
+    run("stats_off", false);
+    run("stats_on", true);
+
+    std::remove(kBenchLogFile);
+    LoggerConfig config = bench_config();
+    config.collect_stats = true;
+    LoggerStats stats;
+    {
+        AsyncLogger logger(config);
+        std::vector<std::thread> producers;
+        for (int t = 0; t < threads; ++t) {
+            producers.emplace_back([&logger, iterations, threads] {
+                for (long i = 0; i < iterations / threads; ++i) {
+                    logger.log(LogLevel::info, "bench.cpp", 42, std::string("stats benchmark message"));
+                }
+            });
+        }
+        for (auto& producer : producers) producer.join();
+        logger.flush();
+        stats = logger.stats();
+    }
+    report.add("stats_async", {{"threads", threads}, {"msgs", static_cast<long>(stats.total_messages())}},
+               {{"latency_p50_ns", static_cast<double>(stats.latency.percentile(50))},
+                {"latency_p99_ns", static_cast<double>(stats.latency.percentile(99))},
+                {"latency_max_ns", static_cast<double>(stats.latency.max_ns)},
+                {"queue_high_water", static_cast<double>(stats.queue_high_water)}});
+}
+
+// Allocations per message and per-call enqueue latency of the previous std::queue design and
+// the ring, whose slots hold small messages inline and spill large ones into a recycled arena
+void bench_entry_storage(BenchReport& report, int threads, int per_thread) {
+    auto run = [&report, threads, per_thread](const char* name, size_t bytes, auto make_logger) {
+        std::remove(kBenchLogFile);
+        std::string msg(bytes, 'm');
+        std::vector<LatencyHistogram> latencies(static_cast<size_t>(threads));
+        long allocations = 0;
+        {
+            auto logger = make_logger();
+            for (int i = 0; i < 1000; ++i) {
+                logger->log(LogLevel::info, "bench.cpp", 42, msg);  // Warm up buffers and arenas
+            }
+            allocation_count.store(0);
+            counting_allocations.store(true);
+            std::vector<std::thread> producers;
+            for (int t = 0; t < threads; ++t) {
+                producers.emplace_back([&logger, &msg, &latency = latencies[static_cast<size_t>(t)], per_thread] {
+                    for (int i = 0; i < per_thread; ++i) {
+                        auto start = std::chrono::steady_clock::now();
+                        logger->log(LogLevel::info, "bench.cpp", 42, msg);
+                        auto ns = static_cast<uint64_t>(elapsed_ns(start));
+                        ++latency.counts[LatencyHistogram::bucket_of(ns)];
+                        ++latency.count;
+                        latency.sum_ns += ns;
+                        latency.max_ns = std::max(latency.max_ns, ns);
+                    }
+                });
+            }
+            for (auto& producer : producers) producer.join();
+            counting_allocations.store(false);
+            allocations = allocation_count.load();
+        }
+        LatencyHistogram latency;
+        for (const LatencyHistogram& thread_latency : latencies) {
+            for (size_t i = 0; i < latency.counts.size(); ++i) {
+                latency.counts[i] += thread_latency.counts[i];
+            }
+            latency.count += thread_latency.count;
+            latency.sum_ns += thread_latency.sum_ns;
+            latency.max_ns = std::max(latency.max_ns, thread_latency.max_ns);
+        }
+        double total = static_cast<double>(threads) * per_thread;
+        report.add(name, {{"msg_bytes", static_cast<long>(bytes)}, {"threads", threads}, {"msgs", static_cast<long>(total)}},
+                   {{"allocs_per_msg", static_cast<double>(allocations) / total},
+                    {"enqueue_p50_ns", static_cast<double>(latency.percentile(50))},
+                    {"enqueue_p99_ns", static_cast<double>(latency.percentile(99))},
+                    {"enqueue_max_ns", static_cast<double>(latency.max_ns)}});
+    };
+    LoggerConfig config = bench_config();
+    config.flush_policy = FlushPolicy::Never;
+    for (size_t bytes : {64, 1024}) {
+        run("entry_locked_queue", bytes, [&config] { return std::make_unique<LockedQueueLogger>(config); });
+        run("entry_ring", bytes, [&config] { return std::make_unique<AsyncLogger>(config); });
+    }
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options = BenchOptions::parse(argc, argv);
+    BenchReport report("colorlog.hpp");
+
+    bench_common(report, options);
+
+    std::cout << "Benchmarking logging throughput..." << std::endl;
+    bench_throughput(report, options.threads, options.per_thread);
+
+    std::cout << "Benchmarking batched async writes..." << std::endl;
+    bench_batching(report, options.threads, options.per_thread);
+
+    std::cout << "Benchmarking sharded async workers..." << std::endl;
+    bench_scaling(report, options.threads * options.per_thread, options.workers);
+
+    std::cout << "Benchmarking queued entry storage..." << std::endl;
+    bench_entry_storage(report, options.threads, options.per_thread);
+
+    std::cout << "Benchmarking file append latency..." << std::endl;
+    bench_file_append(report, 1000000);
+
+    std::cout << "Benchmarking memory-mapped sink throughput..." << std::endl;
+    bench_mapped_sink(report, 1000000);
+
+    std::cout << "Benchmarking timestamps..." << std::endl;
+    bench_timestamps(report, 1000000);
+
+    std::cout << "Benchmarking message formatting..." << std::endl;
+    bench_formatting(report, 1000000);
+
+    std::cout << "Benchmarking static policy loggers..." << std::endl;
+    bench_static_logger(report, 1000000);
+
+    std::cout << "Benchmarking call-site limits..." << std::endl;
+    bench_site_limits(report, 1000000);
+
+    std::cout << "Benchmarking self-instrumentation..." << std::endl;
+    bench_stats(report, 1000000, options.threads);
+
+    std::cout << "Benchmarking disabled static-policy calls..." << std::endl;
+    bench_disabled_static(report, 10000000);
+
+    return finish_report(report, options);
+}
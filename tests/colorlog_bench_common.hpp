@@ -0,0 +1,455 @@
+// Benchmark harness shared by colorlog_bench (colorlog.hpp) and colorlog_bench_cpp17
+// (colorlog_cpp17.hpp). Include it after one of the two headers, from one translation unit
+// only, since it replaces the global operator new. The common benchmarks use only the API both
+// headers provide, so their results carry the same names and can be compared with --baseline.
+#ifndef COLORLOG_BENCH_COMMON_HPP_
+#define COLORLOG_BENCH_COMMON_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio> // For std::remove
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Allocation counter; only counts while counting_allocations is set
+static std::atomic<long> allocation_count{0};
+static std::atomic<bool> counting_allocations{false};
+
+void* operator new(std::size_t size) {
+    if (counting_allocations.load(std::memory_order_relaxed)) {
+        allocation_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    void* p = std::malloc(size ? size : 1);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+// Kept out of line: once inlined, the free() inside is paired
+// with a call to the replaceable operator new, which -Wmismatched-new-delete reports
+[[gnu::noinline]] void operator delete(void* p) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete[](void* p) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+static const char* kBenchLogFile = "colorlog_bench.log";
+
+static colorlog::LoggerConfig bench_config() {
+    colorlog::LoggerConfig config;
+    config.log_level = colorlog::LogLevel::debug;
+    config.output_mode = colorlog::OutputMode::File;
+    config.log_file_name = kBenchLogFile;
+    return config;
+}
+
+static double elapsed_ns(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+// One measured result. `params` identify the run (thread count, message size) and `metrics` hold
+// the numbers; the first metric is the one checked against a baseline
+struct BenchResult {
+    std::string name;
+    std::vector<std::pair<std::string, long>> params;
+    std::vector<std::pair<std::string, double>> metrics;
+
+    // Name and parameters, the same for the same run in either benchmark binary
+    std::string key() const {
+        std::string key = name;
+        for (const auto& param : params) {
+            key += " " + param.first + "=" + std::to_string(param.second);
+        }
+        return key;
+    }
+
+    const double* metric(const std::string& metric_name) const {
+        for (const auto& metric : metrics) {
+            if (metric.first == metric_name) return &metric.second;
+        }
+        return nullptr;
+    }
+};
+
+// Rates are better when higher, everything else (latencies, costs, allocations) when lower
+static bool higher_is_better(const std::string& metric_name) {
+    const std::string suffix = "per_sec";
+    return metric_name.size() >= suffix.size() &&
+           metric_name.compare(metric_name.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Collects results, printing each as a "name key=value ..." line, and writes them as JSON
+class BenchReport {
+public:
+    explicit BenchReport(std::string header) : header_(std::move(header)) {}
+
+    void add(std::string name, std::vector<std::pair<std::string, long>> params,
+             std::vector<std::pair<std::string, double>> metrics) {
+        BenchResult result{std::move(name), std::move(params), std::move(metrics)};
+        std::cout << result.key();
+        for (const auto& metric : result.metrics) {
+            std::cout << " " << metric.first << "=" << metric.second;
+        }
+        std::cout << std::endl;
+        results_.push_back(std::move(result));
+    }
+
+    // Write {"header": ..., "cplusplus": ..., "results": [...]} with one result per line, the
+    // layout read_json expects
+    bool write_json(const std::string& path) const {
+        std::ofstream out(path, std::ios::out | std::ios::trunc);
+        out << "{\n  \"header\": \"" << header_ << "\",\n  \"cplusplus\": " << __cplusplus << ",\n  \"results\": [\n";
+        for (size_t i = 0; i < results_.size(); ++i) {
+            const BenchResult& result = results_[i];
+            out << "    {\"name\": \"" << result.name << "\", \"params\": {";
+            for (size_t p = 0; p < result.params.size(); ++p) {
+                out << (p ? ", " : "") << "\"" << result.params[p].first << "\": " << result.params[p].second;
+            }
+            out << "}, \"metrics\": {";
+            for (size_t m = 0; m < result.metrics.size(); ++m) {
+                out << (m ? ", " : "") << "\"" << result.metrics[m].first << "\": " << result.metrics[m].second;
+            }
+            out << "}}" << (i + 1 < results_.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+        return static_cast<bool>(out);
+    }
+
+    // Read the results of a file written by write_json; other JSON layouts are not understood
+    static std::vector<BenchResult> read_json(const std::string& path) {
+        std::vector<BenchResult> results;
+        std::ifstream in(path);
+        for (std::string line; std::getline(in, line);) {
+            size_t name = line.find("{\"name\": \"");
+            size_t params = line.find("\"params\": {");
+            size_t metrics = line.find("\"metrics\": {");
+            if (name == std::string::npos || params == std::string::npos || metrics == std::string::npos) continue;
+            BenchResult result;
+            name += 10;
+            result.name = line.substr(name, line.find('"', name) - name);
+            for (const auto& field : fields(line, params + 11)) {
+                result.params.emplace_back(field.first, static_cast<long>(field.second));
+            }
+            result.metrics = fields(line, metrics + 12);
+            results.push_back(std::move(result));
+        }
+        return results;
+    }
+
+    // Print each result that the baseline also has, with the ratio of its metrics to the baseline's.
+    // Returns false if a first metric is worse than the baseline's by more than max_regression
+    // percent (negative disables the check)
+    bool compare(const std::vector<BenchResult>& baseline, const std::string& baseline_name, double max_regression) const {
+        bool within = true;
+        std::cout << "Comparing against " << baseline_name << "..." << std::endl;
+        for (const BenchResult& result : results_) {
+            auto base = std::find_if(baseline.begin(), baseline.end(),
+                                     [&result](const BenchResult& b) { return b.key() == result.key(); });
+            if (base == baseline.end()) continue;
+            std::cout << result.key();
+            for (size_t m = 0; m < result.metrics.size(); ++m) {
+                const std::string& metric_name = result.metrics[m].first;
+                const double* base_value = base->metric(metric_name);
+                if (base_value == nullptr || *base_value == 0) continue;
+                double ratio = result.metrics[m].second / *base_value;
+                std::cout << " " << metric_name << "_ratio=" << ratio;
+                double regression = (higher_is_better(metric_name) ? 1.0 / ratio - 1.0 : ratio - 1.0) * 100.0;
+                if (m == 0 && max_regression >= 0 && regression > max_regression) {
+                    std::cout << " REGRESSION";
+                    within = false;
+                }
+            }
+            std::cout << std::endl;
+        }
+        return within;
+    }
+
+private:
+    // "key": number pairs from `pos` up to the closing brace
+    static std::vector<std::pair<std::string, double>> fields(const std::string& line, size_t pos) {
+        std::vector<std::pair<std::string, double>> out;
+        size_t end = line.find('}', pos);
+        while (pos < end) {
+            size_t key = line.find('"', pos);
+            if (key == std::string::npos || key > end) break;
+            size_t key_end = line.find('"', key + 1);
+            size_t value = line.find(':', key_end) + 1;
+            out.emplace_back(line.substr(key + 1, key_end - key - 1), std::strtod(line.c_str() + value, nullptr));
+            pos = line.find_first_of(",}", value);
+            if (pos == std::string::npos) break;
+            ++pos;
+        }
+        return out;
+    }
+
+    std::string header_;  // Header the results were measured with
+    std::vector<BenchResult> results_;
+};
+
+// Command line: [threads] [per_thread] [workers] [--json path] [--baseline path] [--max-regression percent]
+struct BenchOptions {
+    int threads = 4;
+    int per_thread = 50000;
+    size_t workers = 4;
+    std::string json_path;      // Write the results here as JSON
+    std::string baseline_path;  // Compare against the results of another run
+    double max_regression = -1;  // Fail when a first metric regressed by more than this percentage
+
+    static BenchOptions parse(int argc, char** argv) {
+        BenchOptions options;
+        int positional = 0;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--json" && i + 1 < argc) {
+                options.json_path = argv[++i];
+            } else if (arg == "--baseline" && i + 1 < argc) {
+                options.baseline_path = argv[++i];
+            } else if (arg == "--max-regression" && i + 1 < argc) {
+                options.max_regression = std::atof(argv[++i]);
+            } else if (positional == 0) {
+                options.threads = std::atoi(argv[i]);
+                ++positional;
+            } else if (positional == 1) {
+                options.per_thread = std::atoi(argv[i]);
+                ++positional;
+            } else {
+                options.workers = static_cast<size_t>(std::atoi(argv[i]));
+            }
+        }
+        return options;
+    }
+};
+
+// Write the JSON and compare against the baseline as the options ask; returns the exit code
+static int finish_report(const BenchReport& report, const BenchOptions& options) {
+    std::remove(kBenchLogFile);
+    if (!options.json_path.empty() && !report.write_json(options.json_path)) {
+        std::cerr << "Cannot write " << options.json_path << std::endl;
+        return 1;
+    }
+    if (!options.baseline_path.empty()) {
+        std::vector<BenchResult> baseline = BenchReport::read_json(options.baseline_path);
+        if (baseline.empty()) {
+            std::cerr << "No results in " << options.baseline_path << std::endl;
+            return 1;
+        }
+        if (!report.compare(baseline, options.baseline_path, options.max_regression)) {
+            return 2;
+        }
+    }
+    return 0;
+}
+
+// Percentiles of per-call latencies in nanoseconds
+class LatencySamples {
+public:
+    explicit LatencySamples(size_t capacity) { samples_.reserve(capacity); }
+
+    void add(uint64_t ns) { samples_.push_back(ns); }
+
+    void merge(const LatencySamples& other) {
+        samples_.insert(samples_.end(), other.samples_.begin(), other.samples_.end());
+    }
+
+    // Sorts the samples on first use after add or merge
+    double percentile(double p) {
+        if (samples_.empty()) return 0;
+        std::sort(samples_.begin(), samples_.end());
+        size_t index = static_cast<size_t>(p / 100.0 * static_cast<double>(samples_.size() - 1));
+        return static_cast<double>(samples_[index]);
+    }
+
+private:
+    std::vector<uint64_t> samples_;
+};
+
+// Run `threads` producers, each logging `per_thread` messages, and report messages per second.
+// The timing includes draining, because the loggers are destroyed inside the measured scope.
+template <typename MakeLogger>
+static void run_throughput(BenchReport& report, const char* name, int threads, int per_thread, MakeLogger make_logger) {
+    std::remove(kBenchLogFile);
+    auto start = std::chrono::steady_clock::now();
+    {
+        auto logger = make_logger();
+        std::vector<std::thread> producers;
+        for (int t = 0; t < threads; ++t) {
+            producers.emplace_back([&logger, per_thread] {
+                for (int i = 0; i < per_thread; ++i) {
+                    logger->log(colorlog::LogLevel::info, "bench.cpp", 42, std::string("throughput benchmark message"));
+                }
+            });
+        }
+        for (auto& producer : producers) producer.join();
+    }
+    double seconds = elapsed_ns(start) / 1e9;
+    double total = static_cast<double>(threads) * per_thread;
+    report.add(name, {{"threads", threads}, {"msgs", static_cast<long>(total)}},
+               {{"msgs_per_sec", total / seconds}, {"seconds", seconds}});
+}
+
+// Cost of a call filtered out by the runtime level
+template <typename LoggerT>
+static void run_disabled(BenchReport& report, const char* name, LoggerT& logger, long iterations) {
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; ++i) {
+        logger.log(colorlog::LogLevel::debug, "bench.cpp", 42, "disabled benchmark message");
+    }
+    report.add(name, {}, {{"ns_per_call", elapsed_ns(start) / static_cast<double>(iterations)}});
+}
+
+// Disabled-level call cost of the sync and async loggers
+static void bench_disabled_calls(BenchReport& report, long iterations) {
+    colorlog::LoggerConfig config = bench_config();
+    config.log_level = colorlog::LogLevel::error;
+    {
+        colorlog::Logger logger(config);
+        run_disabled(report, "disabled_sync", logger, iterations);
+    }
+    {
+        colorlog::AsyncLogger logger(config);
+        run_disabled(report, "disabled_async", logger, iterations);
+    }
+    std::remove(kBenchLogFile);
+}
+
+// Per-call latency percentiles from `threads` producers: the full write for the sync logger, the
+// enqueue for the async one
+static void bench_call_latency(BenchReport& report, int threads, int per_thread) {
+    auto run = [&report, threads, per_thread](const char* name, auto make_logger) {
+        std::remove(kBenchLogFile);
+        std::vector<LatencySamples> latencies(static_cast<size_t>(threads), LatencySamples(static_cast<size_t>(per_thread)));
+        {
+            auto logger = make_logger();
+            std::string msg = "latency benchmark message";
+            std::vector<std::thread> producers;
+            for (int t = 0; t < threads; ++t) {
+                producers.emplace_back([&logger, &msg, &latency = latencies[static_cast<size_t>(t)], per_thread] {
+                    for (int i = 0; i < per_thread; ++i) {
+                        auto start = std::chrono::steady_clock::now();
+                        logger->log(colorlog::LogLevel::info, "bench.cpp", 42, msg);
+                        latency.add(static_cast<uint64_t>(elapsed_ns(start)));
+                    }
+                });
+            }
+            for (auto& producer : producers) producer.join();
+        }
+        LatencySamples latency(static_cast<size_t>(threads) * static_cast<size_t>(per_thread));
+        for (const LatencySamples& thread_latency : latencies) {
+            latency.merge(thread_latency);
+        }
+        report.add(name, {{"threads", threads}},
+                   {{"p50_ns", latency.percentile(50)}, {"p99_ns", latency.percentile(99)},
+                    {"p999_ns", latency.percentile(99.9)}, {"max_ns", latency.percentile(100)}});
+    };
+    run("latency_sync", [] { return std::make_unique<colorlog::Logger>(bench_config()); });
+    run("latency_async", [] { return std::make_unique<colorlog::AsyncLogger>(bench_config()); });
+}
+
+// Sustained throughput from 1 to max_threads producers, keeping the total message count fixed
+static void bench_thread_scaling(BenchReport& report, int max_threads, int total) {
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        int per_thread = std::max(total / threads, 1);
+        run_throughput(report, "scaling_sync", threads, per_thread, [] { return std::make_unique<colorlog::Logger>(bench_config()); });
+        run_throughput(report, "scaling_async", threads, per_thread, [] { return std::make_unique<colorlog::AsyncLogger>(bench_config()); });
+    }
+}
+
+// Allocations per message for small and large messages once the loggers are warmed up,
+// counting the async worker's allocations along with the producer's
+static void bench_allocations(BenchReport& report, long iterations) {
+    auto run = [&report, iterations](const char* name, size_t bytes, auto& logger) {
+        std::string msg(bytes, 'm');
+        for (int i = 0; i < 1000; ++i) {
+            logger.log(colorlog::LogLevel::info, "bench.cpp", 42, msg);  // Warm up buffers and arenas
+        }
+        allocation_count.store(0);
+        counting_allocations.store(true);
+        for (long i = 0; i < iterations; ++i) {
+            logger.log(colorlog::LogLevel::info, "bench.cpp", 42, msg);
+        }
+        counting_allocations.store(false);
+        report.add(name, {{"msg_bytes", static_cast<long>(bytes)}},
+                   {{"allocs_per_msg", static_cast<double>(allocation_count.load()) / static_cast<double>(iterations)}});
+    };
+    for (size_t bytes : {64, 1024}) {
+        std::remove(kBenchLogFile);
+        {
+            colorlog::Logger logger(bench_config());
+            run("allocs_sync", bytes, logger);
+        }
+        {
+            colorlog::AsyncLogger logger(bench_config());
+            run("allocs_async", bytes, logger);
+        }
+    }
+    std::remove(kBenchLogFile);
+}
+
+// Stream buffer discarding its input, standing in for the terminal in the console benchmark
+class NullStreambuf : public std::streambuf {
+protected:
+    int_type overflow(int_type c) override { return traits_type::not_eof(c); }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+// Write `iterations` messages through a sync logger configured with `config` and report the rate.
+// Console output goes to std::cerr, which is pointed at a NullStreambuf for the run
+static void run_sink(BenchReport& report, const char* name, const colorlog::LoggerConfig& config, long iterations) {
+    NullStreambuf null_buffer;
+    std::streambuf* cerr_buffer = std::cerr.rdbuf(&null_buffer);
+    auto start = std::chrono::steady_clock::now();
+    {
+        colorlog::Logger logger(config);
+        for (long i = 0; i < iterations; ++i) {
+            logger.log(colorlog::LogLevel::info, "bench.cpp", 42, "sink throughput benchmark message");
+        }
+    }
+    double ns = elapsed_ns(start);
+    std::cerr.rdbuf(cerr_buffer);
+    report.add(name, {}, {{"msgs_per_sec", static_cast<double>(iterations) * 1e9 / ns},
+                          {"ns_per_msg", ns / static_cast<double>(iterations)}});
+}
+
+// Sink write throughput for console and file output
+static void bench_sinks(BenchReport& report, long iterations) {
+    colorlog::LoggerConfig config = bench_config();
+    std::remove(kBenchLogFile);
+    config.output_mode = colorlog::OutputMode::Console;
+    run_sink(report, "sink_console", config, iterations);
+    config.output_mode = colorlog::OutputMode::File;
+    run_sink(report, "sink_file", config, iterations);
+    std::remove(kBenchLogFile);
+}
+
+// The benchmarks both headers can run, under the names a --baseline comparison matches
+static void bench_common(BenchReport& report, const BenchOptions& options) {
+    std::cout << "Benchmarking disabled log calls..." << std::endl;
+    bench_disabled_calls(report, 1000000);
+
+    std::cout << "Benchmarking call latency..." << std::endl;
+    bench_call_latency(report, options.threads, options.per_thread);
+
+    std::cout << "Benchmarking thread scaling..." << std::endl;
+    bench_thread_scaling(report, std::max(options.threads * 4, 1), options.threads * options.per_thread);
+
+    std::cout << "Benchmarking allocations per message..." << std::endl;
+    bench_allocations(report, 100000);
+
+    std::cout << "Benchmarking sink throughput..." << std::endl;
+    bench_sinks(report, 1000000);
+}
+
+#endif // COLORLOG_BENCH_COMMON_HPP_
@@ -0,0 +1,16 @@
+#include "../include/colorlog_cpp17.hpp"
+#include "colorlog_bench_common.hpp"
+#include <iostream>
+
+using namespace colorlog;
+
+// The benchmarks shared with colorlog_bench, run against the C++17 header. Compare with
+//   colorlog_bench_cpp17 --json cpp17.json && colorlog_bench --baseline cpp17.json
+int main(int argc, char** argv) {
+    BenchOptions options = BenchOptions::parse(argc, argv);
+    BenchReport report("colorlog_cpp17.hpp");
+
+    bench_common(report, options);
+
+    return finish_report(report, options);
+}
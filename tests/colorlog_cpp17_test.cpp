@@ -0,0 +1,154 @@
+#include "../include/colorlog_cpp17.hpp"
+#include <iostream>
+#include <cassert>
+#include <thread>
+#include <cstdio> // For std::remove
+#include <optional>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+using namespace colorlog;
+
+// Type with a colorlog::formatter specialization
+struct Point {
+    int x;
+    int y;
+};
+
+template <>
+struct colorlog::formatter<Point> {
+    static void format(colorlog::FormatBuffer& out, const Point& p) {
+        out.append("(" + std::to_string(p.x) + "," + std::to_string(p.y) + ")");
+    }
+};
+
+// Helper to read a whole log file
+std::string read_file(const std::string& log_file) {
+    std::ifstream infile(log_file);
+    std::stringstream buffer;
+    buffer << infile.rdbuf();
+    return buffer.str();
+}
+
+// Function to test that the constraints are usable as bool traits in C++17
+void test_traits() {
+    static_assert(Arithmetic<int> && !Arithmetic<std::string>);
+    static_assert(Formattable<int> && Formattable<std::string> && Formattable<Point>);
+    static_assert(!Formattable<std::thread>);
+    static_assert(StringOrIterableOfPrintable<std::vector<int>>);
+    static_assert(PrintableOptional<std::optional<int>>);
+    static_assert(!COLORLOG_CXX20);
+}
+
+// Function to test synchronous logging through the shared core
+void test_sync_logging() {
+    std::string log_file = "test_cpp17_log.txt";
+    std::remove(log_file.c_str());
+
+    LoggerConfig config;
+    config.log_level = LogLevel::info;
+    config.output_mode = OutputMode::File;
+    config.log_file_name = log_file;
+
+    int evaluations = 0;
+    {
+        Logger file_logger(config);
+        file_logger.info("request {} took {}us {{escaped}}", 42, 17);
+        file_logger.warn("point {}", Point{1, 2});
+        file_logger.error("ids {}", join(std::vector<int>{1, 2, 3, 4}, ", ", 2));
+        file_logger.debug([&] { evaluations++; return std::string("filtered"); });
+        file_logger.info([&] { evaluations++; return std::string("lazy"); });
+        COLORLOG_LOGF(file_logger, LogLevel::info, "{} and {}", "first", std::string("second"));
+    }
+    assert(evaluations == 1);  // Filtered messages are never built
+
+    std::ifstream infile(log_file);
+    std::string line;
+    std::getline(infile, line);
+    assert(line == "[INFO] request 42 took 17us {escaped}");
+    std::getline(infile, line);
+    assert(line == "[WARNING] point (1,2)");
+    std::getline(infile, line);
+    assert(line == "[ERROR] ids 1, 2 ... (2 more)");
+    std::getline(infile, line);
+    assert(line == "[INFO] lazy");
+    std::getline(infile, line);
+    assert(line.find("colorlog_cpp17_test.cpp:") != std::string::npos && line.find(" first and second") != std::string::npos);
+}
+
+// Function to test asynchronous logging through the shared rings and workers
+void test_async_logging() {
+    std::string log_file = "test_cpp17_async.txt";
+    std::remove(log_file.c_str());
+
+    LoggerConfig config;
+    config.log_level = LogLevel::debug;
+    config.output_mode = OutputMode::File;
+    config.log_file_name = log_file;
+    config.worker_count = 2;
+
+    AsyncLogger async_logger(config);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&async_logger, t] {
+            for (int i = 0; i < 250; ++i) {
+                async_logger.logf(LogLevel::info, "test_cpp17.cpp", 10, "thread {} message {}", t, i);
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    async_logger.flush();
+
+    std::ifstream infile(log_file);
+    std::string line;
+    int count = 0;
+    while (std::getline(infile, line)) {
+        count++;
+    }
+    assert(count == 1000);
+
+    async_logger.log(LogLevel::warn, "test_cpp17.cpp", 20, "This is a durable message");
+    async_logger.wait_durable();
+    assert(read_file(log_file).find("This is a durable message") != std::string::npos);
+}
+
+// Function to test the default logger behind the LOG_* macros
+void test_logger_factory() {
+    std::string log_file = "test_cpp17_factory.txt";
+    std::remove(log_file.c_str());
+
+    LoggerConfig config;
+    config.log_level = LogLevel::debug;
+    config.output_mode = OutputMode::File;
+    config.log_file_name = log_file;
+    AsyncLogger& shared = LoggerFactory::init(config);
+
+    LOG_INFO("This is a default logger message");
+    LOG_WARNF("default {} {}", 1, "two");
+    COLORLOG_LOGF(LoggerFactory::get("net"), LogLevel::error, "connection {} reset", 7);
+    shared.flush();
+
+    std::string text = read_file(log_file);
+    assert(text.find("This is a default logger message") != std::string::npos);
+    assert(text.find("default 1 two") != std::string::npos);
+    assert(text.find("connection 7 reset") != std::string::npos);
+}
+
+int main() {
+    std::cout << "Testing C++17 traits..." << std::endl;
+    test_traits();
+
+    std::cout << "Testing C++17 synchronous logging..." << std::endl;
+    test_sync_logging();
+
+    std::cout << "Testing C++17 asynchronous logging..." << std::endl;
+    test_async_logging();
+
+    std::cout << "Testing C++17 logger factory..." << std::endl;
+    test_logger_factory();
+
+    std::cout << "All tests passed!" << std::endl;
+    return 0;
+}
@@ -6,6 +6,12 @@
 #include <stdexcept>
 #include <cstdio> // For std::remove
 #include <optional>
+#include <vector>
+#include <list>
+#include <filesystem>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 
 using namespace colorlog;
 
@@ -115,6 +121,939 @@ void test_file_logging() {
     assert(count == 6);  // Ensure all messages were logged
 }
 
+// Function to test runtime level filtering
+void test_runtime_level_filtering() {
+    std::string log_file = "test_level_log.txt";
+    std::remove(log_file.c_str());
+
+    colorlog::LoggerConfig config;
+    config.log_level = colorlog::LogLevel::debug;
+    config.output_mode = colorlog::OutputMode::File;
+    config.log_file_name = log_file;
+
+    {
+        colorlog::Logger file_logger(config);
+        file_logger.debug("This is a debug message");
+        file_logger.set_log_level(colorlog::LogLevel::error);
+        assert(!file_logger.should_log(colorlog::LogLevel::warn));
+        file_logger.info("This info message is filtered");
+        file_logger.warn("This warning message is filtered");
+        file_logger.error("This is an error message");
+        file_logger.fatal("This is a fatal message");
+    }
+
+    std::ifstream infile(log_file);
+    std::string line;
+    int count = 0;
+    while (std::getline(infile, line)) {
+        count++;
+    }
+    assert(count == 3);  // debug (before the change), error and fatal
+}
+
+// Function to test lazy and format-string messages
+void test_lazy_logging() {
+    std::string log_file = "test_lazy_log.txt";
+    std::remove(log_file.c_str());
+
+    colorlog::LoggerConfig config;
+    config.log_level = colorlog::LogLevel::info;
+    config.output_mode = colorlog::OutputMode::File;
+    config.log_file_name = log_file;
+
+    int evaluations = 0;
+    auto expensive_dump = [&evaluations] {
+        evaluations++;
+        return std::string("expensive dump");
+    };
+
+    {
+        colorlog::Logger file_logger(config);
+        file_logger.debug([&] { return expensive_dump(); });
+        COLORLOG_LOG(file_logger, colorlog::LogLevel::debug, expensive_dump());
+        assert(evaluations == 0);  // Filtered messages are never built
+
+        file_logger.info([&] { return expensive_dump(); });
+        file_logger.infof("request {} took {}us {{escaped}}", 42, 17);
+        COLORLOG_LOGF(file_logger, colorlog::LogLevel::warn, "{} and {}", "first", std::string("second"));
+        assert(evaluations == 1);
+    }
+
+    std::ifstream infile(log_file);
+    std::string line;
+    std::getline(infile, line);
+    assert(line == "[INFO] expensive dump");
+    std::getline(infile, line);
+    assert(line == "[INFO] request 42 took 17us {escaped}");
+    std::getline(infile, line);
+    assert(line.find("first and second") != std::string::npos);
+}
+
+// Function to test the binary output mode round trip
+void test_binary_logging() {
+    std::string log_file = "test_binary_log.bin";
+    std::remove(log_file.c_str());
+
+    colorlog::LoggerConfig config;
+    config.log_level = colorlog::LogLevel::debug;
+    config.output_mode = colorlog::OutputMode::Binary;
+    config.log_file_name = log_file;
+
+    {
+        colorlog::Logger binary_logger(config);
+        binary_logger.info("This is a binary info message");
+        for (int i = 0; i < 3; ++i) {
+            binary_logger.logf(colorlog::LogLevel::warn, "test_binary.cpp", 20, "request {} took {}us ok={}", i, 2.5, true);
+        }
+        binary_logger.error("test_binary.cpp", 30, std::vector<std::string>{"a", "b"});
+    }
+
+    std::ifstream infile(log_file, std::ios::binary);
+    colorlog::binary::Reader reader(infile);
+    assert(reader.read_header());
+    colorlog::binary::DecodedRecord record;
+    assert(reader.next(record));
+    assert(record.level == colorlog::LogLevel::info && record.msg == "This is a binary info message");
+    assert(record.info.timestamp_ns > 0 && record.info.thread_id > 0);
+    for (int i = 0; i < 3; ++i) {
+        assert(reader.next(record));
+        assert(record.level == colorlog::LogLevel::warn);
+        assert(record.file == "test_binary.cpp" && record.line == 20);
+        assert(record.msg == "request " + std::to_string(i) + " took 2.5us ok=1");
+    }
+    assert(reader.next(record));
+    assert(record.level == colorlog::LogLevel::error && record.msg == "ab");
+    assert(!reader.next(record));
+}
+
+// Function to test static call-site descriptors
+void test_call_sites() {
+    const colorlog::CallSite* first = nullptr;
+    for (int i = 0; i < 2; ++i) {
+        const colorlog::CallSite& site = COLORLOG_CALL_SITE(colorlog::LogLevel::warn, "value={}");
+        if (first == nullptr) first = &site;
+        assert(&site == first);  // One descriptor per expansion, not per call
+    }
+    assert(std::string(first->file) == __FILE__);
+    assert(first->level == colorlog::LogLevel::warn && std::string(first->format) == "value={}");
+    assert(first->id == colorlog::binary::site_id(first->file, first->line, first->format));
+
+    std::string log_file = "test_site_log.bin";
+    std::remove(log_file.c_str());
+    colorlog::LoggerConfig config;
+    config.output_mode = colorlog::OutputMode::Binary;
+    config.log_file_name = log_file;
+    int expected_line = 0;
+    {
+        colorlog::Logger binary_logger(config);
+        for (int i = 0; i < 3; ++i) {
+            expected_line = __LINE__ + 1;
+            COLORLOG_LOGF(binary_logger, colorlog::LogLevel::info, "iteration {}", i);
+        }
+        COLORLOG_LOGF(binary_logger, colorlog::LogLevel::info, "no arguments");
+    }
+
+    std::ifstream infile(log_file, std::ios::binary);
+    colorlog::binary::Reader reader(infile);
+    assert(reader.read_header());
+    colorlog::binary::DecodedRecord record;
+    for (int i = 0; i < 3; ++i) {
+        assert(reader.next(record));
+        assert(record.file == __FILE__ && record.line == expected_line);
+        assert(record.msg == "iteration " + std::to_string(i));
+    }
+    assert(reader.next(record) && record.msg == "no arguments");
+}
+
+// Count the lines currently visible in a file
+static int count_lines(const std::string& path) {
+    std::ifstream infile(path);
+    std::string line;
+    int count = 0;
+    while (std::getline(infile, line)) {
+        count++;
+    }
+    return count;
+}
+
+// Function to test memory-mapped segment output
+void test_mapped_logging() {
+#if !defined(_WIN32) && !defined(_WIN64)
+    std::string base = "test_mapped_log.txt";
+    for (int i = 0; i < 16; ++i) {
+        std::remove((base + "." + std::to_string(i)).c_str());
+    }
+
+    colorlog::LoggerConfig config;
+    config.log_level = colorlog::LogLevel::debug;
+    config.output_mode = colorlog::OutputMode::Mapped;
+    config.log_file_name = base;
+    config.mapped_segment_size = 4096;  // Small segments so the test rolls over several times
+    {
+        colorlog::Logger mapped_logger(config);
+        for (int i = 0; i < 300; ++i) {
+            mapped_logger.info("This is mapped message " + std::to_string(i));
+        }
+        mapped_logger.flush();
+        assert(count_lines(base + ".0") > 0);  // Visible to readers before the logger closes
+    }
+
+    // Segments are trimmed on close, never split a line and hold the messages in order
+    int expected = 0;
+    int segments = 0;
+    for (; segments < 16; ++segments) {
+        std::ifstream infile(base + "." + std::to_string(segments), std::ios::binary);
+        if (!infile) break;
+        std::string content((std::istreambuf_iterator<char>(infile)), std::istreambuf_iterator<char>());
+        assert(content.size() <= 4096);
+        assert(content.find('\0') == std::string::npos);
+        assert(!content.empty() && content.back() == '\n');
+        std::istringstream lines(content);
+        std::string line;
+        while (std::getline(lines, line)) {
+            assert(line == "[INFO] This is mapped message " + std::to_string(expected));
+            ++expected;
+        }
+    }
+    assert(expected == 300);
+    assert(segments > 1);
+
+    // A new logger starts a fresh segment after the existing ones
+    {
+        colorlog::Logger mapped_logger(config);
+        mapped_logger.info("This is a message in a new segment");
+    }
+    assert(count_lines(base + "." + std::to_string(segments)) == 1);
+#endif
+}
+
+// Rotated files of `base` in the current directory, oldest first
+static std::vector<std::string> rotated_files(const std::string& base) {
+    std::vector<std::string> names;
+    for (const auto& entry : std::filesystem::directory_iterator(".")) {
+        std::string name = entry.path().filename().string();
+        if (name.size() > base.size() + 1 && name.compare(0, base.size() + 1, base + ".") == 0) {
+            names.push_back(name);
+        }
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+static void remove_rotated(const std::string& base) {
+    for (const auto& name : rotated_files(base)) {
+        std::remove(name.c_str());
+    }
+    std::remove(base.c_str());
+}
+
+// Function to test size- and time-based log rotation
+void test_log_rotation() {
+    std::string log_file = "test_rotate_log.txt";
+    remove_rotated(log_file);
+
+    colorlog::LoggerConfig config;
+    config.log_level = colorlog::LogLevel::debug;
+    config.output_mode = colorlog::OutputMode::File;
+    config.log_file_name = log_file;
+    config.flush_policy = colorlog::FlushPolicy::Never;
+    config.rotate_max_bytes = 1000;
+    config.rotate_keep = 3;
+    {
+        colorlog::Logger rotating_logger(config);
+        for (int i = 0; i < 200; ++i) {
+            rotating_logger.info("This is rotated message " + std::to_string(i));
+        }
+    }  // Waits for the background pruning
+
+    // Only the newest rotations are kept; together with the live file they end with the last message
+    std::vector<std::string> rotated = rotated_files(log_file);
+    assert(rotated.size() == 3);
+    int expected = -1;
+    for (const auto& name : rotated) {
+        assert(std::filesystem::file_size(name) >= 1000);
+        std::ifstream infile(name);
+        std::string line;
+        while (std::getline(infile, line)) {
+            int index = std::stoi(line.substr(line.rfind(' ') + 1));
+            assert(expected < 0 || index == expected + 1);
+            expected = index;
+        }
+    }
+    assert(std::filesystem::file_size(log_file) < 1000);
+    assert(expected + count_lines(log_file) == 199);
+    remove_rotated(log_file);
+
+    // Rotation after an interval, with the rotated file compressed in the background
+    bool have_gzip = std::system("gzip --version > /dev/null 2>&1") == 0;
+    config.rotate_max_bytes = 0;
+    config.rotate_interval = std::chrono::milliseconds(20);
+    config.rotate_compression = colorlog::Compression::Gzip;
+    {
+        colorlog::Logger rotating_logger(config);
+        rotating_logger.info("This is an old message");
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        rotating_logger.info("This message triggers the rotation");
+        rotating_logger.info("This is a new message");
+    }
+    rotated = rotated_files(log_file);
+    assert(rotated.size() == 1);
+    if (have_gzip) {
+        assert(rotated[0].size() > 3 && rotated[0].compare(rotated[0].size() - 3, 3, ".gz") == 0);
+    }
+    assert(count_lines(log_file) == 1);
+    remove_rotated(log_file);
+}
+
+// Sink collecting records in memory
+class MemorySink : public colorlog::Sink {
+public:
+    void write(std::string_view records) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        text_.append(records);
+    }
+
+    std::string text() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return text_;
+    }
+
+private:
+    std::mutex mutex_;
+    std::string text_;
+};
+
+// Function to test sink fan-out, per-sink settings and the Both output mode
+void test_sinks() {
+    std::string log_file = "test_sinks_log.txt";
+    std::remove(log_file.c_str());
+
+    // Both writes each line once to the console and once to the file
+    colorlog::LoggerConfig config;
+    config.log_level = colorlog::LogLevel::debug;
+    config.output_mode = colorlog::OutputMode::Both;
+    config.log_file_name = log_file;
+    {
+        colorlog::Logger both_logger(config);
+        assert(both_logger.sinks().size() == 2);
+        both_logger.info("This is a message for both outputs");
+        both_logger.warn("This is another message for both outputs");
+    }
+    assert(count_lines(log_file) == 2);
+
+    // Per-sink level threshold, formatter and color; a shared formatter runs once per message
+    int shared_calls = 0;
+    auto shared = std::make_shared<const colorlog::LogBufferFormatter>(
+        [&shared_calls](colorlog::FormatBuffer& out, colorlog::LogLevel, std::string_view, int, std::string_view msg) {
+            ++shared_calls;
+            out.append("shared: ");
+            out.append(msg);
+        });
+    auto plain = std::make_shared<MemorySink>();
+    auto colored = std::make_shared<MemorySink>();
+    auto errors = std::make_shared<MemorySink>();
+    auto custom = std::make_shared<MemorySink>();
+    plain->set_formatter(shared);
+    colored->set_formatter(shared);
+    colored->set_color_mode(colorlog::ColorMode::Always);
+    errors->set_level(colorlog::LogLevel::error);
+    custom->set_formatter([](colorlog::FormatBuffer& out, colorlog::LogLevel, std::string_view, int line, std::string_view msg) {
+        out.append(std::to_string(line));
+        out.append(" ");
+        out.append(msg);
+    });
+
+    colorlog::LoggerConfig sink_config;
+    sink_config.log_level = colorlog::LogLevel::debug;
+    sink_config.sinks = {plain, colored, errors};
+    colorlog::Logger sink_logger(sink_config);
+    sink_logger.add_sink(custom);
+    sink_logger.info("test.cpp", 7, "First message");
+    sink_logger.error("test.cpp", 8, "Second message");
+
+    assert(shared_calls == 2);
+    assert(plain->text() == "[INFO] shared: First message\n[ERROR] shared: Second message\n");
+    assert(colored->text().find("\033[") != std::string::npos);
+    assert(colored->text().find("] shared: First message\n") != std::string::npos);
+    assert(errors->text() == "[ERROR] test.cpp:8 Second message\n");
+    assert(custom->text() == "[INFO] 7 First message\n[ERROR] 8 Second message\n");
+
+    // Precomputed prefixes follow level color changes and the global color switch
+    auto recolored = std::make_shared<MemorySink>();
+    auto automatic = std::make_shared<MemorySink>();
+    recolored->set_color_mode(colorlog::ColorMode::Always);
+    colorlog::LoggerConfig color_config;
+    color_config.sinks = {recolored, automatic};
+    colorlog::Logger color_logger(color_config);
+    color_logger.info("Colored message");
+    color_logger.set_log_level_color(colorlog::LogLevel::info, "\033[1;34m");
+    color_logger.info("Recolored message");
+    assert(recolored->text() == "[\033[1;33mINFO\033[0m] Colored message\n[\033[1;34mINFO\033[0m] Recolored message\n");
+    assert(automatic->text() == "[INFO] Colored message\n[INFO] Recolored message\n");  // Not a terminal
+}
+
+// Colors the environment allows for a descriptor that is (or is not) a terminal
+static bool env_colors(bool terminal) {
+    const char* no_color = std::getenv("NO_COLOR");
+    const char* force = std::getenv("CLICOLOR_FORCE");
+    const char* term = std::getenv("TERM");
+    if (no_color != nullptr && no_color[0] != '\0') return false;
+    if (force != nullptr && force[0] != '\0' && std::strcmp(force, "0") != 0) return true;
+    if (term != nullptr && std::strcmp(term, "dumb") == 0) return false;
+    return terminal;
+}
+
+// Function to test color detection keyed by file descriptor
+void test_color_detection() {
+    auto& cache = colorlog::TerminalCache::instance();
+    assert(colorlog::TerminalCache::fd_of(&std::cout) == 1);
+    assert(colorlog::TerminalCache::fd_of(&std::clog) == 2);
+    std::ostringstream unknown;
+    assert(colorlog::TerminalCache::fd_of(&unknown) == -1);
+    assert(!cache.is_terminal(&unknown));
+    assert(!cache.is_terminal(-1));
+
+#if !defined(_WIN32) && !defined(_WIN64)
+    int pipe_fds[2];
+    assert(::pipe(pipe_fds) == 0);
+    assert(cache.is_terminal(pipe_fds[1]) == env_colors(false));
+    ::close(pipe_fds[0]);
+    ::close(pipe_fds[1]);
+
+    // A console sink on a pseudo-terminal resolves its color once, when attached
+    int master = ::posix_openpt(O_RDWR | O_NOCTTY);
+    if (master >= 0 && ::grantpt(master) == 0 && ::unlockpt(master) == 0) {
+        int slave = ::open(::ptsname(master), O_RDWR | O_NOCTTY);
+        assert(slave >= 0);
+        assert(cache.is_terminal(slave) == env_colors(true));
+
+        std::ostringstream out;
+        auto sink = std::make_shared<colorlog::ConsoleSink>(out, slave);
+        colorlog::LoggerConfig config;
+        config.sinks = {sink};
+        colorlog::Logger logger(config);
+        logger.info("Terminal message");
+        assert(sink->colored() == env_colors(true));
+        assert((out.str().find("\033[") != std::string::npos) == env_colors(true));
+        ::close(slave);
+    }
+    if (master >= 0) ::close(master);
+#endif
+}
+
+// Function to test flush policies
+void test_flush_policy() {
+    std::string log_file = "test_flush_log.txt";
+    std::remove(log_file.c_str());
+
+    colorlog::LoggerConfig config;
+    config.log_level = colorlog::LogLevel::debug;
+    config.output_mode = colorlog::OutputMode::File;
+    config.log_file_name = log_file;
+    config.flush_policy = colorlog::FlushPolicy::EveryN;
+    config.flush_every_n = 3;
+
+    colorlog::Logger file_logger(config);
+    file_logger.info("This is a buffered message");
+    file_logger.info("This is a buffered message");
+    assert(count_lines(log_file) == 0);  // Still in the stream buffer
+    file_logger.info("This is a buffered message");
+    assert(count_lines(log_file) == 3);  // Third message triggers the flush
+    file_logger.warn("This is a buffered message");
+    assert(count_lines(log_file) == 3);
+    file_logger.error("This is an error message");
+    assert(count_lines(log_file) == 5);  // Errors always flush
+    file_logger.info("This is a buffered message");
+    file_logger.flush();
+    assert(count_lines(log_file) == 6);
+
+    // A batch is flushed into the sinks it was written to, even when the sinks were replaced meanwhile
+    struct FlushCountingSink : colorlog::Sink {
+        void write(std::string_view) override {}
+        void flush() override { ++flushes; }
+        int flushes = 0;
+    };
+    auto batched = std::make_shared<FlushCountingSink>();
+    colorlog::LoggerConfig batch_config;
+    batch_config.flush_policy = colorlog::FlushPolicy::Always;
+    batch_config.sinks = {batched};
+    colorlog::Logger batch_logger(batch_config);
+    colorlog::Logger::Batch batch;
+    batch_logger.begin_batch(batch);
+    batch_logger.info("This is a batched message");
+    batch_logger.set_sinks({std::make_shared<FlushCountingSink>()});
+    batch_logger.end_batch();
+    assert(batched->flushes == 1);
+}
+
+// Render one timestamp with append_timestamp
+static std::string timestamp_text(uint64_t timestamp_ns, colorlog::TimestampFormat format) {
+    colorlog::FormatBuffer out;
+    colorlog::append_timestamp(out, timestamp_ns, format, true);
+    return std::string(out.view());
+}
+
+// Function to test timestamp rendering, clock sources and call-site capture
+void test_timestamps() {
+    using colorlog::TimestampFormat;
+    const uint64_t stamp = 1700000000123456789ull;
+    assert(timestamp_text(stamp, TimestampFormat::None).empty());
+    assert(timestamp_text(stamp, TimestampFormat::Seconds) == "2023-11-14 22:13:20");
+    assert(timestamp_text(stamp, TimestampFormat::Milliseconds) == "2023-11-14 22:13:20.123");
+    assert(timestamp_text(stamp, TimestampFormat::Microseconds) == "2023-11-14 22:13:20.123456");
+    assert(timestamp_text(stamp, TimestampFormat::Nanoseconds) == "2023-11-14 22:13:20.123456789");
+    assert(timestamp_text(stamp + 1000000000ull, TimestampFormat::Milliseconds) == "2023-11-14 22:13:21.123");  // Cached second re-rendered
+    assert(timestamp_text(5, TimestampFormat::Nanoseconds) == "1970-01-01 00:00:00.000000005");
+
+    // Every clock source reads wall-clock time
+    for (auto source : {colorlog::ClockSource::System, colorlog::ClockSource::Coarse, colorlog::ClockSource::Tsc}) {
+        uint64_t system = colorlog::RecordInfo::capture().timestamp_ns;
+        uint64_t other = colorlog::RecordInfo::capture(source).timestamp_ns;
+        uint64_t difference = other > system ? other - system : system - other;
+        assert(difference < 50000000ull);
+    }
+
+    std::string log_file = "test_timestamp_log.txt";
+    std::remove(log_file.c_str());
+    colorlog::LoggerConfig config;
+    config.log_level = colorlog::LogLevel::debug;
+    config.output_mode = colorlog::OutputMode::File;
+    config.log_file_name = log_file;
+    config.timestamp_format = TimestampFormat::Nanoseconds;
+    config.timestamp_utc = true;
+    {
+        colorlog::Logger file_logger(config);
+        file_logger.info("This is a timestamped message");
+    }
+    {
+        // The worker builds the first message slowly; the second keeps the time it was logged at
+        colorlog::AsyncLogger async_logger(config);
+        std::string released;
+        async_logger.log(colorlog::LogLevel::info, "", 0, [&released] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            released = timestamp_text(colorlog::RecordInfo::capture().timestamp_ns, TimestampFormat::Nanoseconds);
+            return std::string("This is a slow message");
+        });
+        async_logger.log(colorlog::LogLevel::info, "", 0, "This is a quick message");
+        async_logger.flush();
+        std::ifstream infile(log_file);
+        std::string sync_line, slow_line, quick_line;
+        assert(std::getline(infile, sync_line) && std::getline(infile, slow_line) && std::getline(infile, quick_line));
+        assert(sync_line.substr(29) == " [INFO] This is a timestamped message");
+        assert(slow_line.substr(29) == " [INFO] This is a slow message");
+        assert(quick_line.substr(29) == " [INFO] This is a quick message");
+        assert(quick_line.substr(0, 29) < released);  // Captured at the call, not when the worker got to it
+    }
+}
+
+// Non-virtual sink type for BasicLogger policies, collecting records in memory
+struct MemoryWriter {
+    std::string text;
+    int flushes = 0;
+    void write(std::string_view records) { text.append(records); }
+    void flush() { ++flushes; }
+    bool is_terminal() const { return true; }
+};
+
+// Formatter type writing "line|msg"
+struct LineFormatter {
+    void operator()(colorlog::FormatBuffer& out, colorlog::LogLevel, std::string_view, int line, std::string_view msg) const {
+        out.append(std::to_string(line));
+        out.push_back('|');
+        out.append(msg);
+    }
+};
+
+struct WarnPolicy : colorlog::StaticPolicy {
+    static constexpr colorlog::LogLevel min_level = colorlog::LogLevel::warn;
+    using Sinks = std::tuple<MemoryWriter, MemoryWriter>;
+    using Formatter = LineFormatter;
+    using Mutex = colorlog::NullMutex;
+    static constexpr bool colored = false;
+    static constexpr bool flush_every_record = false;
+};
+
+// Function to test the compile-time configured BasicLogger
+void test_static_logger() {
+    static_assert(std::is_same_v<colorlog::Logger, colorlog::BasicLogger<colorlog::DynamicPolicy>>);
+    static_assert(!colorlog::BasicLogger<WarnPolicy>::should_log(colorlog::LogLevel::info));
+    static_assert(colorlog::BasicLogger<WarnPolicy>::should_log(colorlog::LogLevel::error));
+
+    colorlog::BasicLogger<WarnPolicy> static_logger;
+    bool built = false;
+    static_logger.info("This is filtered out");
+    static_logger.debug([&built] { built = true; return std::string("Never built"); });
+    static_logger.warn("This is a warning");
+    static_logger.logf(colorlog::LogLevel::error, "test.cpp", 12, "value {} of {}", 3, std::string("four"));
+    static_logger.log(colorlog::LogLevel::fatal, "test.cpp", 13, std::vector<int>{1, 2, 3});
+    COLORLOG_LOGF(static_logger, colorlog::LogLevel::error, "macro {}", 5);
+    assert(!built);
+    const std::string expected = "[WARNING] 0|This is a warning\n[ERROR] 12|value 3 of four\n[FATAL] 13|123\n";
+    assert(static_logger.sink<0>().text.substr(0, expected.size()) == expected);
+    assert(static_logger.sink<0>().text.find("|macro 5\n") != std::string::npos);
+    assert(static_logger.sink<1>().text == static_logger.sink<0>().text);  // Colors compiled out despite the terminal
+    assert(static_logger.sink<0>().flushes == 3);  // Only the error and fatal records
+    static_logger.flush();
+    assert(static_logger.sink<0>().flushes == 4 && static_logger.sink<1>().flushes == 4);
+
+    // Default policy: colored prefixes on terminal sinks, flushed per record
+    struct ColorPolicy : colorlog::StaticPolicy {
+        using Sinks = std::tuple<MemoryWriter>;
+    };
+    colorlog::BasicLogger<ColorPolicy> color_logger;
+    color_logger.info("Colored message");
+    assert(color_logger.sink<0>().text == "[\033[1;33mINFO\033[0m] Colored message\n");
+    assert(color_logger.sink<0>().flushes == 1);
+}
+
+// Type formatted through a colorlog::formatter specialization, with no operator<<
+struct Point {
+    int x;
+    int y;
+};
+
+template <>
+struct colorlog::formatter<Point> {
+    static void format(colorlog::FormatBuffer& out, const Point& p) {
+        out.append("(" + std::to_string(p.x) + "," + std::to_string(p.y) + ")");
+    }
+};
+
+// Type formatted through its operator<<
+struct Celsius {
+    double degrees;
+};
+
+std::ostream& operator<<(std::ostream& os, const Celsius& c) {
+    return os << c.degrees << "C";
+}
+
+// Function to test compile-time checked format strings and the formatting engine
+void test_format_strings() {
+    static_assert(colorlog::detail::count_placeholders("req {} took {}us") == 2);
+    static_assert(colorlog::detail::count_placeholders("{{literal}} {}") == 1);
+    static_assert(colorlog::detail::count_placeholders("unbalanced {") == -1);
+    static_assert(colorlog::detail::count_placeholders("named {id}") == -1);
+    static_assert(Formattable<Point> && !Printable<Point>);
+
+    std::string log_file = "test_format_log.txt";
+    std::remove(log_file.c_str());
+
+    colorlog::LoggerConfig config;
+    config.output_mode = colorlog::OutputMode::File;
+    config.log_file_name = log_file;
+
+    {
+        colorlog::Logger file_logger(config);
+        file_logger.info("req {} took {}us", 42, 17);
+        file_logger.warn("{} {} {} {} {}", -7, 3.25, 1e-7, true, 'x');
+        file_logger.error("point {} at {} {{escaped}}", Point{1, 2}, Celsius{21.5});
+        file_logger.info("test.cpp", 10, "Location overload still selected");
+        file_logger.trace("{} {}", std::string("string"), std::vector<int>{1, 2}.size());
+    }
+
+    std::ostringstream expected_numbers;
+    expected_numbers << -7 << " " << 3.25 << " " << 1e-7 << " " << true << " " << 'x';
+
+    std::ifstream infile(log_file);
+    std::string line;
+    std::getline(infile, line);
+    assert(line == "[INFO] req 42 took 17us");
+    std::getline(infile, line);
+    assert(line == "[WARNING] " + expected_numbers.str());
+    std::getline(infile, line);
+    assert(line == "[ERROR] point (1,2) at 21.5C {escaped}");
+    std::getline(infile, line);
+    assert(line == "[INFO] test.cpp:10 Location overload still selected");
+    std::getline(infile, line);
+    assert(line == "[TRACE] string 2");
+
+    colorlog::BasicLogger<WarnPolicy> static_logger;
+    static_logger.error("point {}", Point{3, 4});
+    assert(static_logger.sink<0>().text == "[ERROR] 0|point (3,4)\n");
+}
+
+// Function to test range formatting with join()
+void test_range_formatting() {
+    std::string log_file = "test_range_log.txt";
+    std::remove(log_file.c_str());
+
+    colorlog::LoggerConfig config;
+    config.log_level = colorlog::LogLevel::debug;
+    config.output_mode = colorlog::OutputMode::File;
+    config.log_file_name = log_file;
+
+    std::vector<int> ids = {1, 2, 3, 4, 5};
+    std::vector<std::string> names = {"a", "b", "c"};
+    std::list<double> ratios = {0.5, 1.25};
+    {
+        colorlog::Logger file_logger(config);
+        file_logger.info(ids);
+        file_logger.info("ids {}", join(ids, ", ", 3));
+        file_logger.warn(join(names, "|"));
+        file_logger.error("ratios [{}] points {}", join(ratios), join(std::vector<Point>{{1, 2}, {3, 4}}, " "));
+        file_logger.debug("empty [{}] all {}", join(std::vector<int>{}), join(ids, "", 5));
+    }
+
+    std::ifstream infile(log_file);
+    std::string line;
+    std::getline(infile, line);
+    assert(line == "[INFO] 12345");  // Bare iterables still concatenate their elements
+    std::getline(infile, line);
+    assert(line == "[INFO] ids 1, 2, 3 ... (2 more)");
+    std::getline(infile, line);
+    assert(line == "[WARNING] a|b|c");
+    std::getline(infile, line);
+    assert(line == "[ERROR] ratios [0.5, 1.25] points (1,2) (3,4)");
+    std::getline(infile, line);
+    assert(line == "[DEBUG] empty [] all 12345");
+
+    std::ostringstream os;
+    os << join(ids, " ", 2);
+    assert(os.str() == "1 2 ... (3 more)");
+}
+
+// Function to test the thread's log context in text and JSON records
+void test_log_context() {
+    std::string log_file = "test_context_log.txt";
+    std::string json_file = "test_context_log.json";
+    std::remove(log_file.c_str());
+    std::remove(json_file.c_str());
+
+    colorlog::LoggerConfig config;
+    config.sinks = {std::make_shared<colorlog::FileSink>(log_file), std::make_shared<colorlog::JsonFileSink>(json_file)};
+    {
+        colorlog::Logger logger(config);
+        logger.info("no context");
+        colorlog::LogContext::Scope request("request_id", "r-42");
+        {
+            colorlog::LogContext::Scope tenant("tenant", "acme \"eu\"");
+            colorlog::LogContext::Scope attempt("attempt", 3);
+            logger.warn("site.cpp", 7, "retrying\tnow");
+            assert(colorlog::LogContext::current().size() == 2 + 10 + 4 + 2 + 6 + 9 + 2 + 7 + 1);
+        }
+        logger.info("request {}", "done");
+
+        // Values are cut to fit the fixed storage; fields whose key does not fit are left out
+        std::string huge(300, 'v');
+        colorlog::LogContext::Scope big("big", huge);
+        colorlog::LogContext::Scope left_out("dropped", "x");
+        std::vector<std::string> keys;
+        colorlog::LogContext::for_each(colorlog::LogContext::current(), [&keys](std::string_view key, std::string_view value) {
+            keys.emplace_back(key);
+            assert(key != "big" || value.size() == colorlog::LogContext::capacity - 16 - 5);
+        });
+        assert((keys == std::vector<std::string>{"request_id", "big"}));
+    }
+    assert(colorlog::LogContext::current().empty());
+
+    std::ifstream infile(log_file);
+    std::string line;
+    std::getline(infile, line);
+    assert(line == "[INFO] no context");
+    std::getline(infile, line);
+    assert(line == "[WARNING] [request_id=r-42 tenant=acme \"eu\" attempt=3] site.cpp:7 retrying\tnow");
+    std::getline(infile, line);
+    assert(line == "[INFO] [request_id=r-42] request done");
+
+    std::ifstream json(json_file);
+    std::getline(json, line);
+    assert(line.find("\"level\":\"INFO\"") != std::string::npos && line.find("\"context\"") == std::string::npos);
+    assert(line.find("\"time_ns\":") == 1 && line.find("\"time_ns\":0,") == std::string::npos);
+    assert(line.back() == '}' && line.find("\"message\":\"no context\"") != std::string::npos);
+    std::getline(json, line);
+    assert(line.find("\"level\":\"WARNING\"") != std::string::npos);
+    assert(line.find("\"file\":\"site.cpp\",\"line\":7") != std::string::npos);
+    assert(line.find("\"message\":\"retrying\\tnow\",\"context\":{\"request_id\":\"r-42\",\"tenant\":\"acme \\\"eu\\\"\",\"attempt\":\"3\"}}") != std::string::npos);
+    std::getline(json, line);
+    assert(line.find("\"context\":{\"request_id\":\"r-42\"}}") != std::string::npos);
+}
+
+// Function to test per-call-site rate limiting and repeat suppression
+void test_site_limits() {
+    std::string log_file = "test_site_limits_log.txt";
+    std::remove(log_file.c_str());
+
+    colorlog::LoggerConfig config;
+    config.output_mode = colorlog::OutputMode::File;
+    config.log_file_name = log_file;
+    config.site_limits[colorlog::LogLevel::error] = {0.001, 3, false};
+    config.site_limits[colorlog::LogLevel::warn] = {0, 1, true};
+    config.site_limits[colorlog::LogLevel::fatal] = {20, 1, false};
+
+    int built = 0;
+    {
+        colorlog::Logger file_logger(config);
+        for (int i = 0; i < 10; ++i) {
+            file_logger.logf(colorlog::LogLevel::error, "site.cpp", 1, "failure {}", i);
+            file_logger.log(colorlog::LogLevel::error, "site.cpp", 2, [&built] { return std::to_string(++built); });
+        }
+        file_logger.info("info is not limited");
+        file_logger.info("info is not limited");
+
+        for (int i = 0; i < 5; ++i) {
+            file_logger.warn("site.cpp", 3, "same message");
+        }
+        file_logger.warn("site.cpp", 3, "different message");
+
+        file_logger.fatal("site.cpp", 4, "first");
+        file_logger.fatal("site.cpp", 4, "limited");
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        file_logger.fatal("site.cpp", 4, "after refill");
+    }
+    assert(built == 3);  // Rate-limited lazy messages are never built
+
+    std::ifstream infile(log_file);
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(infile, line);) {
+        lines.push_back(line);
+    }
+    const std::vector<std::string> expected = {
+        "[ERROR] site.cpp:1 failure 0", "[ERROR] site.cpp:2 1",
+        "[ERROR] site.cpp:1 failure 1", "[ERROR] site.cpp:2 2",
+        "[ERROR] site.cpp:1 failure 2", "[ERROR] site.cpp:2 3",
+        "[INFO] info is not limited", "[INFO] info is not limited",
+        "[WARNING] site.cpp:3 same message",
+        "[WARNING] site.cpp:3 Previous message repeated 4 times",
+        "[WARNING] site.cpp:3 different message",
+        "[FATAL] site.cpp:4 first",
+        "[FATAL] site.cpp:4 1 message suppressed by the rate limit",
+        "[FATAL] site.cpp:4 after refill",
+    };
+    assert(lines == expected);
+}
+
+// Count the occurrences of `needle` in `text`
+static int count_of(const std::string& text, const std::string& needle) {
+    int count = 0;
+    for (size_t pos = text.find(needle); pos != std::string::npos; pos = text.find(needle, pos + 1)) {
+        ++count;
+    }
+    return count;
+}
+
+// Function to test per-level and per-call-site sampling
+void test_sampling() {
+    auto sink = std::make_shared<MemorySink>();
+    colorlog::LoggerConfig config;
+    config.log_level = colorlog::LogLevel::debug;
+    config.sinks = {sink};
+    config.sampling[colorlog::LogLevel::debug] = {10, 1.0};
+    config.sampling[colorlog::LogLevel::trace] = {1, 0.25};
+    colorlog::Logger logger(config);
+
+    // 1-in-N: every tenth record is kept, and messages of dropped records are never built
+    int built = 0;
+    auto build = [&built] { ++built; return std::string("built message"); };
+    for (int i = 0; i < 100; ++i) {
+        COLORLOG_LOG(logger, colorlog::LogLevel::debug, build());
+    }
+    assert(built == 10);
+    for (int i = 0; i < 100; ++i) {
+        logger.debug("direct message");
+    }
+    std::string text = sink->text();
+    assert(count_of(text, "[DEBUG] [1/10] ") == 20);
+    assert(count_of(text, "built message") == 10 && count_of(text, "direct message") == 10);
+
+    // Probability: about a quarter is kept, each standing for four records
+    for (int i = 0; i < 10000; ++i) {
+        COLORLOG_LOGF(logger, colorlog::LogLevel::trace, "trace {}", i);
+    }
+    text = sink->text();
+    int traces = count_of(text, "[TRACE] [1/4] ");
+    assert(traces == count_of(text, "[TRACE]"));
+    assert(traces > 2000 && traces < 3000);
+
+    // A sampled call site multiplies into the level's rate; unsampled levels carry no tag
+    for (int i = 0; i < 50; ++i) {
+        COLORLOG_LOG_SAMPLED(logger, colorlog::LogLevel::info, 5, "site sampled");
+        COLORLOG_LOG_SAMPLED(logger, colorlog::LogLevel::debug, 5, "doubly sampled");
+        logger.warn("unsampled");
+    }
+    text = sink->text();
+    assert(count_of(text, "[INFO] [1/5] ") == 10 && count_of(text, "site sampled") == 10);
+    assert(count_of(text, "[DEBUG] [1/50] ") == 1 && count_of(text, "doubly sampled") == 1);
+    assert(count_of(text, "[WARNING] ") == 50 && count_of(text, "unsampled") == 50);
+
+    // Binary records carry the weight too
+    std::string log_file = "test_sampling_log.bin";
+    std::remove(log_file.c_str());
+    colorlog::LoggerConfig binary_config;
+    binary_config.log_level = colorlog::LogLevel::debug;
+    binary_config.output_mode = colorlog::OutputMode::Binary;
+    binary_config.log_file_name = log_file;
+    binary_config.sampling[colorlog::LogLevel::debug] = {3, 1.0};
+    {
+        colorlog::Logger binary_logger(binary_config);
+        for (int i = 0; i < 6; ++i) {
+            binary_logger.logf(colorlog::LogLevel::debug, "test_sampling.cpp", 10, "value {}", i);
+        }
+        binary_logger.info("unsampled");
+    }
+    std::ifstream infile(log_file, std::ios::binary);
+    colorlog::binary::Reader reader(infile);
+    assert(reader.read_header());
+    colorlog::binary::DecodedRecord record;
+    assert(reader.next(record) && record.msg == "value 0" && record.info.sample_weight == 3);
+    assert(reader.next(record) && record.msg == "value 3" && record.info.sample_weight == 3);
+    assert(reader.next(record) && record.msg == "unsampled" && record.info.sample_weight == 1);
+    assert(!reader.next(record));
+}
+
+// Function to test the self-instrumentation counters and the periodic report
+void test_stats() {
+    for (uint64_t ns : {0ull, 7ull, 8ull, 100ull, 12345ull, 1000000007ull, ~0ull}) {
+        size_t bucket = colorlog::LatencyHistogram::bucket_of(ns);
+        uint64_t upper = colorlog::LatencyHistogram::bucket_upper(bucket);
+        assert(bucket < colorlog::LatencyHistogram::bucket_count);
+        assert(upper >= ns && upper - ns <= ns / 8);
+        assert(bucket == 0 || colorlog::LatencyHistogram::bucket_upper(bucket - 1) < ns);
+    }
+
+    std::string log_file = "test_stats_log.txt";
+    std::remove(log_file.c_str());
+
+    colorlog::LoggerConfig config;
+    config.output_mode = colorlog::OutputMode::File;
+    config.log_file_name = log_file;
+    config.collect_stats = true;
+    config.site_limits[colorlog::LogLevel::warn] = {0, 1, true};
+    {
+        colorlog::Logger file_logger(config);
+        assert(colorlog::Logger().stats().total_messages() == 0);  // Not collected by default
+        file_logger.info("first");
+        file_logger.info("second");
+        file_logger.error("third");
+        file_logger.debug("filtered");
+        file_logger.warn("test.cpp", 1, "repeated");
+        file_logger.warn("test.cpp", 1, "repeated");
+
+        colorlog::LoggerStats stats = file_logger.stats();
+        assert(stats.messages[static_cast<size_t>(colorlog::LogLevel::info)] == 2);
+        assert(stats.messages[static_cast<size_t>(colorlog::LogLevel::error)] == 1);
+        assert(stats.messages[static_cast<size_t>(colorlog::LogLevel::debug)] == 0);
+        assert(stats.total_messages() == 4 && stats.suppressed == 1);
+        assert(stats.bytes_written == std::filesystem::file_size(log_file));
+        assert(stats.latency.count == 4);
+        assert(stats.latency.percentile(50) <= stats.latency.percentile(99));
+        assert(stats.latency.percentile(100) == stats.latency.max_ns);
+    }
+
+    std::remove(log_file.c_str());
+    config.stats_report_interval = std::chrono::milliseconds(20);
+    {
+        colorlog::Logger file_logger(config);
+        file_logger.info("reported");
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    std::ifstream infile(log_file);
+    std::string line;
+    std::getline(infile, line);
+    std::getline(infile, line);
+    assert(line.find("[INFO] colorlog stats: messages=1 bytes=") == 0);
+}
+
 // Function to test the concepts directly
 void test_concepts() {
     static_assert(PrintableStringOrIterable<std::string>);
@@ -144,6 +1083,57 @@ int main() {
     std::cout << "Testing file logging..." << std::endl;
     test_file_logging();
 
+    std::cout << "Testing runtime level filtering..." << std::endl;
+    test_runtime_level_filtering();
+
+    std::cout << "Testing lazy logging..." << std::endl;
+    test_lazy_logging();
+
+    std::cout << "Testing binary logging..." << std::endl;
+    test_binary_logging();
+
+    std::cout << "Testing call sites..." << std::endl;
+    test_call_sites();
+
+    std::cout << "Testing color detection..." << std::endl;
+    test_color_detection();
+
+    std::cout << "Testing flush policy..." << std::endl;
+    test_flush_policy();
+
+    std::cout << "Testing memory-mapped logging..." << std::endl;
+    test_mapped_logging();
+
+    std::cout << "Testing log rotation..." << std::endl;
+    test_log_rotation();
+
+    std::cout << "Testing sinks..." << std::endl;
+    test_sinks();
+
+    std::cout << "Testing timestamps..." << std::endl;
+    test_timestamps();
+
+    std::cout << "Testing static logger..." << std::endl;
+    test_static_logger();
+
+    std::cout << "Testing format strings..." << std::endl;
+    test_format_strings();
+
+    std::cout << "Testing range formatting..." << std::endl;
+    test_range_formatting();
+
+    std::cout << "Testing log context..." << std::endl;
+    test_log_context();
+
+    std::cout << "Testing site limits..." << std::endl;
+    test_site_limits();
+
+    std::cout << "Testing sampling..." << std::endl;
+    test_sampling();
+
+    std::cout << "Testing stats..." << std::endl;
+    test_stats();
+
     std::cout << "Testing concepts..." << std::endl;
     test_concepts();
 
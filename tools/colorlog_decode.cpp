@@ -0,0 +1,91 @@
+/*
+    * colorlog_decode.cpp
+    *
+    * Offline decoder for logs written with OutputMode::Binary. Prints each record in the
+    * regular "[LEVEL] file:line msg" text format, colorized when writing to a terminal.
+    *
+    * Usage: colorlog_decode [--color | --no-color] [--timestamps] <binary log file>
+    *
+    * (c) 2024, Benjamin Gorlick | github.com/bgorlick/colorlog_cpp/
+    * Distributed under the Boost Software License, Version 1.0.
+    * (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../include/colorlog.hpp"
+#include <iostream>
+#include <fstream>
+#include <string>
+
+using namespace colorlog;
+
+// Color used for each level's name, indexed by LogLevel
+static const ColorAttr* level_colors[log_level_count] = {
+    &ColorDefs::debug, &ColorDefs::info, &ColorDefs::warn, &ColorDefs::error,
+    &ColorDefs::fatal, &ColorDefs::trace, &ColorDefs::unknown
+};
+
+int main(int argc, char** argv) {
+    bool colored = TerminalCache::instance().is_terminal(&std::cout);
+    bool timestamps = false;
+    const char* path = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--color") {
+            colored = true;
+        } else if (arg == "--no-color") {
+            colored = false;
+        } else if (arg == "--timestamps") {
+            timestamps = true;
+        } else if (path == nullptr && !arg.empty() && arg[0] != '-') {
+            path = argv[i];
+        } else {
+            path = nullptr;
+            break;
+        }
+    }
+    if (path == nullptr) {
+        std::cerr << "Usage: " << argv[0] << " [--color | --no-color] [--timestamps] <binary log file>" << std::endl;
+        return 2;
+    }
+
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    if (!in) {
+        std::cerr << "Cannot open " << path << std::endl;
+        return 1;
+    }
+    binary::Reader reader(in);
+    if (!reader.read_header()) {
+        std::cerr << path << " is not a colorlog binary log" << std::endl;
+        return 1;
+    }
+
+    // Same layout as Logger's text output, using the default formatter
+    LogBufferFormatter formatter = LoggerConfig().buffer_formatter;
+    FormatBuffer line;
+    FormatBuffer stamp;
+    binary::DecodedRecord record;
+    while (reader.next(record)) {
+        line.clear();
+        formatter(line, record.level, record.file, record.line, record.msg);
+        if (timestamps) {
+            stamp.clear();
+            append_timestamp(stamp, record.info.timestamp_ns, TimestampFormat::Microseconds);
+            std::cout.write(stamp.data(), static_cast<std::streamsize>(stamp.size()));
+            std::cout << " [thread " << record.info.thread_id << "] ";
+        }
+        std::cout << "[";
+        if (colored) {
+            std::cout << level_colors[static_cast<size_t>(record.level)]->code << log_level_name(record.level) << "\033[0m";
+        } else {
+            std::cout << log_level_name(record.level);
+        }
+        std::cout << "] ";
+        stamp.clear();
+        append_sample_tag(stamp, record.info.sample_weight);
+        std::cout.write(stamp.data(), static_cast<std::streamsize>(stamp.size()));
+        std::cout.write(line.data(), static_cast<std::streamsize>(line.size()));
+        std::cout << '\n';
+    }
+    std::cout.flush();
+    return 0;
+}